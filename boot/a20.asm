@@ -0,0 +1,18 @@
+; enable_a20 - Open the A20 gate so addresses above 1MB do not wrap
+; Asks the BIOS first, then sets the fast A20 bit in port 0x92 in case
+; the BIOS call is not supported
+
+[bits 16]
+
+enable_a20:
+    pusha
+    mov ax, 0x2401              ; BIOS enable A20
+    int 0x15
+
+    in al, 0x92                 ; System control port A
+    or al, 0x02                 ; Fast A20
+    and al, 0xFE                ; Never set the reset bit
+    out 0x92, al
+
+    popa
+    ret
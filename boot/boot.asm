@@ -1,13 +1,62 @@
 ; SimpleOS Bootloader
 ; This bootloader loads the kernel from disk and switches to 32-bit protected mode
+;
+; The boot sector only loads the second stage, stored in the sectors right
+; behind it; the second stage loads the kernel above 1MB and the boot archive.
 
 [org 0x7c00]                    ; BIOS loads bootloader at address 0x7C00
 [bits 16]                       ; Start in 16-bit real mode
 
-KERNEL_OFFSET equ 0x1000        ; Memory offset where kernel will be loaded
-
+STAGE2_SECTORS equ 2            ; Second stage size, the kernel follows it
+BOUNCE_SEGMENT equ 0x1000       ; Kernel chunks are read to 0x10000, then copied up
+INITRD_SEGMENT equ 0x3000       ; INITRD_ADDR in include/initrd.h
+
+; Multiboot header, at this offset in the kernel's first sector (kernel_entry.asm)
+KERNEL_MAGIC equ 0x1BADB002
+KHDR_MAGIC   equ 4
+KHDR_START   equ 20             ; Load address
+KHDR_END     equ 24             ; End of the loaded image
+KHDR_ENTRY   equ 32             ; Entry address
+
+; Boot trace handed to the kernel, see include/boottrace.h
+BOOT_TSC_ADDR    equ 0x7000
+BOOT_TSC_MAGIC   equ 0x43535442
+BOOT_TSC_SIZE    equ 8 + 6 * 8  ; Magic, reserved, six slots
+BOOT_TSC_START   equ 0
+BOOT_TSC_STAGE2  equ 1
+BOOT_TSC_KERNEL  equ 2
+BOOT_TSC_INITRD  equ 3
+BOOT_TSC_PMODE   equ 4
+
+; Store the time-stamp counter in a boot trace slot; clobbers EAX and EDX
+%macro BOOT_STAMP 1
+    rdtsc
+    mov [BOOT_TSC_ADDR + 8 + %1 * 8], eax
+    mov [BOOT_TSC_ADDR + 12 + %1 * 8], edx
+%endmacro
+
+; Sector count of the boot archive, passed by the Makefile
+%ifndef INITRD_SECTORS
+%define INITRD_SECTORS 0
+%endif
+%if INITRD_SECTORS > 0x50000 / 512
+%error "initrd larger than INITRD_MAX_SIZE"
+%endif
+
+    xor ax, ax
+    mov ds, ax
+    cld
     mov [BOOT_DRIVE], dl        ; BIOS stores boot drive in DL, save it
 
+    ; Start the boot trace: clear the slots, then stamp the end of the
+    ; firmware's part
+    mov es, ax
+    mov di, BOOT_TSC_ADDR
+    mov cx, BOOT_TSC_SIZE / 2
+    rep stosw
+    mov dword [BOOT_TSC_ADDR], BOOT_TSC_MAGIC
+    BOOT_STAMP BOOT_TSC_START
+
     ; Set up stack
     mov bp, 0x9000              ; Set stack base pointer
     mov sp, bp                  ; Set stack pointer
@@ -16,53 +65,140 @@ KERNEL_OFFSET equ 0x1000        ; Memory offset where kernel will be loaded
     mov bx, MSG_REAL_MODE
     call print_string
 
-    ; Load kernel from disk
+    ; Every read uses the BIOS extended read, starting with the second stage
+    call disk_check
+
+    ; Load the second stage right behind this sector, at 0x7E00
+    mov bx, 0x07E0
+    mov es, bx
+    mov eax, 1
+    mov cx, STAGE2_SECTORS
+    call disk_read
+    jmp stage2
+
+; Boot sector includes
+%include "boot/print_string.asm"
+%include "boot/disk_load.asm"
+
+; Written before the second stage is loaded, so kept in this sector
+BOOT_DRIVE      db 0
+MSG_REAL_MODE   db "Started in 16-bit Real Mode", 0
+
+; Boot sector padding and magic number
+times 510-($-$$) db 0           ; Pad with zeros
+dw 0xaa55                       ; Boot signature
+
+; Second stage
+stage2:
+    BOOT_STAMP BOOT_TSC_STAGE2
+
+    ; Reach memory above 1MB
+    call enable_a20
+
+    ; Load kernel from disk, EAX is left at the sector after it
     call load_kernel
+    push eax
+    BOOT_STAMP BOOT_TSC_KERNEL
+    pop eax
+
+%if INITRD_SECTORS > 0
+    ; Load the boot archive, stored after the kernel, to INITRD_SEGMENT:0
+    mov bx, INITRD_SEGMENT
+    mov es, bx
+    mov cx, INITRD_SECTORS
+    call disk_read
+    BOOT_STAMP BOOT_TSC_INITRD
+%endif
 
     ; Switch to protected mode
     call switch_to_pm
 
     jmp $                       ; Should never reach here
 
-; Include files
-%include "boot/print_string.asm"
-%include "boot/disk_load.asm"
+; Second stage includes
+%include "boot/a20.asm"
+%include "boot/unreal_mode.asm"
 %include "boot/gdt.asm"
 %include "boot/print_string_pm.asm"
 %include "boot/switch_to_pm.asm"
 
 [bits 16]
-; Load kernel from disk into memory
+; Load kernel from disk to the address in its header, above 1MB
+; Output: EAX = first sector after the kernel
 load_kernel:
     mov bx, MSG_LOAD_KERNEL
     call print_string
 
-    mov bx, KERNEL_OFFSET       ; Load kernel to this address
-    mov dh, 25                  ; Load 25 sectors (12.5KB, enough for kernel)
-    mov dl, [BOOT_DRIVE]        ; Drive number
-    call disk_load
-
+    ; The first sector carries the header with the kernel's size
+    mov bx, BOUNCE_SEGMENT
+    mov es, bx
+    mov eax, 1 + STAGE2_SECTORS ; The kernel follows the second stage
+    mov cx, 1
+    call disk_read
+    cmp dword [es:KHDR_MAGIC], KERNEL_MAGIC
+    jne .bad_header
+    mov edi, [es:KHDR_ENTRY]
+    mov [KERNEL_ENTRY], edi
+    mov edi, [es:KHDR_START]
+    mov ecx, [es:KHDR_END]
+    sub ecx, edi
+    add ecx, 511
+    shr ecx, 9                  ; Sectors to load
+
+.next:
+    mov bx, cx                  ; Chunk: what is left, at most READ_CHUNK
+    cmp bx, READ_CHUNK
+    jbe .read
+    mov bx, READ_CHUNK
+.read:
+    push cx
+    mov cx, bx
+    call disk_read
+
+    ; Copy the chunk from the bounce buffer to EDI, which advances
+    call enter_unreal
+    push eax
+    push es
+    xor ax, ax
+    mov es, ax
+    mov esi, BOUNCE_SEGMENT * 16
+    movzx ecx, bx
+    shl ecx, 7                  ; Sectors to dwords
+    a32 rep movsd
+    pop es
+    pop eax
+
+    movzx ebx, bx
+    add eax, ebx                ; Next sector
+    pop cx
+    sub cx, bx
+    jnz .next
     ret
 
+.bad_header:
+    mov bx, MSG_BAD_KERNEL
+    call print_string
+    jmp $                       ; Hang forever
+
 [bits 32]
 ; Entry point after switching to protected mode
 BEGIN_PM:
+    BOOT_STAMP BOOT_TSC_PMODE
     mov ebx, MSG_PROT_MODE
     call print_string_pm
 
-    ; Jump to kernel
-    call KERNEL_OFFSET
+    ; Jump to kernel, EAX = 0 tells it there is no multiboot information
+    xor eax, eax
+    call [KERNEL_ENTRY]
 
     ; If kernel returns, hang
     jmp $
 
 ; Data
-BOOT_DRIVE      db 0
-MSG_REAL_MODE   db "Started in 16-bit Real Mode", 0
+KERNEL_ENTRY    dd 0
 MSG_PROT_MODE   db "Successfully switched to 32-bit Protected Mode", 0
 MSG_LOAD_KERNEL db "Loading kernel into memory", 0
+MSG_BAD_KERNEL  db "Bad kernel header!", 0
 
-; Boot sector padding and magic number
-times 510-($-$$) db 0           ; Pad with zeros
-dw 0xaa55                       ; Boot signature
-
+; Pad the second stage to whole sectors
+times 512 * (1 + STAGE2_SECTORS) - ($-$$) db 0
@@ -1,40 +1,51 @@
-; disk_load - Load sectors from disk using BIOS interrupt
+; disk_read - Load sectors of the boot drive by LBA
 ; Input:
-;   DH = number of sectors to read
-;   DL = drive number
-;   BX = memory address to load sectors to
+;   EAX = first sector (LBA, the boot sector is 0)
+;   CX  = number of sectors
+;   ES  = segment to load to, from offset 0
+;
+; Uses the INT 0x13 AH=0x42 extended read, so there are no cylinder or
+; track limits; disk_check must have passed first. Each call to the BIOS
+; moves up to READ_CHUNK sectors, which stays below 64KB from a segment
+; boundary.
 
 [bits 16]
 
-disk_load:
-    pusha                       ; Save all registers
-    push dx
+READ_CHUNK equ 127              ; Largest transfer every BIOS accepts
 
-    ; Reset disk system first
-    mov ah, 0x00                ; BIOS reset disk function
-    int 0x13                    ; Call BIOS
-    jc .disk_error              ; If reset fails, error
+disk_read:
+    pushad
+    push es
 
-    pop dx
-    push dx
+.next:
+    mov bx, cx                  ; Chunk: what is left, at most READ_CHUNK
+    cmp bx, READ_CHUNK
+    jbe .read
+    mov bx, READ_CHUNK
+.read:
+    mov [DAP_COUNT], bx
+    mov [DAP_SEGMENT], es
+    mov [DAP_LBA], eax
+    push eax
+    mov ah, 0x42                ; BIOS extended read
+    mov dl, [BOOT_DRIVE]
+    mov si, DAP
+    int 0x13
+    pop eax
+    jc .disk_error
 
-    ; Now read sectors
-    mov ah, 0x02                ; BIOS read sector function
-    mov al, dh                  ; Number of sectors to read
-    mov cl, 0x02                ; Start reading from sector 2 (after boot sector)
-    mov ch, 0x00                ; Cylinder 0
-    mov dh, 0x00                ; Head 0
-    ; DL already contains drive number
-    ; BX already contains buffer address
+    movzx edx, bx
+    add eax, edx                ; Next sector
+    sub cx, bx
+    shl bx, 5                   ; Sectors to paragraphs
+    mov dx, es
+    add dx, bx
+    mov es, dx
+    test cx, cx
+    jnz .next
 
-    int 0x13                    ; Call BIOS disk read
-    jc .disk_error              ; Jump if error (carry flag set)
-
-    pop dx
-    cmp al, dh                  ; Check if we read the right number of sectors
-    jne .sectors_error          ; If not, error
-
-    popa                        ; Restore all registers
+    pop es
+    popad
     ret
 
 .disk_error:
@@ -42,11 +53,39 @@ disk_load:
     call print_string
     jmp $                       ; Hang forever
 
-.sectors_error:
-    mov bx, SECTORS_ERROR_MSG
+DISK_ERROR_MSG db "Disk read error!", 0
+
+; disk_check - Make sure the boot drive has the extended read
+; Clobbers AX, BX, CX and DX
+;
+; INT 0x13 AH=0x41 reports the extensions (EDD) a drive supports; the
+; disk address packet calls are bit 0 of CX. Without them the first
+; AH=0x42 read would fail with only a generic disk error.
+disk_check:
+    mov ah, 0x41                ; BIOS extensions installation check
+    mov bx, 0x55AA
+    mov dl, [BOOT_DRIVE]
+    int 0x13
+    jc .no_lba
+    cmp bx, 0xAA55              ; Swapped when the extensions are installed
+    jne .no_lba
+    test cx, 1                  ; Disk address packet calls
+    jz .no_lba
+    ret
+
+.no_lba:
+    mov bx, NO_LBA_MSG
     call print_string
     jmp $                       ; Hang forever
 
-DISK_ERROR_MSG db "Disk read error!", 0x0D, 0x0A, 0
-SECTORS_ERROR_MSG db "Wrong number of sectors read!", 0x0D, 0x0A, 0
+NO_LBA_MSG db "No LBA extensions on boot drive!", 0
 
+; Disk address packet for AH=0x42
+DAP:
+    db 0x10                     ; Packet size
+    db 0
+DAP_COUNT   dw 0                ; Sectors to read
+DAP_OFFSET  dw 0                ; Buffer offset
+DAP_SEGMENT dw 0                ; Buffer segment
+DAP_LBA     dd 0                ; First sector, low 32 bits
+            dd 0                ; High 32 bits
@@ -0,0 +1,31 @@
+; enter_unreal - Give DS and ES a 4GB limit while staying in real mode
+; Enters protected mode just long enough to load the flat data segment,
+; which leaves the 4GB limit in the segment caches when real mode
+; returns. Called again before each use, since a BIOS call may reset
+; the limits.
+
+[bits 16]
+
+enter_unreal:
+    pushad
+    push ds
+    push es
+    cli
+    lgdt [gdt_descriptor]
+
+    mov eax, cr0
+    or al, 1
+    mov cr0, eax
+    jmp $+2                     ; Flush the prefetch queue
+
+    mov bx, DATA_SEG
+    mov ds, bx
+    mov es, bx
+
+    and al, 0xFE
+    mov cr0, eax
+    pop es                      ; Real mode segments, 4GB limits kept
+    pop ds
+    sti
+    popad
+    ret
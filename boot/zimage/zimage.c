@@ -0,0 +1,102 @@
+/**
+ * zimage.c - Kernel decompression stub
+ * Runs in place of the kernel, from ZIMAGE_ADDR: checks the payload
+ * embedded by zimage_entry.asm and inflates it to the kernel's load
+ * address with the kernel's own LZ4 decoder (kernel/lib/lz4.c)
+ */
+
+#include "../../include/zimage.h"
+#include "../../include/lz4.h"
+#include "../../include/memory.h"
+#include "../../include/boottrace.h"
+
+#define VIDEO_MEMORY ((volatile uint16_t *)0xB8000)
+#define WHITE_ON_BLACK 0x0F
+
+// Payload from tools/mkzimage.c, placed by zimage_entry.asm
+extern const zimage_header_t zimage_payload;
+
+/**
+ * memcpy - Copy memory, for the LZ4 decoder
+ * @dest: Destination address
+ * @src: Source address
+ * @n: Number of bytes to copy
+ *
+ * The stub is linked without the kernel's memory.c. Each literal run and
+ * each match is one string instruction, which keeps the stub's time
+ * close to memory bandwidth.
+ *
+ * Return: Pointer to destination
+ */
+void *memcpy(void *dest, const void *src, uint32_t n) {
+    void *d = dest;
+
+    __asm__ __volatile__("cld; rep movsb" : "+D"(d), "+S"(src), "+c"(n) : : "memory");
+    return dest;
+}
+
+/**
+ * memset - Fill memory with a constant byte, for the LZ4 code
+ * @dest: Destination address
+ * @val: Value to set
+ * @n: Number of bytes to set
+ *
+ * Return: Pointer to destination
+ */
+void *memset(void *dest, uint8_t val, uint32_t n) {
+    void *d = dest;
+
+    __asm__ __volatile__("cld; rep stosb" : "+D"(d), "+c"(n) : "a"(val) : "memory");
+    return dest;
+}
+
+/**
+ * zimage_fail - Report a bad payload and stop
+ * @msg: Message
+ *
+ * Written over the bootloader's last message on the first line.
+ */
+static void zimage_fail(const char *msg) {
+    volatile uint16_t *video = VIDEO_MEMORY;
+
+    for (int i = 0; i < 80; i++) {
+        video[i] = *msg ? (WHITE_ON_BLACK << 8) | (uint8_t)*msg++ : (WHITE_ON_BLACK << 8) | ' ';
+    }
+    for (;;) __asm__ __volatile__("cli; hlt");
+}
+
+/**
+ * zimage_stamp - Record the end of decompression in the boot trace
+ *
+ * Only when the bootloader started a trace, so a multiboot loader's
+ * memory is left alone.
+ */
+static void zimage_stamp(void) {
+    boot_tsc_t *trace = (boot_tsc_t *)BOOT_TSC_ADDR;
+    uint32_t low, high;
+
+    if (trace->magic != BOOT_TSC_MAGIC) return;
+    __asm__ __volatile__("rdtsc" : "=a" (low), "=d" (high));
+    trace->tsc[BOOT_TSC_INFLATE] = ((uint64_t)high << 32) | low;
+}
+
+/**
+ * zimage_main - Inflate the kernel
+ *
+ * The kernel is inflated below the stub, so nothing it overwrites is
+ * still needed; its .bss is cleared by the kernel itself.
+ *
+ * Return: Kernel entry address
+ */
+uint32_t zimage_main(void) {
+    const zimage_header_t *header = &zimage_payload;
+
+    if (header->magic != ZIMAGE_MAGIC) zimage_fail("Bad compressed kernel!");
+    if (header->load + header->size > ZIMAGE_ADDR) zimage_fail("Compressed kernel too large!");
+
+    int size = lz4_decompress(header + 1, header->packed, (void *)header->load, header->size);
+    if (size != (int)header->size) zimage_fail("Corrupt compressed kernel!");
+    zimage_stamp();
+
+    return header->entry;
+}
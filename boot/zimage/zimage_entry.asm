@@ -0,0 +1,53 @@
+; Compressed Kernel Entry
+; Loaded by the boot sector in place of the kernel: inflates the kernel
+; carried behind it to the kernel's load address, then jumps to the
+; kernel with the registers it was entered with
+;
+; Assembled with -DKERNEL_LZ4='"<payload>"', the output of tools/mkzimage.c
+
+[bits 32]
+[extern zimage_main]
+[extern _edata]                 ; End of the loaded image, from zimage.ld
+[extern _end]
+[global zimage_start]
+[global zimage_payload]
+
+MULTIBOOT_MAGIC equ 0x1BADB002
+MULTIBOOT_FLAGS equ 0x00000003  ; Same as kernel_entry.asm
+STUB_STACK      equ 0x90000     ; The kernel's stack, free until it runs
+
+; Placed first in the image by zimage.ld
+section .entry progbits alloc exec nowrite
+
+zimage_start:
+jmp short zimage_entry
+
+; Same header as kernel_entry.asm, read by boot/boot.asm from the first
+; sector: the bootloader loads the stub exactly as it would the kernel
+align 4
+multiboot_header:
+    dd MULTIBOOT_MAGIC
+    dd MULTIBOOT_FLAGS
+    dd -(MULTIBOOT_MAGIC + MULTIBOOT_FLAGS)
+    dd multiboot_header         ; Header address
+    dd zimage_start             ; Load address
+    dd _edata                   ; End of the image, payload included
+    dd _end                     ; End of .bss
+    dd zimage_start             ; Entry address
+
+zimage_entry:
+mov esp, STUB_STACK
+push ebx                        ; Handed on to the kernel unchanged
+push eax
+
+call zimage_main                ; Returns the kernel entry address
+
+mov ecx, eax
+pop eax
+pop ebx
+jmp ecx
+
+section .rodata
+align 4
+zimage_payload:
+incbin KERNEL_LZ4
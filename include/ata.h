@@ -0,0 +1,80 @@
+/**
+ * ata.h - ATA (IDE) disk driver
+ * PIO and bus-master DMA transfers with LBA28/LBA48 addressing
+ */
+
+#ifndef ATA_H
+#define ATA_H
+
+#include "types.h"
+
+// Legacy channel resources
+#define ATA_PRIMARY_IO     0x1F0
+#define ATA_PRIMARY_CTRL   0x3F6
+#define ATA_PRIMARY_IRQ    14
+#define ATA_SECONDARY_IO   0x170
+#define ATA_SECONDARY_CTRL 0x376
+#define ATA_SECONDARY_IRQ  15
+
+// Task file register offsets from the I/O base
+#define ATA_REG_DATA     0
+#define ATA_REG_ERROR    1
+#define ATA_REG_FEATURES 1
+#define ATA_REG_SECCOUNT 2
+#define ATA_REG_LBA0     3
+#define ATA_REG_LBA1     4
+#define ATA_REG_LBA2     5
+#define ATA_REG_DRIVE    6
+#define ATA_REG_STATUS   7
+#define ATA_REG_COMMAND  7
+
+// Status bits
+#define ATA_SR_BSY  0x80
+#define ATA_SR_DRDY 0x40
+#define ATA_SR_DF   0x20
+#define ATA_SR_DRQ  0x08
+#define ATA_SR_ERR  0x01
+
+// Commands
+#define ATA_CMD_READ_PIO       0x20
+#define ATA_CMD_READ_PIO_EXT   0x24
+#define ATA_CMD_READ_DMA       0xC8
+#define ATA_CMD_READ_DMA_EXT   0x25
+#define ATA_CMD_WRITE_PIO      0x30
+#define ATA_CMD_WRITE_PIO_EXT  0x34
+#define ATA_CMD_WRITE_DMA      0xCA
+#define ATA_CMD_WRITE_DMA_EXT  0x35
+#define ATA_CMD_FLUSH          0xE7
+#define ATA_CMD_FLUSH_EXT      0xEA
+#define ATA_CMD_IDENTIFY       0xEC
+
+// Bus master IDE registers, offsets from the channel's base
+#define ATA_BM_COMMAND 0
+#define ATA_BM_STATUS  2
+#define ATA_BM_PRD     4
+
+#define ATA_BM_CMD_START 0x01
+#define ATA_BM_CMD_READ  0x08   // Device to memory
+#define ATA_BM_SR_ACTIVE 0x01
+#define ATA_BM_SR_ERROR  0x02
+#define ATA_BM_SR_IRQ    0x04
+
+// Sectors per command; 128 sectors is one 64KB DMA transfer
+#define ATA_MAX_SECTORS 128
+
+// Requests the scheduler may merge into one command
+#define ATA_MAX_SEGMENTS 32
+
+// Highest sector reachable with LBA28 commands
+#define ATA_LBA28_LIMIT 0x0FFFFFFFu
+
+/**
+ * ata_init - Detect ATA disks and register them as block devices
+ *
+ * Disks are named hda (primary master) to hdd (secondary slave).
+ *
+ * Return: Number of disks found
+ */
+int ata_init(void);
+
+#endif // ATA_H
@@ -0,0 +1,141 @@
+/**
+ * bcache.h - Block buffer cache
+ * Caches disk blocks between filesystems and block device drivers
+ */
+
+#ifndef BCACHE_H
+#define BCACHE_H
+
+#include "types.h"
+#include "blockdev.h"
+
+#define BCACHE_BLOCK_SIZE 1024
+#define BCACHE_BLOCK_SECTORS (BCACHE_BLOCK_SIZE / BLOCKDEV_SECTOR_SIZE)
+#define BCACHE_BUFFERS 128
+#define BCACHE_HASH_SIZE 64
+
+// Most blocks combined into one write by a flush (64KB)
+#define BCACHE_MAX_RUN 64
+
+// Write requests a flush keeps queued on a device at once
+#define BCACHE_SYNC_DEPTH 16
+
+// Prefetch reads in flight at once, one run of blocks each
+#define BCACHE_LOADS 4
+
+// Milliseconds between background flushes of dirty blocks
+#define BCACHE_FLUSH_INTERVAL 5000
+
+/**
+ * Cached block
+ */
+typedef struct bcache_buf {
+    blockdev_t *dev;
+    uint32_t block;
+    uint8_t *data;                  // BCACHE_BLOCK_SIZE bytes
+    uint16_t refcount;              // Users holding the buffer
+    bool valid;                     // Data matches or replaces the disk
+    bool dirty;                     // Must be written back
+    bool pinned;                    // In an open journal transaction, not written back
+    bool checked;                   // Matched its filesystem checksum since it was loaded
+    blockdev_request_t *loading;    // Prefetch read filling the buffer, NULL if none
+    struct bcache_buf *hash_next;   // Chain in the (device, block) hash
+    struct bcache_buf *lru_prev;    // Towards the most recently used
+    struct bcache_buf *lru_next;    // Towards the least recently used
+} bcache_buf_t;
+
+/**
+ * bcache_init - Allocate the cache buffers
+ *
+ * Return: 0 on success, -1 if out of memory
+ */
+int bcache_init(void);
+
+/**
+ * bcache_read - Get a block, reading it from the device if not cached
+ * @dev: Block device
+ * @block: Block number in BCACHE_BLOCK_SIZE units
+ *
+ * The buffer must be returned with bcache_release(). A block still
+ * being prefetched is waited for.
+ *
+ * Return: Buffer holding the block, NULL on I/O error or if every
+ *         buffer is in use
+ */
+bcache_buf_t *bcache_read(blockdev_t *dev, uint32_t block);
+
+/**
+ * bcache_get - Get a block that will be completely overwritten
+ * @dev: Block device
+ * @block: Block number
+ *
+ * The device is not read; an uncached block comes back zero-filled.
+ *
+ * Return: Buffer holding the block, NULL if every buffer is in use
+ */
+bcache_buf_t *bcache_get(blockdev_t *dev, uint32_t block);
+
+/**
+ * bcache_prefetch - Load a range of blocks into the cache
+ * @dev: Block device
+ * @block: First block
+ * @count: Number of blocks, at most BCACHE_MAX_RUN are loaded
+ *
+ * Blocks that are not cached yet are queued as one multi-sector read
+ * per run without waiting for it. Their buffers stay loading until the
+ * read completes, and a bcache_read() of one of them meanwhile waits for
+ * that read instead of issuing its own.
+ *
+ * Return: Number of blocks queued, -1 if a read could not be queued
+ */
+int bcache_prefetch(blockdev_t *dev, uint32_t block, uint32_t count);
+
+/**
+ * bcache_mark_dirty - Schedule a modified buffer for write-back
+ * @buf: Buffer
+ */
+void bcache_mark_dirty(bcache_buf_t *buf);
+
+/**
+ * bcache_release - Return a buffer obtained from bcache_read/bcache_get
+ * @buf: Buffer
+ */
+void bcache_release(bcache_buf_t *buf);
+
+/**
+ * bcache_sync - Write back dirty blocks
+ * @dev: Device to flush, NULL for all devices
+ *
+ * Adjacent dirty blocks are combined into single multi-sector writes,
+ * queued together on each device and followed by one cache flush.
+ *
+ * Return: Number of blocks written, -1 on I/O error
+ */
+int bcache_sync(blockdev_t *dev);
+
+/**
+ * bcache_invalidate - Drop every cached block of a device
+ * @dev: Device
+ *
+ * Dirty blocks are discarded, call bcache_sync() first to keep them.
+ */
+void bcache_invalidate(blockdev_t *dev);
+
+/**
+ * bcache_writeback - Periodic background flush
+ *
+ * Called from the kernel idle loop after every timer tick; flushes all
+ * dirty blocks once BCACHE_FLUSH_INTERVAL has passed since the last
+ * flush.
+ */
+void bcache_writeback(void);
+
+/**
+ * bcache_stats - Get cache statistics
+ * @hits: Receives the number of lookups served from the cache
+ * @misses: Receives the number of lookups that needed a buffer
+ * @dirty: Receives the number of dirty buffers
+ */
+void bcache_stats(uint32_t *hits, uint32_t *misses, uint32_t *dirty);
+
+#endif // BCACHE_H
@@ -0,0 +1,253 @@
+/**
+ * blockdev.h - Block device interface
+ * Common interface for disk drivers, with asynchronous submission and
+ * completion rings per device
+ *
+ * Asynchronous use:
+ *   fill in blockdev_request_t structures, post them with
+ *   blockdev_submit() and start the batch with blockdev_kick(). A
+ *   finished request either runs its callback or, without one, is
+ *   posted to the completion ring for blockdev_reap().
+ *
+ * Between the rings and the driver, each device's scheduler merges
+ * requests for adjacent sectors into one command and picks the order
+ * they start in: by arrival (BLOCKDEV_SCHED_NOOP) or by sector with
+ * deadlines against starvation (BLOCKDEV_SCHED_DEADLINE).
+ *
+ * blockdev_read() and blockdev_write() are built on the same rings and
+ * wait for their requests to finish.
+ */
+
+#ifndef BLOCKDEV_H
+#define BLOCKDEV_H
+
+#include "types.h"
+
+#define BLOCKDEV_MAX 8
+#define BLOCKDEV_NAME_MAX 8
+#define BLOCKDEV_SECTOR_SIZE 512
+
+// Requests a device can hold between submit and reap, a power of two
+#define BLOCKDEV_RING_SIZE 64
+
+// Request operations
+#define BLOCKDEV_OP_READ  0
+#define BLOCKDEV_OP_WRITE 1
+#define BLOCKDEV_OP_FLUSH 2     // Make completed writes durable
+
+// Schedulers
+#define BLOCKDEV_SCHED_NOOP     0   // Arrival order, for devices without seek cost
+#define BLOCKDEV_SCHED_DEADLINE 1   // Sector order, bounded waiting
+
+// Commands started before a waiting request goes ahead of sector order
+#define BLOCKDEV_READ_EXPIRE  8
+#define BLOCKDEV_WRITE_EXPIRE 32
+
+// Commands started in sector order after an expired request before
+// deadlines are checked again
+#define BLOCKDEV_SCHED_BATCH 16
+
+typedef struct blockdev blockdev_t;
+typedef struct blockdev_request blockdev_request_t;
+
+/**
+ * Completion callback, called with interrupts off, possibly from the
+ * device's interrupt handler
+ */
+typedef void (*blockdev_callback_t)(blockdev_request_t *req);
+
+/**
+ * Asynchronous request; owned by the driver from submit until it is
+ * reaped or its callback has run
+ */
+struct blockdev_request {
+    uint8_t op;                     // BLOCKDEV_OP_*
+    uint64_t lba;                   // First sector
+    uint32_t count;                 // Sectors, at most the device's max_sectors
+    void *buffer;                   // count * BLOCKDEV_SECTOR_SIZE bytes, 2-byte aligned
+    blockdev_callback_t callback;   // NULL to post to the completion ring instead
+    void *data;                     // For the submitter
+    blockdev_t *dev;                // Set by blockdev_submit()
+    volatile int result;            // 0 on success, -1 on error, once done
+    volatile bool done;
+    blockdev_request_t *next;       // Driver queue link
+    blockdev_request_t *chain;      // Requests merged behind this one, in sector order
+    uint32_t total;                 // Sectors of the whole chain, on its first request
+    blockdev_request_t *sched_next; // Scheduler queue link
+    uint32_t seq;                   // Arrival number
+    uint32_t deadline;              // Command count by which it should have started
+};
+
+/**
+ * Driver operations. The driver calls blockdev_complete() for every
+ * request it accepted, possibly before submit returns. A submitted
+ * request may carry a chain of merged requests that continue its
+ * sectors in their own buffers; it is one command of total sectors.
+ */
+typedef struct {
+    // Start a request; return -1 to leave it queued until one completes
+    int (*submit)(blockdev_t *dev, blockdev_request_t *req);
+    // Make the requests started since the last kick visible, optional
+    void (*kick)(blockdev_t *dev);
+    // Complete finished requests without waiting for an interrupt, optional
+    void (*poll)(blockdev_t *dev);
+    // Drop the accepted command holding a request, completing it with -1;
+    // return -1 if the hardware already has it. Optional
+    int (*cancel)(blockdev_t *dev, blockdev_request_t *req);
+} blockdev_ops_t;
+
+/**
+ * Registered block device
+ */
+struct blockdev {
+    char name[BLOCKDEV_NAME_MAX];
+    uint64_t sectors;           // Size in BLOCKDEV_SECTOR_SIZE sectors
+    uint32_t max_sectors;       // Largest single request or merged command
+    uint32_t max_segments;      // Buffers one command can take, 1 disables merging
+    uint8_t sched;              // BLOCKDEV_SCHED_*
+    const blockdev_ops_t *ops;
+    void *driver;               // Driver private data
+
+    // Submission ring: posted, not yet started
+    blockdev_request_t *sq[BLOCKDEV_RING_SIZE];
+    uint32_t sq_head;
+    uint32_t sq_tail;
+
+    // Completion ring: finished requests without a callback
+    blockdev_request_t *cq[BLOCKDEV_RING_SIZE];
+    uint32_t cq_head;
+    uint32_t cq_tail;
+
+    // Scheduler: requests taken off the submission ring, not yet started
+    blockdev_request_t *queue;
+    uint32_t seq;               // Arrival number of the next request
+    uint32_t dispatches;        // Commands started
+    uint32_t batch;             // Commands left before deadlines count again
+    uint64_t next_lba;          // Sector after the last command started
+
+    uint32_t outstanding;       // Submitted and not yet reaped
+    uint32_t inflight;          // Started and not yet completed
+    bool flushing;              // A flush is in flight, nothing else starts
+    bool starting;              // Inside blockdev_start()
+};
+
+/**
+ * blockdev_register - Make a device available by name
+ * @dev: Device, must stay valid while registered
+ *
+ * Return: 0 on success, -1 if the table is full
+ */
+int blockdev_register(blockdev_t *dev);
+
+/**
+ * blockdev_get - Find a device by name
+ * @name: Device name, such as "hda"
+ *
+ * Return: Device, NULL if not registered
+ */
+blockdev_t *blockdev_get(const char *name);
+
+/**
+ * blockdev_at - Get a registered device by position
+ * @index: Position in registration order
+ *
+ * Return: Device, NULL past the last one
+ */
+blockdev_t *blockdev_at(int index);
+
+/**
+ * blockdev_submit - Post a request to a device's submission ring
+ * @dev: Device
+ * @req: Request with op, lba, count, buffer and callback filled in
+ *
+ * The request is not started until blockdev_kick(), so several can be
+ * handed to the driver as one batch. The scheduler may start requests
+ * in another order, but never one before an earlier overlapping request
+ * when either writes; requests in flight together may still complete in
+ * any order. A flush starts only once every earlier request has
+ * completed, and later ones wait for it.
+ *
+ * Return: 0 on success, -1 if the request is invalid or the ring is full
+ */
+int blockdev_submit(blockdev_t *dev, blockdev_request_t *req);
+
+/**
+ * blockdev_cancel - Withdraw a request that has not started
+ * @dev: Device
+ * @req: Submitted request
+ *
+ * A request still on the submission ring or in the scheduler completes
+ * at once with -1. One already handed to the driver does too if the
+ * driver can drop its command before the hardware sees it; requests
+ * merged into that command fail with it.
+ *
+ * Return: 0 if the request is done, -1 if the hardware still has it
+ */
+int blockdev_cancel(blockdev_t *dev, blockdev_request_t *req);
+
+/**
+ * blockdev_kick - Start the requests posted to a device
+ * @dev: Device
+ */
+void blockdev_kick(blockdev_t *dev);
+
+/**
+ * blockdev_reap - Take finished requests off the completion ring
+ * @dev: Device
+ * @done: Receives the finished requests
+ * @max: Size of done
+ *
+ * Polls the driver first, so completions arrive with interrupts off.
+ *
+ * Return: Number of requests stored in done
+ */
+int blockdev_reap(blockdev_t *dev, blockdev_request_t **done, int max);
+
+/**
+ * blockdev_wait - Wait for a submitted request to finish
+ * @dev: Device
+ * @req: Request
+ *
+ * Starts any posted requests first. Returns only once the device is done
+ * with the request, so it may live on the caller's stack: on timeout the
+ * request is cancelled, and if the hardware already has it the wait goes
+ * on until the driver completes it. A request without a callback must
+ * still be reaped afterwards.
+ *
+ * Return: The request's result, -1 on timeout
+ */
+int blockdev_wait(blockdev_t *dev, blockdev_request_t *req);
+
+/**
+ * blockdev_complete - Finish a request, called by drivers
+ * @dev: Device
+ * @req: Request accepted by the driver's submit operation, with its chain
+ * @result: 0 on success, -1 on error
+ *
+ * Must be called with interrupts off.
+ */
+void blockdev_complete(blockdev_t *dev, blockdev_request_t *req, int result);
+
+/**
+ * blockdev_read - Read sectors from a device
+ * @dev: Device
+ * @lba: First sector
+ * @count: Number of sectors
+ * @buffer: Buffer of count * BLOCKDEV_SECTOR_SIZE bytes
+ *
+ * Return: 0 on success, -1 on error
+ */
+int blockdev_read(blockdev_t *dev, uint64_t lba, uint32_t count, void *buffer);
+
+/**
+ * blockdev_write - Write sectors to a device and flush its cache
+ * @dev: Device
+ * @lba: First sector
+ * @count: Number of sectors
+ * @buffer: Data of count * BLOCKDEV_SECTOR_SIZE bytes
+ *
+ * Return: 0 on success, -1 on error
+ */
+int blockdev_write(blockdev_t *dev, uint64_t lba, uint32_t count, const void *buffer);
+
+#endif // BLOCKDEV_H
@@ -0,0 +1,67 @@
+/**
+ * boottrace.h - Boot-phase timing
+ * Records a time-stamp counter value at the end of each boot phase, from
+ * the boot sector to the shell, so the cost of every stage of startup
+ * can be read back with the bootstat command or on the serial console.
+ *
+ * The bootloader, running before the kernel has any memory of its own,
+ * stamps its phases into a boot_tsc_t at BOOT_TSC_ADDR; the zimage stub
+ * adds one more. boot_trace_init() copies them into the kernel's table.
+ * The TSC starts at zero at reset, so the first phase is the firmware.
+ */
+
+#ifndef BOOTTRACE_H
+#define BOOTTRACE_H
+
+#include "types.h"
+
+// Bootloader handover, below the boot sector; also set in boot/boot.asm
+#define BOOT_TSC_ADDR  0x7000
+#define BOOT_TSC_MAGIC 0x43535442   // "BTSC"
+
+// Bootloader slots, each stamped at the end of its phase
+#define BOOT_TSC_START   0      // Firmware done, boot sector running
+#define BOOT_TSC_STAGE2  1      // Second stage read
+#define BOOT_TSC_KERNEL  2      // Kernel image read
+#define BOOT_TSC_INITRD  3      // Boot archive read
+#define BOOT_TSC_PMODE   4      // Protected mode entered
+#define BOOT_TSC_INFLATE 5      // Kernel inflated by the zimage stub
+#define BOOT_TSC_SLOTS   6
+
+// Phases the kernel's table holds, bootloader ones included
+#define BOOT_TRACE_MAX 32
+
+/**
+ * Bootloader handover; slots left at zero were not reached
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t reserved;
+    uint64_t tsc[BOOT_TSC_SLOTS];
+} boot_tsc_t;
+
+/**
+ * boot_trace_init - Start the kernel's boot trace
+ * @magic: EAX the kernel was entered with
+ *
+ * Takes over the bootloader's stamps unless a multiboot loader started
+ * the kernel, then records the kernel entry. Call first thing.
+ */
+void boot_trace_init(uint32_t magic);
+
+/**
+ * boot_trace - Record the end of a boot phase
+ * @phase: Name of the phase, a string that outlives the trace
+ */
+void boot_trace(const char *phase);
+
+/**
+ * boot_trace_report - Format the boot trace as a table
+ * @emit: Called with each line, newline included
+ *
+ * Each phase is shown with its duration and its end time since reset,
+ * in milliseconds. Needs the TSC calibrated by timer_init().
+ */
+void boot_trace_report(void (*emit)(const char *line));
+
+#endif // BOOTTRACE_H
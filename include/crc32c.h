@@ -0,0 +1,37 @@
+/**
+ * crc32c.h - CRC32C (Castagnoli) checksums
+ * Uses the SSE4.2 crc32 instruction when available, tables otherwise
+ */
+
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include "types.h"
+
+/**
+ * crc32c_init - Pick the implementation and build the lookup tables
+ *
+ * Must run before the first crc32c() call.
+ */
+void crc32c_init(void);
+
+/**
+ * crc32c_hw - Check whether checksums use the SSE4.2 instruction
+ *
+ * Return: true if CPUID reported SSE4.2
+ */
+bool crc32c_hw(void);
+
+/**
+ * crc32c - Checksum a buffer
+ * @crc: Checksum of the preceding data, 0 to start
+ * @data: Data
+ * @len: Length in bytes
+ *
+ * crc32c(crc32c(0, a, n), b, m) equals the checksum of a followed by b.
+ *
+ * Return: CRC32C of everything checksummed so far
+ */
+uint32_t crc32c(uint32_t crc, const void *data, uint32_t len);
+
+#endif // CRC32C_H
@@ -14,6 +14,8 @@ void desktop_init(void);
 
 /**
  * desktop_draw - Draw the desktop
+ *
+ * The whole desktop is drawn as one frame_pump() frame.
  */
 void desktop_draw(void);
 
@@ -1,24 +1,72 @@
 /**
  * filesystem.h - Simple in-memory file system
- * Provides basic file operations
+ * Provides basic file and directory operations
  */
 
 #ifndef FILESYSTEM_H
 #define FILESYSTEM_H
 
 #include "types.h"
+#include "vfs.h"
 
-#define MAX_FILES 32
+#define MAX_FILES 64
 #define MAX_FILENAME 32
-#define MAX_FILE_SIZE 1024
+
+// Longest path kept in the dentry cache
+#define FS_PATH_MAX 128
+
+// File data lives in extents that double in size: 256, 512, 1K, ...
+#define FS_EXTENT_BASE 256
+#define FS_MAX_EXTENTS 14
+#define MAX_FILE_SIZE (FS_EXTENT_BASE * ((1u << FS_MAX_EXTENTS) - 1))
+
+// Compressed files keep their data in LZ4 chunks of this many bytes
+#define FS_CHUNK_SIZE 4096
+
+// Plain file data is checksummed (CRC32C) in blocks of this many bytes
+#define FS_CSUM_BLOCK 4096
+
+// Name index slots, a power of two at least twice MAX_FILES
+#define FS_INDEX_SIZE 128
+
+// Dentry cache slots for resolved paths
+#define FS_DCACHE_SIZE 32
+
+// Entry types
+#define FS_TYPE_FILE 0
+#define FS_TYPE_DIR  1
+
+// File flags
+#define FS_FLAG_COMPRESS 0x01   // Data is stored as LZ4 chunks
+
+/**
+ * Chunk of a compressed file, followed by its stored bytes. A chunk
+ * whose data did not compress is stored raw, with stored == length.
+ */
+typedef struct {
+    uint16_t stored;        // Bytes following the header
+    uint16_t length;        // Bytes of file data it decodes to
+    uint32_t crc;           // CRC32C of the stored bytes
+} fs_chunk_t;
 
 /**
  * File structure
  */
 typedef struct {
     char name[MAX_FILENAME];
-    char content[MAX_FILE_SIZE];
-    uint32_t size;
+    uint32_t size;          // Bytes for files, entry count for directories
+    uint32_t hash;          // Hash of parent and name, checked before comparing names
+    uint32_t generation;    // Bumped when the slot is reused
+    char **extents;         // Extent table, allocated on first write
+    const char *mapped;     // Read-only data in the boot archive, until the first write
+    uint32_t *csums;        // CRC32C of each FS_CSUM_BLOCK of a plain file
+    uint16_t csum_slots;    // Entries in the checksum table
+    fs_chunk_t **chunks;    // Chunk table of a compressed file
+    uint16_t chunk_slots;   // Entries in the chunk table
+    uint8_t flags;          // FS_FLAG_*
+    int16_t parent;         // Slot of the containing directory
+    uint8_t extent_count;   // Extents allocated so far
+    uint8_t type;           // FS_TYPE_FILE or FS_TYPE_DIR
     bool in_use;
 } file_t;
 
@@ -29,51 +77,153 @@ void fs_init(void);
 
 /**
  * fs_create - Create a new file
- * @filename: Name of the file to create
+ * @path: Path of the file to create
+ *
+ * Return: 0 on success, -1 on error
+ */
+int fs_create(const char *path);
+
+/**
+ * fs_create_mapped - Create a file whose data stays in read-only memory
+ * @path: Path of the file to create
+ * @data: File contents, must stay valid and unchanged
+ * @size: Number of bytes
+ *
+ * Reads are served from @data; the first change copies it into the
+ * file's own extents.
+ *
+ * Return: 0 on success, -1 on error
+ */
+int fs_create_mapped(const char *path, const void *data, uint32_t size);
+
+/**
+ * fs_mkdir - Create a new directory
+ * @path: Path of the directory to create
  *
  * Return: 0 on success, -1 on error
  */
-int fs_create(const char *filename);
+int fs_mkdir(const char *path);
+
+/**
+ * fs_rmdir - Delete an empty directory
+ * @path: Path of the directory
+ *
+ * Return: 0 on success, -1 if missing, not empty or the working directory
+ */
+int fs_rmdir(const char *path);
+
+/**
+ * fs_chdir - Change the working directory
+ * @path: Path of the new working directory
+ *
+ * Return: 0 on success, -1 if not a directory
+ */
+int fs_chdir(const char *path);
+
+/**
+ * fs_getcwd - Get the absolute path of the working directory
+ * @buffer: Buffer to store the path
+ * @size: Size of buffer
+ *
+ * Return: 0 on success, -1 if the path does not fit
+ */
+int fs_getcwd(char *buffer, uint32_t size);
 
 /**
  * fs_write - Write content to a file
- * @filename: Name of the file
+ * @path: Path of the file
  * @content: Content to write
  *
  * Return: 0 on success, -1 on error
  */
-int fs_write(const char *filename, const char *content);
+int fs_write(const char *path, const char *content);
 
 /**
  * fs_read - Read content from a file
- * @filename: Name of the file
+ * @path: Path of the file
  * @buffer: Buffer to store content
  * @size: Size of buffer
  *
  * Return: Number of bytes read, -1 on error
  */
-int fs_read(const char *filename, char *buffer, uint32_t size);
+int fs_read(const char *path, char *buffer, uint32_t size);
+
+/**
+ * fs_pread - Read part of a file
+ * @path: Path of the file
+ * @buffer: Buffer to store data, not NUL-terminated
+ * @offset: Byte offset to start reading at
+ * @len: Maximum number of bytes to read
+ *
+ * Return: Number of bytes read (0 at end of file), -1 on error
+ */
+int fs_pread(const char *path, void *buffer, uint32_t offset, uint32_t len);
+
+/**
+ * fs_pwrite - Write part of a file
+ * @path: Path of the file
+ * @data: Data to write
+ * @offset: Byte offset to start writing at
+ * @len: Number of bytes to write
+ *
+ * Writing past the end grows the file, any gap reads back as zeros.
+ *
+ * Return: Number of bytes written, -1 on error
+ */
+int fs_pwrite(const char *path, const void *data, uint32_t offset, uint32_t len);
+
+/**
+ * fs_append - Append data to the end of a file
+ * @path: Path of the file
+ * @data: Data to append
+ * @len: Number of bytes to append
+ *
+ * Return: Number of bytes written, -1 on error
+ */
+int fs_append(const char *path, const void *data, uint32_t len);
+
+/**
+ * fs_size - Get the size of a file
+ * @path: Path of the file
+ *
+ * Return: Size in bytes, -1 if not found
+ */
+int fs_size(const char *path);
 
 /**
  * fs_delete - Delete a file
- * @filename: Name of the file to delete
+ * @path: Path of the file to delete
  *
  * Return: 0 on success, -1 on error
  */
-int fs_delete(const char *filename);
+int fs_delete(const char *path);
 
 /**
- * fs_list - List all files
+ * fs_list - List the entries of a directory
+ * @path: Path of the directory, NULL or empty for the working directory
+ *
+ * Return: 0 on success, -1 if not a directory
  */
-void fs_list(void);
+int fs_list(const char *path);
 
 /**
- * fs_exists - Check if a file exists
- * @filename: Name of the file
+ * fs_exists - Check if a file or directory exists
+ * @path: Path to check
  *
- * Return: true if file exists, false otherwise
+ * Return: true if it exists, false otherwise
  */
-bool fs_exists(const char *filename);
+bool fs_exists(const char *path);
+
+/**
+ * fs_is_dir - Check if a path is a directory
+ * @path: Path to check
+ *
+ * Return: true if it is a directory, false otherwise
+ */
+bool fs_is_dir(const char *path);
+
+// Backend operations for mounting the RAM filesystem in the VFS
+extern const vfs_ops_t ramfs_ops;
 
 #endif // FILESYSTEM_H
 
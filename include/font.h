@@ -6,10 +6,18 @@
 #define FONT_H
 
 #include "types.h"
+#include "vga.h"
 
 #define FONT_WIDTH 1
 #define FONT_HEIGHT 1
 
+// Bitmap glyph size used when drawing into a pixel surface
+#define FONT_GLYPH_WIDTH 8
+#define FONT_GLYPH_HEIGHT 8
+
+// Background value that leaves the pixels behind a glyph untouched
+#define FONT_TRANSPARENT 0xFF
+
 /**
  * font_draw_char - Draw a character
  * @c: Character to draw
@@ -30,5 +38,32 @@ void font_draw_char(char c, int x, int y, uint8_t color, uint8_t bg_color);
  */
 void font_draw_string(const char *str, int x, int y, uint8_t color, uint8_t bg_color);
 
+/**
+ * font_blit_char - Draw a bitmap glyph into a pixel surface
+ * @surface: Destination surface
+ * @c: Character to draw
+ * @x: X position in pixels
+ * @y: Y position in pixels
+ * @color: Text color
+ * @bg_color: Background color (FONT_TRANSPARENT for none)
+ *
+ * Opaque glyphs come from a cache of glyphs pre-expanded for the color
+ * pair, so each glyph row is written with two 32-bit stores.
+ */
+void font_blit_char(vga_surface_t *surface, char c, int x, int y,
+                    uint8_t color, uint8_t bg_color);
+
+/**
+ * font_blit_string - Draw a string of bitmap glyphs into a pixel surface
+ * @surface: Destination surface
+ * @str: String to draw
+ * @x: X position in pixels
+ * @y: Y position in pixels
+ * @color: Text color
+ * @bg_color: Background color (FONT_TRANSPARENT for none)
+ */
+void font_blit_string(vga_surface_t *surface, const char *str, int x, int y,
+                      uint8_t color, uint8_t bg_color);
+
 #endif // FONT_H
 
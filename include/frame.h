@@ -0,0 +1,52 @@
+/**
+ * frame.h - GUI frame loop interface
+ * Batches invalidations into frames presented at vertical retrace
+ */
+
+#ifndef FRAME_H
+#define FRAME_H
+
+#include "types.h"
+
+// Frame timing statistics
+typedef struct {
+    uint32_t frames;        // Frames presented since frame_init()
+    uint32_t fps;           // Frames presented during the last second
+    uint32_t layout_us;     // Layout time of the last frame
+    uint32_t raster_us;     // Drawing time of the last frame
+    uint32_t present_us;    // Copy-to-screen time of the last frame
+    uint32_t worst_us;      // Slowest frame (excluding retrace wait) last second
+} frame_stats_t;
+
+/**
+ * frame_init - Reset the frame loop and its statistics
+ */
+void frame_init(void);
+
+/**
+ * frame_pump - Produce a frame if anything changed
+ *
+ * Lays out and draws everything invalidated since the last frame,
+ * waits for the next vertical retrace and presents the back buffer. At
+ * most one frame is presented per retrace. The login and desktop
+ * screens call it at the end of each key handler and redraw; once the
+ * GUI has an idle loop of its own, that loop should call it instead.
+ *
+ * Return: true if a frame was presented
+ */
+bool frame_pump(void);
+
+/**
+ * frame_set_overlay - Show or hide the frame-time overlay
+ * @paint: Draws the overlay text on top of each frame, NULL to hide it
+ */
+void frame_set_overlay(void (*paint)(const char *text));
+
+/**
+ * frame_get_stats - Get frame timing statistics
+ *
+ * Return: Current statistics
+ */
+const frame_stats_t *frame_get_stats(void);
+
+#endif // FRAME_H
@@ -7,13 +7,23 @@
 
 #include "types.h"
 
-// Window structure
+// Rectangle in screen coordinates
 typedef struct {
     int x, y;
     int width, height;
+} rect_t;
+
+struct widget;
+
+// Window structure
+typedef struct window {
+    int x, y;
+    int width, height;
     char title[64];
     bool visible;
     bool active;
+    struct widget *root;                  // Widget tree, NULL if none
+    void (*on_paint)(struct window *win); // Draws extra window contents
 } window_t;
 
 // Button structure
@@ -47,6 +57,29 @@ typedef struct {
     bool visible;
 } label_t;
 
+// Widget kinds in the retained widget tree
+typedef enum {
+    WIDGET_CONTAINER,
+    WIDGET_WINDOW,
+    WIDGET_BUTTON,
+    WIDGET_TEXTBOX,
+    WIDGET_LABEL
+} widget_type_t;
+
+// Node of the retained widget tree
+typedef struct widget {
+    widget_type_t type;
+    void *data;                  // window_t, button_t, textbox_t or label_t
+    rect_t bounds;               // Layout rectangle in screen coordinates
+    rect_t painted;              // Bounds at the time of the last paint
+    struct widget *parent;
+    struct widget *first_child;
+    struct widget *last_child;
+    struct widget *next_sibling;
+    bool dirty;                  // Widget and its subtree need repainting
+    bool child_dirty;            // Some descendant needs repainting
+} widget_t;
+
 /**
  * gui_init - Initialize GUI system
  */
@@ -99,5 +132,111 @@ void gui_textbox_add_char(textbox_t *box, char c);
  */
 void gui_textbox_backspace(textbox_t *box);
 
+/**
+ * gui_rect_intersect - Intersect two rectangles
+ * @a: First rectangle
+ * @b: Second rectangle
+ * @out: Receives the intersection
+ *
+ * Return: true if the intersection is not empty
+ */
+bool gui_rect_intersect(const rect_t *a, const rect_t *b, rect_t *out);
+
+/**
+ * gui_widget_init - Initialize a widget tree node
+ * @w: Node to initialize
+ * @type: Widget kind
+ * @data: Widget structure the node wraps (NULL for containers)
+ *
+ * The layout rectangle is taken from the wrapped widget. Containers
+ * start empty; set their bounds with gui_widget_set_bounds().
+ */
+void gui_widget_init(widget_t *w, widget_type_t type, void *data);
+
+/**
+ * gui_widget_set_bounds - Set the layout rectangle of a node
+ * @w: Node
+ * @x, y: Top-left corner
+ * @width, height: Dimensions
+ */
+void gui_widget_set_bounds(widget_t *w, int x, int y, int width, int height);
+
+/**
+ * gui_widget_add_child - Append a child on top of its siblings
+ * @parent: Parent node
+ * @child: Child node
+ */
+void gui_widget_add_child(widget_t *parent, widget_t *child);
+
+/**
+ * gui_widget_invalidate - Mark a widget as needing a repaint
+ * @w: Widget whose state changed
+ *
+ * Ancestors are flagged so the layout and render passes can find the
+ * widget without visiting clean subtrees.
+ */
+void gui_widget_invalidate(widget_t *w);
+
+/**
+ * gui_widget_is_invalid - Check if a tree has anything to repaint
+ * @root: Tree root
+ *
+ * Return: true if the root or any descendant is invalid
+ */
+bool gui_widget_is_invalid(widget_t *root);
+
+/**
+ * gui_layout - Refresh the layout rectangles of invalid widgets
+ * @root: Tree root
+ *
+ * Picks up position, size and text changes from the wrapped widgets.
+ * Must run before gui_render() so damaged areas are known.
+ */
+void gui_layout(widget_t *root);
+
+/**
+ * gui_widget_paint - Paint a whole tree inside the current clip
+ * @root: Tree root
+ */
+void gui_widget_paint(widget_t *root);
+
+/**
+ * gui_render - Repaint only the invalid parts of a tree
+ * @root: Tree root
+ *
+ * Drawing stays inside the current clip. Invalid flags are left set,
+ * so the caller can render once per clip rectangle before clearing
+ * them with gui_validate().
+ */
+void gui_render(widget_t *root);
+
+/**
+ * gui_validate - Clear the invalid flags of a tree
+ * @root: Tree root
+ */
+void gui_validate(widget_t *root);
+
+/**
+ * gui_widget_at - Find the topmost widget at a point
+ * @root: Tree root
+ * @x: X coordinate
+ * @y: Y coordinate
+ *
+ * Subtrees whose bounds do not contain the point are skipped.
+ *
+ * Return: Deepest visible widget under the point, NULL if none
+ */
+widget_t *gui_widget_at(widget_t *root, int x, int y);
+
+/**
+ * gui_widget_click - Deliver a click to the widget under a point
+ * @root: Tree root
+ * @x: X coordinate
+ * @y: Y coordinate
+ *
+ * Return: Widget that was hit, NULL if none
+ */
+widget_t *gui_widget_click(widget_t *root, int x, int y);
+
 #endif // GUI_H
 
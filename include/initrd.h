@@ -0,0 +1,66 @@
+/**
+ * initrd.h - Boot-time archive of files
+ * Packed on the host by tools/mkinitrd.c and appended to the OS image
+ *
+ * Archive layout:
+ *   header         magic, entry count, total size and a CRC32C of
+ *                  everything after the header
+ *   entries        one initrd_entry_t per file or directory, parents
+ *                  before their contents
+ *   data           file contents, each starting on an INITRD_ALIGN
+ *                  boundary
+ *
+ * The bootloader reads the archive to INITRD_ADDR. Its files are added
+ * to the RAM filesystem without copying: they are served straight from
+ * the archive until they are first modified.
+ */
+
+#ifndef INITRD_H
+#define INITRD_H
+
+#include "types.h"
+
+#define INITRD_MAGIC 0x44524E49     // "INRD"
+
+// Physical address the bootloader loads the archive to, below the stack
+#define INITRD_ADDR 0x30000
+#define INITRD_MAX_SIZE 0x50000
+
+#define INITRD_ALIGN 16
+#define INITRD_PATH_MAX 52
+
+// Entry types
+#define INITRD_TYPE_FILE 1
+#define INITRD_TYPE_DIR  2
+
+/**
+ * Archive header
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t count;             // Entries following the header
+    uint32_t size;              // Bytes in the archive, header included
+    uint32_t checksum;          // CRC32C of the size - 16 bytes after the header
+} __attribute__((packed)) initrd_header_t;
+
+/**
+ * Archive entry
+ */
+typedef struct {
+    uint32_t offset;            // Data offset from the start of the archive
+    uint32_t size;              // Bytes of data, 0 for directories
+    uint32_t type;              // INITRD_TYPE_*
+    char path[INITRD_PATH_MAX]; // Relative to the root, NUL-terminated
+} __attribute__((packed)) initrd_entry_t;
+
+/**
+ * initrd_load - Add the files of the boot archive to the RAM filesystem
+ *
+ * Must run after fs_init() and crc32c_init().
+ *
+ * Return: Number of entries added, 0 if there is no archive, -1 if the
+ *         archive is corrupt
+ */
+int initrd_load(void);
+
+#endif // INITRD_H
@@ -15,6 +15,9 @@ typedef struct {
     uint32_t eip, cs, eflags, useresp, ss;          // Pushed by processor automatically
 } registers_t;
 
+// Handler for one hardware interrupt line
+typedef void (*irq_handler_t)(registers_t regs);
+
 /**
  * isr_init - Initialize Interrupt Service Routines
  */
@@ -32,5 +35,25 @@ void isr_handler(registers_t regs);
  */
 void irq_handler(registers_t regs);
 
+/**
+ * irq_register_handler - Install the handler for an IRQ line
+ * @irq: IRQ number (0-15)
+ * @handler: Function called for the IRQ, NULL to remove
+ */
+void irq_register_handler(uint8_t irq, irq_handler_t handler);
+
+/**
+ * irq_save - Disable interrupts
+ *
+ * Return: Previous EFLAGS, for irq_restore()
+ */
+uint32_t irq_save(void);
+
+/**
+ * irq_restore - Re-enable interrupts if irq_save() found them enabled
+ * @flags: EFLAGS returned by irq_save()
+ */
+void irq_restore(uint32_t flags);
+
 #endif // ISR_H
 
@@ -14,6 +14,8 @@ void login_init(void);
 
 /**
  * login_draw - Draw the login screen
+ *
+ * The whole screen is drawn as one frame_pump() frame.
  */
 void login_draw(void);
 
@@ -0,0 +1,45 @@
+/**
+ * lz4.h - LZ4 block compression
+ * Byte-oriented LZ77 codec with a fast, bounds-checked decoder
+ */
+
+#ifndef LZ4_H
+#define LZ4_H
+
+#include "types.h"
+
+// Largest input lz4_compress() accepts; match offsets are 16 bits
+#define LZ4_MAX_INPUT 65535
+
+// Worst-case compressed size of @n bytes of incompressible input
+#define LZ4_COMPRESS_BOUND(n) ((n) + (n) / 255 + 16)
+
+/**
+ * lz4_compress - Compress a block
+ * @src: Input data
+ * @len: Input length, at most LZ4_MAX_INPUT
+ * @dst: Output buffer
+ * @capacity: Size of @dst
+ *
+ * Produces a raw LZ4 block (no frame header). Pass a @capacity smaller
+ * than @len to only accept output that actually saves space.
+ *
+ * Return: Compressed length, -1 if the output does not fit
+ */
+int lz4_compress(const void *src, uint32_t len, void *dst, uint32_t capacity);
+
+/**
+ * lz4_decompress - Decompress a block
+ * @src: LZ4 block
+ * @len: Block length
+ * @dst: Output buffer
+ * @capacity: Size of @dst
+ *
+ * Every length and offset is checked, so a corrupt block cannot write
+ * outside @dst or read outside @src.
+ *
+ * Return: Decompressed length, -1 if the block is malformed or too large
+ */
+int lz4_decompress(const void *src, uint32_t len, void *dst, uint32_t capacity);
+
+#endif // LZ4_H
@@ -7,11 +7,21 @@
 
 #include "types.h"
 
+// Kernel heap, from the end of the kernel image the bootloader loads at 1MB
+#define HEAP_END   0x800000
+
+/**
+ * heap_init - Set up the kernel heap
+ * @limit: End of the RAM above 1MB, 0 if unknown; the heap stays below
+ *         both this and HEAP_END
+ */
+void heap_init(uint32_t limit);
+
 /**
  * kmalloc - Allocate kernel memory
  * @size: Number of bytes to allocate
  *
- * Return: Pointer to allocated memory
+ * Return: Pointer to allocated memory, NULL if the heap is exhausted
  */
 void *kmalloc(uint32_t size);
 
@@ -19,7 +29,8 @@ void *kmalloc(uint32_t size);
  * kmalloc_aligned - Allocate page-aligned kernel memory
  * @size: Number of bytes to allocate
  *
- * Return: Pointer to allocated memory (page-aligned)
+ * Return: Pointer to allocated memory (page-aligned), NULL if the
+ *         heap is exhausted
  */
 void *kmalloc_aligned(uint32_t size);
 
@@ -29,6 +40,13 @@ void *kmalloc_aligned(uint32_t size);
  */
 void kfree(void *ptr);
 
+/**
+ * heap_used_bytes - Get the number of bytes currently allocated
+ *
+ * Return: Allocated bytes, block headers included
+ */
+uint32_t heap_used_bytes(void);
+
 /**
  * memcpy - Copy memory from source to destination
  * @dest: Destination address
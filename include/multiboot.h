@@ -0,0 +1,103 @@
+/**
+ * multiboot.h - Multiboot (version 1) boot information
+ * The kernel carries a multiboot header (kernel_entry.asm), so GRUB or
+ * `qemu -kernel` can load the ELF image directly; the boot sector path
+ * reads the same header. A multiboot loader passes the command line, the
+ * memory map and the initrd as a module, which are copied out before the
+ * heap can overwrite them.
+ */
+
+#ifndef MULTIBOOT_H
+#define MULTIBOOT_H
+
+#include "types.h"
+
+// In EAX at entry when a multiboot loader started the kernel
+#define MULTIBOOT_BOOTLOADER_MAGIC 0x2BADB002
+
+// multiboot_info_t flags
+#define MULTIBOOT_INFO_MEMORY  0x001    // mem_lower and mem_upper are valid
+#define MULTIBOOT_INFO_CMDLINE 0x004
+#define MULTIBOOT_INFO_MODS    0x008
+#define MULTIBOOT_INFO_MMAP    0x040
+
+// Memory map entry types
+#define MULTIBOOT_MEMORY_AVAILABLE 1
+
+// Longest boot command line kept
+#define BOOT_CMDLINE_MAX 256
+
+/**
+ * Boot information passed by the loader in EBX
+ */
+typedef struct {
+    uint32_t flags;
+    uint32_t mem_lower;         // KB below 1MB
+    uint32_t mem_upper;         // KB from 1MB to the first hole
+    uint32_t boot_device;
+    uint32_t cmdline;           // Physical address of a NUL-terminated string
+    uint32_t mods_count;
+    uint32_t mods_addr;         // Physical address of multiboot_module_t[mods_count]
+    uint32_t syms[4];
+    uint32_t mmap_length;       // Bytes of memory map
+    uint32_t mmap_addr;         // Physical address of the first multiboot_mmap_t
+} __attribute__((packed)) multiboot_info_t;
+
+/**
+ * Module loaded with the kernel, such as the initrd
+ */
+typedef struct {
+    uint32_t start;
+    uint32_t end;
+    uint32_t string;
+    uint32_t reserved;
+} __attribute__((packed)) multiboot_module_t;
+
+/**
+ * Memory map entry; size does not count itself
+ */
+typedef struct {
+    uint32_t size;
+    uint64_t addr;
+    uint64_t len;
+    uint32_t type;              // MULTIBOOT_MEMORY_*
+} __attribute__((packed)) multiboot_mmap_t;
+
+/**
+ * multiboot_init - Take what is needed from the boot information
+ * @magic: EAX at kernel entry
+ * @info: EBX at kernel entry
+ *
+ * Does nothing unless a multiboot loader started the kernel. The first
+ * module, if any, is copied to INITRD_ADDR, where the boot sector path
+ * would have loaded the initrd. Must run before heap_init().
+ */
+void multiboot_init(uint32_t magic, const multiboot_info_t *info);
+
+/**
+ * boot_cmdline - Get the kernel command line
+ *
+ * Return: Command line, empty if there is none
+ */
+const char *boot_cmdline(void);
+
+/**
+ * boot_param - Look up a parameter on the command line
+ * @name: Parameter name
+ * @value: Receives the value, empty for a bare name; truncated to fit
+ * @size: Size of value
+ *
+ * Parameters are separated by spaces, written as name=value or name.
+ *
+ * Return: 0 if the parameter is given, -1 otherwise
+ */
+int boot_param(const char *name, char *value, uint32_t size);
+
+/**
+ * boot_memory_end - Get the end of the RAM that starts at 1MB
+ *
+ * Return: Physical address, 0 if the loader did not say
+ */
+uint32_t boot_memory_end(void);
+
+#endif // MULTIBOOT_H
@@ -0,0 +1,94 @@
+/**
+ * pci.h - PCI configuration space access
+ */
+
+#ifndef PCI_H
+#define PCI_H
+
+#include "types.h"
+
+#define PCI_CONFIG_ADDRESS 0xCF8
+#define PCI_CONFIG_DATA    0xCFC
+
+// Configuration space registers (double word offsets)
+#define PCI_VENDOR_ID      0x00    // Vendor ID, device ID above it
+#define PCI_COMMAND        0x04    // Command, status above it
+#define PCI_CLASS_REVISION 0x08    // Class, subclass, prog IF, revision
+#define PCI_HEADER         0x0C    // Header type in bits 16-23
+#define PCI_BAR0           0x10
+#define PCI_SUBSYSTEM      0x2C    // Subsystem vendor ID, subsystem ID above it
+#define PCI_INTERRUPT_LINE 0x3C
+
+// Command register bits
+#define PCI_COMMAND_IO          0x0001
+#define PCI_COMMAND_MEMORY      0x0002
+#define PCI_COMMAND_BUS_MASTER  0x0004
+
+/**
+ * PCI function found on the bus
+ */
+typedef struct {
+    uint8_t bus;
+    uint8_t slot;
+    uint8_t func;
+    uint16_t vendor_id;
+    uint16_t device_id;
+    uint8_t class_code;
+    uint8_t subclass;
+    uint8_t prog_if;
+    uint8_t irq_line;
+} pci_device_t;
+
+/**
+ * pci_read - Read a double word from configuration space
+ * @dev: Device
+ * @offset: Register offset, aligned to 4
+ *
+ * Return: Register value
+ */
+uint32_t pci_read(const pci_device_t *dev, uint8_t offset);
+
+/**
+ * pci_write - Write a double word to configuration space
+ * @dev: Device
+ * @offset: Register offset, aligned to 4
+ * @value: Value to write
+ */
+void pci_write(const pci_device_t *dev, uint8_t offset, uint32_t value);
+
+/**
+ * pci_find_class - Find the first device of a class
+ * @class_code: Base class
+ * @subclass: Subclass
+ * @dev: Receives the device
+ *
+ * Return: 0 if found, -1 otherwise
+ */
+int pci_find_class(uint8_t class_code, uint8_t subclass, pci_device_t *dev);
+
+/**
+ * pci_find_device - Find the first device with a vendor and device ID
+ * @vendor_id: Vendor ID
+ * @device_id: Device ID
+ * @dev: Receives the device
+ *
+ * Return: 0 if found, -1 otherwise
+ */
+int pci_find_device(uint16_t vendor_id, uint16_t device_id, pci_device_t *dev);
+
+/**
+ * pci_bar - Get the address of a base address register
+ * @dev: Device
+ * @index: BAR number (0-5)
+ *
+ * Return: I/O port or memory address with the flag bits cleared
+ */
+uint32_t pci_bar(const pci_device_t *dev, int index);
+
+/**
+ * pci_enable - Enable I/O, memory and bus-master access for a device
+ * @dev: Device
+ */
+void pci_enable(const pci_device_t *dev);
+
+#endif // PCI_H
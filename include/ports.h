@@ -37,5 +37,36 @@ uint16_t port_word_in(uint16_t port);
  */
 void port_word_out(uint16_t port, uint16_t data);
 
+/**
+ * port_dword_in - Read a double word from a port
+ * @port: Port number
+ *
+ * Return: Double word read from port
+ */
+uint32_t port_dword_in(uint16_t port);
+
+/**
+ * port_dword_out - Write a double word to a port
+ * @port: Port number
+ * @data: Double word to write
+ */
+void port_dword_out(uint16_t port, uint32_t data);
+
+/**
+ * port_words_in - Read a block of words from a port
+ * @port: Port number
+ * @buffer: Buffer to store the words
+ * @count: Number of words
+ */
+void port_words_in(uint16_t port, void *buffer, uint32_t count);
+
+/**
+ * port_words_out - Write a block of words to a port
+ * @port: Port number
+ * @buffer: Words to write
+ * @count: Number of words
+ */
+void port_words_out(uint16_t port, const void *buffer, uint32_t count);
+
 #endif // PORTS_H
 
@@ -0,0 +1,36 @@
+/**
+ * serial.h - Serial console on COM1
+ * Output-only 16550 UART driver, polled, for logs that should outlive
+ * the screen (`make run-serial` shows them on the host terminal)
+ */
+
+#ifndef SERIAL_H
+#define SERIAL_H
+
+#include "types.h"
+
+#define SERIAL_COM1 0x3F8
+#define SERIAL_BAUD 115200
+
+/**
+ * serial_init - Set up COM1 for 115200 baud, 8N1
+ *
+ * Return: 0 on success, -1 if no UART answers
+ */
+int serial_init(void);
+
+/**
+ * serial_putc - Send a character
+ * @c: Character, '\n' is sent as "\r\n"
+ */
+void serial_putc(char c);
+
+/**
+ * serial_write - Send a string
+ * @str: Null-terminated string
+ *
+ * Does nothing if serial_init() found no UART.
+ */
+void serial_write(const char *str);
+
+#endif // SERIAL_H
@@ -0,0 +1,153 @@
+/**
+ * sfs.h - Simple on-disk filesystem
+ * Block groups with bitmaps, fixed-size inodes and extent-mapped data
+ *
+ * Disk layout (1KB blocks):
+ *   block 0        reserved
+ *   block 1        superblock
+ *   block 2...     groups of SFS_BLOCKS_PER_GROUP blocks, each holding
+ *                  a block bitmap, an inode bitmap, the group's inode
+ *                  table, a checksum table and then data blocks
+ *
+ * New files get an inode in their directory's group and data blocks
+ * right after their last extent, so a directory's inodes and file data
+ * stay close together on disk.
+ *
+ * Metadata blocks (bitmaps, inode tables, directories) are written
+ * through a journal at the start of group 0's data area. The journal
+ * holds the last committed transaction: a header naming the logged
+ * blocks, their contents and a commit record with a checksum.
+ *
+ * Every file data block has a CRC32C in its group's checksum table,
+ * indexed by the block's position in the group. The table is metadata
+ * and goes through the journal; reads verify the data against it.
+ */
+
+#ifndef SFS_H
+#define SFS_H
+
+#include "types.h"
+#include "blockdev.h"
+#include "vfs.h"
+
+#define SFS_MAGIC 0x32534653        // "SFS2"
+#define SFS_BLOCK_SIZE 1024
+#define SFS_SUPER_BLOCK 1
+#define SFS_FIRST_GROUP 2
+
+// Group layout; one bitmap block covers a whole group
+#define SFS_BLOCKS_PER_GROUP (SFS_BLOCK_SIZE * 8)
+#define SFS_INODES_PER_GROUP 256
+#define SFS_INODE_SIZE 64
+#define SFS_INODES_PER_BLOCK (SFS_BLOCK_SIZE / SFS_INODE_SIZE)
+#define SFS_INODE_TABLE_BLOCKS (SFS_INODES_PER_GROUP / SFS_INODES_PER_BLOCK)
+#define SFS_GROUP_BLOCK_BITMAP 0
+#define SFS_GROUP_INODE_BITMAP 1
+#define SFS_GROUP_INODE_TABLE 2
+#define SFS_GROUP_CSUM (SFS_GROUP_INODE_TABLE + SFS_INODE_TABLE_BLOCKS)
+#define SFS_GROUP_DATA (SFS_GROUP_CSUM + SFS_CSUM_BLOCKS)
+
+// Checksum table: one CRC32C per block of the group
+#define SFS_CSUMS_PER_BLOCK (SFS_BLOCK_SIZE / 4)
+#define SFS_CSUM_BLOCKS (SFS_BLOCKS_PER_GROUP / SFS_CSUMS_PER_BLOCK)
+
+// Largest supported volume: 32 groups of 8MB
+#define SFS_MAX_GROUPS 32
+
+#define SFS_ROOT_INO 1
+#define SFS_EXTENTS 6
+#define SFS_NAME_MAX 27
+#define SFS_DIRENT_SIZE 32
+#define SFS_DIRENTS_PER_BLOCK (SFS_BLOCK_SIZE / SFS_DIRENT_SIZE)
+
+// Journal
+#define SFS_JOURNAL_MAGIC 0x4C4E524A   // "JRNL"
+#define SFS_COMMIT_MAGIC  0x54494D43   // "CMIT"
+#define SFS_JOURNAL_BLOCKS 64
+#define SFS_JOURNAL_MAX_LOGGED ((SFS_BLOCK_SIZE - 12) / 4)
+
+// Journal blocks one operation may dirty at most
+#define SFS_OP_CREDITS 16
+
+// Largest write done as one operation; bigger writes are split so the
+// bitmap and checksum blocks each part dirties stay within the credits
+#define SFS_WRITE_SLICE (64 * SFS_BLOCK_SIZE)
+
+// Inode types, 0 marks a free inode
+#define SFS_TYPE_FILE 1
+#define SFS_TYPE_DIR  2
+
+/**
+ * Superblock
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t block_count;       // Blocks on the volume, including block 0
+    uint32_t group_count;
+    uint32_t inode_count;       // group_count * SFS_INODES_PER_GROUP
+    uint32_t journal_start;     // First journal block
+    uint32_t journal_blocks;    // Journal length, 0 for no journal
+    uint32_t reserved[2];
+} __attribute__((packed)) sfs_super_t;
+
+/**
+ * Run of contiguous data blocks
+ */
+typedef struct {
+    uint32_t start;             // First block
+    uint32_t count;             // Number of blocks
+} __attribute__((packed)) sfs_extent_t;
+
+/**
+ * Inode; inode N lives in group (N - 1) / SFS_INODES_PER_GROUP
+ */
+typedef struct {
+    uint16_t type;              // SFS_TYPE_*, 0 if free
+    uint16_t links;
+    uint32_t size;              // Bytes
+    uint32_t extent_count;
+    uint32_t entries;           // Live entries, directories only
+    sfs_extent_t extents[SFS_EXTENTS];
+} __attribute__((packed)) sfs_inode_t;
+
+/**
+ * Directory entry; ino 0 marks a free slot
+ */
+typedef struct {
+    uint32_t ino;
+    char name[SFS_NAME_MAX + 1];
+} __attribute__((packed)) sfs_dirent_t;
+
+/**
+ * Journal header, the first journal block
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t sequence;          // Transaction number
+    uint32_t count;             // Logged blocks following the header, 0 if empty
+    uint32_t blocks[];          // Home block of each logged block
+} __attribute__((packed)) sfs_journal_header_t;
+
+/**
+ * Commit record, the block after the last logged block
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t sequence;          // Must match the header
+    uint32_t checksum;          // Over the header and the logged blocks
+} __attribute__((packed)) sfs_commit_t;
+
+/**
+ * sfs_mount - Open an sfs volume on a block device
+ * @dev: Block device
+ *
+ * A transaction left in the journal by an unclean shutdown is replayed.
+ *
+ * Return: Volume state to pass to vfs_mount() with sfs_ops, NULL if the
+ *         device holds no sfs volume
+ */
+void *sfs_mount(blockdev_t *dev);
+
+extern const vfs_ops_t sfs_ops;
+
+#endif // SFS_H
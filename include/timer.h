@@ -0,0 +1,50 @@
+/**
+ * timer.h - Programmable Interval Timer and TSC interface
+ */
+
+#ifndef TIMER_H
+#define TIMER_H
+
+#include "types.h"
+#include "isr.h"
+
+// Timer interrupt rate
+#define TIMER_HZ 1000
+
+/**
+ * timer_init - Program the PIT and calibrate the TSC
+ * @hz: Timer interrupt frequency
+ *
+ * Interrupts must already be enabled.
+ */
+void timer_init(uint32_t hz);
+
+/**
+ * timer_handler - IRQ0 interrupt handler for the PIT
+ * @regs: Register state
+ */
+void timer_handler(registers_t regs);
+
+/**
+ * timer_get_ticks - Get the number of timer interrupts since boot
+ *
+ * Return: Tick count
+ */
+uint32_t timer_get_ticks(void);
+
+/**
+ * timer_read_tsc - Read the CPU time-stamp counter
+ *
+ * Return: Current TSC value
+ */
+uint64_t timer_read_tsc(void);
+
+/**
+ * timer_tsc_to_us - Convert a TSC cycle count to microseconds
+ * @cycles: Cycle count
+ *
+ * Return: Microseconds, 0 if the TSC is not calibrated
+ */
+uint32_t timer_tsc_to_us(uint64_t cycles);
+
+#endif // TIMER_H
@@ -30,5 +30,13 @@ typedef uint32_t size_t;
 // NULL pointer
 #define NULL ((void*)0)
 
+// Code placement, see kernel/linker.ld: __hot functions (interrupt paths,
+// console, allocator) are packed together at the start of .text, __cold
+// ones (init, rarely used commands) at its end; __cold_rodata constants
+// go to the end of .rodata
+#define __hot  __attribute__((hot, section(".text.hot")))
+#define __cold __attribute__((cold, section(".text.unlikely")))
+#define __cold_rodata __attribute__((section(".rodata.cold")))
+
 #endif // TYPES_H
 
@@ -0,0 +1,288 @@
+/**
+ * vfs.h - Virtual file system
+ * File descriptors, mount points and pluggable filesystem backends
+ */
+
+#ifndef VFS_H
+#define VFS_H
+
+#include "types.h"
+
+#define VFS_MAX_FDS 16
+#define VFS_MAX_MOUNTS 4
+#define VFS_PATH_MAX 128
+#define VFS_NAME_MAX 32
+
+// Read-ahead window limits in bytes
+#define VFS_RA_MIN 4096
+#define VFS_RA_MAX 32768
+
+// Milliseconds between periodic syncs of backend state (journal commits)
+#define VFS_COMMIT_INTERVAL 5000
+
+// Open flags
+#define VFS_O_READ   0x01
+#define VFS_O_WRITE  0x02
+#define VFS_O_RDWR   (VFS_O_READ | VFS_O_WRITE)
+#define VFS_O_CREAT  0x04
+#define VFS_O_EXCL   0x08
+#define VFS_O_TRUNC  0x10
+#define VFS_O_APPEND 0x20
+
+// Seek origins
+#define VFS_SEEK_SET 0
+#define VFS_SEEK_CUR 1
+#define VFS_SEEK_END 2
+
+// Node types
+#define VFS_TYPE_FILE 0
+#define VFS_TYPE_DIR  1
+
+// File attributes
+#define VFS_ATTR_COMPRESS 0x01  // Store the file's data compressed
+
+/**
+ * Node information returned by stat
+ */
+typedef struct {
+    uint32_t size;          // Bytes for files, entry count for directories
+    uint32_t stored;        // Bytes of storage used by the data, 0 if unknown
+    uint8_t type;           // VFS_TYPE_FILE or VFS_TYPE_DIR
+    uint8_t flags;          // VFS_ATTR_*
+} vfs_stat_t;
+
+/**
+ * Directory entry returned by readdir
+ */
+typedef struct {
+    char name[VFS_NAME_MAX];
+    uint32_t size;
+    uint8_t type;
+} vfs_dirent_t;
+
+/**
+ * Filesystem backend operations
+ *
+ * Paths passed to a backend are absolute within the mount, without
+ * "." or ".." components. Nodes are identified by backend inode
+ * numbers, so open files are not looked up again on every access.
+ * Every operation returns 0 (or a byte count) on success and -1 on error.
+ * sync, readahead and setattr are optional and may be NULL. readahead
+ * starts loading a byte range that is expected to be read soon; setattr
+ * changes how a file is stored (VFS_ATTR_*).
+ * vfs_stat() zeroes the vfs_stat_t it passes to stat, so fields a
+ * backend does not know stay 0.
+ */
+typedef struct vfs_ops {
+    const char *name;
+    int (*lookup)(void *fs, const char *path, uint32_t *ino);
+    int (*create)(void *fs, const char *path, uint32_t *ino);
+    int (*mkdir)(void *fs, const char *path);
+    int (*unlink)(void *fs, const char *path);
+    int (*rmdir)(void *fs, const char *path);
+    int (*read)(void *fs, uint32_t ino, void *buffer, uint32_t offset, uint32_t len);
+    int (*write)(void *fs, uint32_t ino, const void *data, uint32_t offset, uint32_t len);
+    int (*truncate)(void *fs, uint32_t ino, uint32_t size);
+    int (*stat)(void *fs, uint32_t ino, vfs_stat_t *st);
+    int (*readdir)(void *fs, uint32_t ino, uint32_t *cookie, vfs_dirent_t *entry);
+    int (*sync)(void *fs);
+    int (*readahead)(void *fs, uint32_t ino, uint32_t offset, uint32_t len);
+    int (*setattr)(void *fs, uint32_t ino, uint8_t flags);
+} vfs_ops_t;
+
+/**
+ * Mounted filesystem
+ */
+typedef struct {
+    char path[VFS_PATH_MAX];
+    const vfs_ops_t *ops;
+    void *fs;               // Backend state passed to every operation
+    bool in_use;
+} vfs_mount_t;
+
+/**
+ * Open file
+ */
+typedef struct {
+    vfs_mount_t *mount;
+    uint32_t ino;
+    uint32_t offset;        // Byte offset, or readdir cookie for directories
+    uint32_t ra_next;       // Offset a sequential reader reads next
+    uint32_t ra_end;        // End of the data already read ahead
+    uint32_t ra_size;       // Current read-ahead window, 0 when off
+    uint8_t flags;
+    uint8_t type;
+    bool in_use;
+} vfs_file_t;
+
+/**
+ * Per-context state: file descriptor table and working directory
+ */
+typedef struct {
+    vfs_file_t fds[VFS_MAX_FDS];
+    char cwd[VFS_PATH_MAX];
+} vfs_context_t;
+
+/**
+ * vfs_init - Initialize the VFS and the kernel context
+ */
+void vfs_init(void);
+
+/**
+ * vfs_context_init - Reset a context to no open files and the root directory
+ * @ctx: Context to initialize
+ */
+void vfs_context_init(vfs_context_t *ctx);
+
+/**
+ * vfs_set_context - Switch the context used by later calls
+ * @ctx: New context
+ *
+ * Return: Previous context
+ */
+vfs_context_t *vfs_set_context(vfs_context_t *ctx);
+
+/**
+ * vfs_mount - Attach a filesystem backend at a path
+ * @path: Mount point, "/" or an existing directory
+ * @ops: Backend operations
+ * @fs: Backend state
+ *
+ * Return: 0 on success, -1 on error
+ */
+int vfs_mount(const char *path, const vfs_ops_t *ops, void *fs);
+
+/**
+ * vfs_open - Open a file or directory
+ * @path: Absolute path, or relative to the working directory
+ * @flags: VFS_O_* flags
+ *
+ * Return: File descriptor, -1 on error
+ */
+int vfs_open(const char *path, int flags);
+
+/**
+ * vfs_close - Close a file descriptor
+ * @fd: File descriptor
+ *
+ * Return: 0 on success, -1 if not open
+ */
+int vfs_close(int fd);
+
+/**
+ * vfs_read - Read from an open file at its offset
+ * @fd: File descriptor
+ * @buffer: Buffer to store data
+ * @len: Maximum number of bytes to read
+ *
+ * Return: Number of bytes read (0 at end of file), -1 on error
+ */
+int vfs_read(int fd, void *buffer, uint32_t len);
+
+/**
+ * vfs_write - Write to an open file at its offset
+ * @fd: File descriptor
+ * @data: Data to write
+ * @len: Number of bytes to write
+ *
+ * Files opened with VFS_O_APPEND always write at the end.
+ *
+ * Return: Number of bytes written, -1 on error
+ */
+int vfs_write(int fd, const void *data, uint32_t len);
+
+/**
+ * vfs_lseek - Move the offset of an open file
+ * @fd: File descriptor
+ * @offset: Offset relative to @whence
+ * @whence: VFS_SEEK_SET, VFS_SEEK_CUR or VFS_SEEK_END
+ *
+ * Return: New offset, -1 on error
+ */
+int vfs_lseek(int fd, int32_t offset, int whence);
+
+/**
+ * vfs_readdir - Read the next entry of an open directory
+ * @fd: File descriptor of a directory
+ * @entry: Receives the entry
+ *
+ * Return: 0 on success, -1 at the end of the directory or on error
+ */
+int vfs_readdir(int fd, vfs_dirent_t *entry);
+
+/**
+ * vfs_stat - Get information about a path
+ * @path: Path to look up
+ * @st: Receives the information
+ *
+ * Return: 0 on success, -1 if not found
+ */
+int vfs_stat(const char *path, vfs_stat_t *st);
+
+/**
+ * vfs_setattr - Change the storage attributes of a file
+ * @path: Path of the file
+ * @flags: VFS_ATTR_* flags the file should have
+ *
+ * Return: 0 on success, -1 if not found, not supported by the backend
+ *         or out of memory
+ */
+int vfs_setattr(const char *path, uint8_t flags);
+
+/**
+ * vfs_mkdir - Create a directory
+ * @path: Path of the directory
+ *
+ * Return: 0 on success, -1 on error
+ */
+int vfs_mkdir(const char *path);
+
+/**
+ * vfs_rmdir - Delete an empty directory
+ * @path: Path of the directory
+ *
+ * Return: 0 on success, -1 on error
+ */
+int vfs_rmdir(const char *path);
+
+/**
+ * vfs_unlink - Delete a file
+ * @path: Path of the file
+ *
+ * Return: 0 on success, -1 on error
+ */
+int vfs_unlink(const char *path);
+
+/**
+ * vfs_chdir - Change the working directory of the current context
+ * @path: Path of the new working directory
+ *
+ * Return: 0 on success, -1 if not a directory
+ */
+int vfs_chdir(const char *path);
+
+/**
+ * vfs_getcwd - Get the working directory of the current context
+ *
+ * Return: Absolute path of the working directory
+ */
+const char *vfs_getcwd(void);
+
+/**
+ * vfs_sync - Flush every mounted filesystem and the block cache
+ *
+ * Return: Number of blocks written, -1 on error
+ */
+int vfs_sync(void);
+
+/**
+ * vfs_writeback - Periodic background sync
+ *
+ * Called from the kernel idle loop after every timer tick. Backends are
+ * synced once VFS_COMMIT_INTERVAL has passed, so operations issued in
+ * between are committed together; dirty blocks follow the block cache's
+ * own flush interval.
+ */
+void vfs_writeback(void);
+
+#endif // VFS_H
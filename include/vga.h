@@ -11,6 +11,19 @@
 #define VGA_WIDTH 80
 #define VGA_HEIGHT 25
 
+// Mode 13h linear framebuffer (320x200, one byte per pixel)
+#define VGA_FRAMEBUFFER 0xA0000
+#define VGA_FB_WIDTH 320
+#define VGA_FB_HEIGHT 200
+
+// 8-bit pixel surface: the mode 13h framebuffer or an off-screen buffer
+typedef struct {
+    uint8_t *pixels;
+    int width;
+    int height;
+    int pitch;          // Bytes per row
+} vga_surface_t;
+
 // Common VGA colors (256-color palette)
 #define VGA_COLOR_BLACK         0x00
 #define VGA_COLOR_BLUE          0x01
@@ -38,6 +51,8 @@ void vga_set_mode(uint8_t mode);
 /**
  * vga_clear_screen - Clear screen with color
  * @color: Fill color
+ *
+ * Only the current clip rectangle is cleared.
  */
 void vga_clear_screen(uint8_t color);
 
@@ -49,6 +64,15 @@ void vga_clear_screen(uint8_t color);
  */
 void vga_put_pixel(int x, int y, uint8_t color);
 
+/**
+ * vga_put_char - Draw a character cell
+ * @x: X coordinate (0-79)
+ * @y: Y coordinate (0-24)
+ * @c: Character
+ * @attribute: Text mode attribute (background << 4 | foreground)
+ */
+void vga_put_char(int x, int y, char c, uint8_t attribute);
+
 /**
  * vga_get_pixel - Get pixel color
  * @x: X coordinate
@@ -82,6 +106,54 @@ void vga_draw_rect(int x, int y, int width, int height, uint8_t color);
  */
 void vga_draw_rect_outline(int x, int y, int width, int height, uint8_t color);
 
+/**
+ * vga_set_clip - Restrict all drawing to a rectangle
+ * @x, y: Top-left corner
+ * @width, height: Dimensions
+ *
+ * The rectangle is intersected with the screen. Pixels, rectangles,
+ * lines, text and screen clears outside it are discarded.
+ */
+void vga_set_clip(int x, int y, int width, int height);
+
+/**
+ * vga_reset_clip - Allow drawing on the whole screen again
+ */
+void vga_reset_clip(void);
+
+/**
+ * vga_get_clip - Get the current clip rectangle
+ * @x, y: Receive the top-left corner
+ * @width, height: Receive the dimensions
+ */
+void vga_get_clip(int *x, int *y, int *width, int *height);
+
+/**
+ * vga_clip_test - Check if a point is inside the clip rectangle
+ * @x: X coordinate
+ * @y: Y coordinate
+ *
+ * Return: true if drawing at (x, y) is allowed
+ */
+bool vga_clip_test(int x, int y);
+
+/**
+ * vga_wait_retrace - Wait for the start of the next vertical retrace
+ *
+ * Two calls never return within the same retrace.
+ */
+void vga_wait_retrace(void);
+
+/**
+ * vga_present - Copy changed rows of the back buffer to the screen
+ *
+ * All drawing functions write to a back buffer; nothing appears until
+ * it is presented.
+ *
+ * Return: Number of rows copied
+ */
+int vga_present(void);
+
 /**
  * vga_set_color - Set current drawing color
  * @color: Color to use
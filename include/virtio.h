@@ -0,0 +1,75 @@
+/**
+ * virtio.h - Legacy virtio PCI transport and split virtqueue layout
+ */
+
+#ifndef VIRTIO_H
+#define VIRTIO_H
+
+#include "types.h"
+
+#define VIRTIO_VENDOR_ID 0x1AF4
+
+// Legacy I/O registers, offsets from BAR0
+#define VIRTIO_REG_DEVICE_FEATURES 0x00
+#define VIRTIO_REG_GUEST_FEATURES  0x04
+#define VIRTIO_REG_QUEUE_PFN       0x08
+#define VIRTIO_REG_QUEUE_SIZE      0x0C
+#define VIRTIO_REG_QUEUE_SELECT    0x0E
+#define VIRTIO_REG_QUEUE_NOTIFY    0x10
+#define VIRTIO_REG_DEVICE_STATUS   0x12
+#define VIRTIO_REG_ISR_STATUS      0x13
+#define VIRTIO_REG_CONFIG          0x14
+
+// Device status bits
+#define VIRTIO_STATUS_ACKNOWLEDGE 0x01
+#define VIRTIO_STATUS_DRIVER      0x02
+#define VIRTIO_STATUS_DRIVER_OK   0x04
+#define VIRTIO_STATUS_FAILED      0x80
+
+// Descriptor flags
+#define VIRTQ_DESC_F_NEXT  1
+#define VIRTQ_DESC_F_WRITE 2    // Device writes this buffer
+
+// Ring flags
+#define VIRTQ_USED_F_NO_NOTIFY 1
+
+// Legacy queues are laid out in pages
+#define VIRTQ_ALIGN 4096
+
+/**
+ * Descriptor: one guest buffer
+ */
+typedef struct {
+    uint64_t addr;
+    uint32_t len;
+    uint16_t flags;
+    uint16_t next;
+} __attribute__((packed)) virtq_desc_t;
+
+/**
+ * Available ring: descriptor chains offered to the device
+ */
+typedef struct {
+    uint16_t flags;
+    uint16_t idx;
+    uint16_t ring[];
+} __attribute__((packed)) virtq_avail_t;
+
+/**
+ * Used ring element: a chain the device has finished with
+ */
+typedef struct {
+    uint32_t id;
+    uint32_t len;
+} __attribute__((packed)) virtq_used_elem_t;
+
+/**
+ * Used ring: chains returned by the device
+ */
+typedef struct {
+    uint16_t flags;
+    uint16_t idx;
+    virtq_used_elem_t ring[];
+} __attribute__((packed)) virtq_used_t;
+
+#endif // VIRTIO_H
@@ -0,0 +1,40 @@
+/**
+ * virtio_blk.h - virtio block device driver
+ */
+
+#ifndef VIRTIO_BLK_H
+#define VIRTIO_BLK_H
+
+#include "types.h"
+
+// Legacy and transitional PCI device IDs
+#define VIRTIO_BLK_DEVICE_ID 0x1001
+
+// Feature bits
+#define VIRTIO_BLK_F_FLUSH 9
+
+// Request types
+#define VIRTIO_BLK_T_IN    0
+#define VIRTIO_BLK_T_OUT   1
+#define VIRTIO_BLK_T_FLUSH 4
+
+// Request status written by the device
+#define VIRTIO_BLK_S_OK 0
+
+// Device configuration: capacity in 512-byte sectors
+#define VIRTIO_BLK_CONFIG_CAPACITY 0x00
+
+// Sectors per request; larger transfers become several requests
+#define VIRTIO_BLK_MAX_SECTORS 128
+
+// Requests that can be in flight at once
+#define VIRTIO_BLK_MAX_REQUESTS 32
+
+/**
+ * virtio_blk_init - Detect a virtio block device and register it as vda
+ *
+ * Return: 1 if a device was found, 0 otherwise
+ */
+int virtio_blk_init(void);
+
+#endif // VIRTIO_BLK_H
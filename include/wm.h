@@ -0,0 +1,106 @@
+/**
+ * wm.h - Window manager interface
+ * Keeps windows in z-order and repaints only their visible parts
+ */
+
+#ifndef WM_H
+#define WM_H
+
+#include "types.h"
+#include "gui.h"
+
+#define WM_MAX_WINDOWS 16
+
+/**
+ * wm_init - Reset the window stack
+ * @paint_background: Draws the desktop behind all windows
+ */
+void wm_init(void (*paint_background)(void));
+
+/**
+ * wm_add_window - Add a window on top of the stack
+ * @win: Window to add
+ *
+ * Return: 0 on success, -1 if the stack is full
+ */
+int wm_add_window(window_t *win);
+
+/**
+ * wm_remove_window - Remove a window from the stack
+ * @win: Window to remove
+ */
+void wm_remove_window(window_t *win);
+
+/**
+ * wm_raise - Move a window to the top of the stack
+ * @win: Window to raise
+ */
+void wm_raise(window_t *win);
+
+/**
+ * wm_window_at - Find the topmost visible window at a point
+ * @x: X coordinate
+ * @y: Y coordinate
+ *
+ * Return: Window under the point, NULL for the desktop
+ */
+window_t *wm_window_at(int x, int y);
+
+/**
+ * wm_widget_at - Find the topmost widget at a point
+ * @x: X coordinate
+ * @y: Y coordinate
+ *
+ * Return: Widget under the point in the topmost window, NULL if none
+ */
+widget_t *wm_widget_at(int x, int y);
+
+/**
+ * wm_repaint - Repaint the desktop and all windows
+ *
+ * Each layer is drawn clipped to the part of it that is not covered
+ * by windows above it. Fully covered windows are skipped.
+ */
+void wm_repaint(void);
+
+/**
+ * wm_repaint_window - Repaint the visible part of one window
+ * @win: Window to repaint
+ */
+void wm_repaint_window(window_t *win);
+
+/**
+ * wm_invalidate_all - Request a full repaint on the next render
+ */
+void wm_invalidate_all(void);
+
+/**
+ * wm_invalidate_window - Request a repaint of a whole window
+ * @win: Window to repaint
+ */
+void wm_invalidate_window(window_t *win);
+
+/**
+ * wm_needs_render - Check if anything is waiting to be repainted
+ *
+ * Return: true if a render would draw something
+ */
+bool wm_needs_render(void);
+
+/**
+ * wm_layout - Refresh widget layout in all windows
+ *
+ * Must run before wm_render() after widgets were invalidated.
+ */
+void wm_layout(void);
+
+/**
+ * wm_render - Repaint only the invalid widgets of every window
+ *
+ * Each window with an invalid widget tree is rendered inside its
+ * visible region. Windows with clean trees are not visited. A pending
+ * full repaint redraws everything instead.
+ */
+void wm_render(void);
+
+#endif // WM_H
@@ -0,0 +1,37 @@
+/**
+ * zimage.h - Compressed kernel image
+ * The OS image carries the kernel LZ4-compressed behind a small
+ * decompression stub (boot/zimage/), so the bootloader reads fewer
+ * sectors. The stub has the kernel's multiboot header layout, so
+ * boot/boot.asm loads it like the kernel, at ZIMAGE_ADDR; it inflates the
+ * kernel to the kernel's load address and jumps to it.
+ *
+ * Payload layout, built by tools/mkzimage.c from kernel.bin:
+ *   header         zimage_header_t
+ *   data           one raw LZ4 block of the whole kernel image; match
+ *                  offsets reach back at most 64KB
+ */
+
+#ifndef ZIMAGE_H
+#define ZIMAGE_H
+
+#include "types.h"
+
+#define ZIMAGE_MAGIC 0x4B5A4C53     // "SLZK"
+
+// Where the bootloader loads the stub; the kernel must end below it.
+// Also set in boot/zimage/zimage.ld.
+#define ZIMAGE_ADDR 0x400000
+
+/**
+ * Payload header
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t load;      // Address the kernel image is inflated to
+    uint32_t entry;     // Kernel entry address
+    uint32_t size;      // Kernel image size, up to _edata
+    uint32_t packed;    // Compressed size
+} zimage_header_t;
+
+#endif // ZIMAGE_H
@@ -0,0 +1,152 @@
+/**
+ * boottrace.c - Boot-phase timing
+ * Table of TSC stamps, one per boot phase, starting with the ones the
+ * bootloader left at BOOT_TSC_ADDR
+ */
+
+#include "../include/boottrace.h"
+#include "../include/multiboot.h"
+#include "../include/timer.h"
+
+// Column widths of the report
+#define BOOT_TRACE_NAME_WIDTH 16
+#define BOOT_TRACE_TIME_WIDTH 12
+
+/**
+ * Boot phase
+ */
+typedef struct {
+    const char *phase;
+    uint64_t tsc;       // End of the phase
+} boot_trace_entry_t;
+
+static boot_trace_entry_t trace[BOOT_TRACE_MAX];
+static int trace_count;
+
+static const char *const boot_tsc_names[BOOT_TSC_SLOTS] = {
+    [BOOT_TSC_START]   = "firmware",
+    [BOOT_TSC_STAGE2]  = "stage 2 read",
+    [BOOT_TSC_KERNEL]  = "kernel read",
+    [BOOT_TSC_INITRD]  = "initrd read",
+    [BOOT_TSC_PMODE]   = "protected mode",
+    [BOOT_TSC_INFLATE] = "inflate",
+};
+
+/**
+ * boot_trace_add - Append a stamp to the table
+ * @phase: Phase name
+ * @tsc: TSC at the end of the phase
+ */
+static __cold void boot_trace_add(const char *phase, uint64_t tsc) {
+    if (trace_count == BOOT_TRACE_MAX) return;
+    trace[trace_count].phase = phase;
+    trace[trace_count].tsc = tsc;
+    trace_count++;
+}
+
+/**
+ * boot_trace_init - Start the kernel's boot trace
+ * @magic: EAX the kernel was entered with
+ *
+ * Takes over the bootloader's stamps unless a multiboot loader started
+ * the kernel, then records the kernel entry. Call first thing.
+ */
+__cold void boot_trace_init(uint32_t magic) {
+    uint64_t now = timer_read_tsc();
+    const boot_tsc_t *handover = (const boot_tsc_t *)BOOT_TSC_ADDR;
+
+    trace_count = 0;
+    if (magic != MULTIBOOT_BOOTLOADER_MAGIC && handover->magic == BOOT_TSC_MAGIC) {
+        for (int i = 0; i < BOOT_TSC_SLOTS; i++) {
+            if (handover->tsc[i]) boot_trace_add(boot_tsc_names[i], handover->tsc[i]);
+        }
+    }
+    boot_trace_add("kernel entry", now);
+}
+
+/**
+ * boot_trace - Record the end of a boot phase
+ * @phase: Name of the phase, a string that outlives the trace
+ */
+__cold void boot_trace(const char *phase) {
+    boot_trace_add(phase, timer_read_tsc());
+}
+
+/**
+ * boot_trace_pad - Write a string left-aligned in a column
+ * @p: Output position
+ * @s: String
+ * @width: Column width
+ *
+ * Return: Output position after the column
+ */
+static char *boot_trace_pad(char *p, const char *s, int width) {
+    while (*s && width > 0) {
+        *p++ = *s++;
+        width--;
+    }
+    while (width-- > 0) *p++ = ' ';
+    return p;
+}
+
+/**
+ * boot_trace_ms - Write microseconds as milliseconds, right-aligned
+ * @p: Output position
+ * @us: Microseconds
+ * @width: Column width
+ *
+ * Return: Output position after the column
+ */
+static char *boot_trace_ms(char *p, uint32_t us, int width) {
+    char digits[11];    // Up to 4294967.295
+    int n = 0;
+
+    // Three decimals, then the whole milliseconds
+    for (int i = 0; i < 3; i++) {
+        digits[n++] = '0' + us % 10;
+        us /= 10;
+    }
+    digits[n++] = '.';
+    do {
+        digits[n++] = '0' + us % 10;
+        us /= 10;
+    } while (us);
+
+    for (int i = n; i < width; i++) *p++ = ' ';
+    while (n > 0) *p++ = digits[--n];
+    return p;
+}
+
+/**
+ * boot_trace_report - Format the boot trace as a table
+ * @emit: Called with each line, newline included
+ *
+ * Each phase is shown with its duration and its end time since reset,
+ * in milliseconds. Needs the TSC calibrated by timer_init().
+ */
+__cold void boot_trace_report(void (*emit)(const char *line)) {
+    char line[2 + BOOT_TRACE_NAME_WIDTH + 2 * BOOT_TRACE_TIME_WIDTH + 2];
+    uint64_t last = 0;
+
+    emit("Boot trace (ms):\n");
+    char *p = boot_trace_pad(line, "  phase", 2 + BOOT_TRACE_NAME_WIDTH);
+    p = boot_trace_pad(p, "        took", BOOT_TRACE_TIME_WIDTH);
+    p = boot_trace_pad(p, "          at", BOOT_TRACE_TIME_WIDTH);
+    *p++ = '\n';
+    *p = '\0';
+    emit(line);
+
+    for (int i = 0; i < trace_count; i++) {
+        // Stamps come from several stages, never show time running back
+        uint64_t tsc = trace[i].tsc > last ? trace[i].tsc : last;
+
+        p = boot_trace_pad(line, "  ", 2);
+        p = boot_trace_pad(p, trace[i].phase, BOOT_TRACE_NAME_WIDTH);
+        p = boot_trace_ms(p, timer_tsc_to_us(tsc - last), BOOT_TRACE_TIME_WIDTH);
+        p = boot_trace_ms(p, timer_tsc_to_us(tsc), BOOT_TRACE_TIME_WIDTH);
+        *p++ = '\n';
+        *p = '\0';
+        emit(line);
+        last = tsc;
+    }
+}
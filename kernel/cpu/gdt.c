@@ -50,7 +50,7 @@ static void gdt_set_gate(int num, uint32_t base, uint32_t limit,
 /**
  * gdt_init - Initialize the Global Descriptor Table
  */
-void gdt_init(void) {
+__cold void gdt_init(void) {
     gp.limit = (sizeof(struct gdt_entry) * 3) - 1;
     gp.base = (uint32_t)&gdt;
     
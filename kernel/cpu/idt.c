@@ -47,7 +47,7 @@ void idt_set_gate(uint8_t num, uint32_t base, uint16_t selector, uint8_t flags)
 /**
  * idt_init - Initialize the Interrupt Descriptor Table
  */
-void idt_init(void) {
+__cold void idt_init(void) {
     idtp.limit = (sizeof(struct idt_entry) * 256) - 1;
     idtp.base = (uint32_t)&idt;
     
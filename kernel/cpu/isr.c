@@ -8,6 +8,10 @@
 #include "../../include/screen.h"
 #include "../../include/ports.h"
 #include "../../include/keyboard.h"
+#include "../../include/timer.h"
+
+// Handlers for IRQ 0-15
+static irq_handler_t irq_handlers[16];
 
 // Exception messages
 const char *exception_messages[] = {
@@ -100,7 +104,7 @@ extern void irq15();
 /**
  * isr_init - Initialize Interrupt Service Routines
  */
-void isr_init(void) {
+__cold void isr_init(void) {
     // Remap the PIC
     port_byte_out(0x20, 0x11);
     port_byte_out(0xA0, 0x11);
@@ -165,6 +169,10 @@ void isr_init(void) {
     idt_set_gate(46, (uint32_t)irq14, 0x08, 0x8E);
     idt_set_gate(47, (uint32_t)irq15, 0x08, 0x8E);
 
+    // Timer and keyboard are always present
+    irq_register_handler(0, timer_handler);
+    irq_register_handler(1, keyboard_handler);
+
     // Enable interrupts
     __asm__ __volatile__("sti");
 }
@@ -172,8 +180,10 @@ void isr_init(void) {
 /**
  * isr_handler - Common ISR handler
  * @regs: Register state at time of interrupt
+ *
+ * Only CPU exceptions come here, and each one halts the system.
  */
-void isr_handler(registers_t regs) {
+__cold void isr_handler(registers_t regs) {
     print("Received interrupt: ");
     if (regs.int_no < 32) {
         print(exception_messages[regs.int_no]);
@@ -187,10 +197,11 @@ void isr_handler(registers_t regs) {
  * irq_handler - Common IRQ handler
  * @regs: Register state at time of interrupt
  */
-void irq_handler(registers_t regs) {
-    // Handle specific IRQs
-    if (regs.int_no == 33) {
-        keyboard_handler(regs);
+__hot void irq_handler(registers_t regs) {
+    // Dispatch to the registered handler
+    uint32_t irq = regs.int_no - 32;
+    if (irq < 16 && irq_handlers[irq]) {
+        irq_handlers[irq](regs);
     }
 
     // Send EOI to PICs
@@ -200,3 +211,38 @@ void irq_handler(registers_t regs) {
     port_byte_out(0x20, 0x20);      // Send EOI to master
 }
 
+
+/**
+ * irq_register_handler - Install the handler for an IRQ line
+ * @irq: IRQ number (0-15)
+ * @handler: Function called for the IRQ, NULL to remove
+ */
+void irq_register_handler(uint8_t irq, irq_handler_t handler) {
+    if (irq < 16) {
+        irq_handlers[irq] = handler;
+    }
+}
+
+/**
+ * irq_save - Disable interrupts
+ *
+ * Nests: an inner irq_restore() leaves interrupts off if they were
+ * already off at the inner irq_save().
+ *
+ * Return: Previous EFLAGS, for irq_restore()
+ */
+__hot uint32_t irq_save(void) {
+    uint32_t flags;
+    __asm__ __volatile__("pushf; pop %0; cli" : "=r" (flags) : : "memory");
+    return flags;
+}
+
+/**
+ * irq_restore - Re-enable interrupts if irq_save() found them enabled
+ * @flags: EFLAGS returned by irq_save()
+ */
+__hot void irq_restore(uint32_t flags) {
+    if (flags & 0x200) {
+        __asm__ __volatile__("sti" : : : "memory");
+    }
+}
@@ -4,6 +4,9 @@
 [extern isr_handler]
 [extern irq_handler]
 
+; Exceptions only ever halt the system, their stubs go with the cold code
+section .text.unlikely progbits alloc exec nowrite
+
 ; Common ISR stub - saves processor state, calls C handler, restores state
 isr_common_stub:
     pusha                   ; Push all general purpose registers
@@ -30,6 +33,9 @@ isr_common_stub:
     sti
     iret                    ; Return from interrupt
 
+; Every hardware interrupt runs through here, keep it with the other hot code
+section .text.hot progbits alloc exec nowrite
+
 ; Common IRQ stub
 irq_common_stub:
     pusha
@@ -85,6 +91,8 @@ irq_common_stub:
         jmp irq_common_stub
 %endmacro
 
+section .text.unlikely
+
 ; CPU Exception ISRs (0-31)
 ISR_NOERRCODE 0
 ISR_NOERRCODE 1
@@ -119,6 +127,8 @@ ISR_NOERRCODE 29
 ISR_NOERRCODE 30
 ISR_NOERRCODE 31
 
+section .text.hot
+
 ; Hardware IRQs (32-47)
 IRQ 0, 32
 IRQ 1, 33
@@ -0,0 +1,583 @@
+/**
+ * ata.c - ATA (IDE) disk driver
+ * Polled PIO for bring-up and bus-master DMA with IRQ completion;
+ * requests wait in a queue per channel since a channel runs one
+ * command at a time
+ */
+
+#include "../../include/ata.h"
+#include "../../include/blockdev.h"
+#include "../../include/pci.h"
+#include "../../include/ports.h"
+#include "../../include/isr.h"
+#include "../../include/timer.h"
+#include "../../include/memory.h"
+#include "../../include/screen.h"
+
+// Iterations before a polled wait gives up
+#define ATA_POLL_LIMIT 1000000
+
+// Milliseconds before an interrupt-driven DMA wait gives up
+#define ATA_DMA_TIMEOUT 5000
+
+// Physical region descriptors in one channel's table: every segment of
+// a merged command may be split once at a 64KB boundary
+#define ATA_PRD_ENTRIES (ATA_MAX_SEGMENTS * 2)
+#define ATA_PRD_LAST 0x8000
+
+/**
+ * Physical region descriptor: one contiguous piece of a DMA buffer
+ */
+typedef struct {
+    uint32_t address;
+    uint16_t bytes;         // 0 means 64KB
+    uint16_t flags;         // ATA_PRD_LAST on the final entry
+} __attribute__((packed)) ata_prd_t;
+
+/**
+ * IDE channel
+ */
+typedef struct {
+    uint16_t io;
+    uint16_t ctrl;
+    uint16_t bmide;             // Bus master base, 0 if DMA is unavailable
+    uint8_t irq;
+    ata_prd_t *prd;
+    volatile uint8_t bm_status; // Bus master status latched by the IRQ
+    volatile uint8_t status;    // Device status latched by the IRQ
+    blockdev_request_t *head;   // Queued requests, the one running first
+    blockdev_request_t *tail;
+    bool dma_active;            // The head request is a DMA transfer in progress
+    bool running;               // Inside ata_run()
+    uint32_t dma_start;         // Tick the transfer started at
+    uint32_t dma_polls;         // Polls since it started
+} ata_channel_t;
+
+/**
+ * Disk attached to a channel
+ */
+typedef struct {
+    ata_channel_t *channel;
+    uint8_t slave;
+    bool lba48;
+    bool dma;
+    char model[41];
+    blockdev_t dev;
+} ata_drive_t;
+
+static ata_channel_t channels[2];
+static ata_drive_t drives[4];
+
+/**
+ * ata_delay - Wait about 400ns for the status register to settle
+ * @ch: Channel
+ */
+static void ata_delay(ata_channel_t *ch) {
+    for (int i = 0; i < 4; i++) {
+        port_byte_in(ch->ctrl);
+    }
+}
+
+/**
+ * ata_wait - Poll until the device is no longer busy
+ * @ch: Channel
+ * @need_drq: Also wait for the device to request data
+ *
+ * Return: 0 when ready, -1 on device error or timeout
+ */
+static int ata_wait(ata_channel_t *ch, bool need_drq) {
+    for (int i = 0; i < ATA_POLL_LIMIT; i++) {
+        uint8_t status = port_byte_in(ch->io + ATA_REG_STATUS);
+        if (status & ATA_SR_BSY) continue;
+        if (status & (ATA_SR_ERR | ATA_SR_DF)) return -1;
+        if (!need_drq || (status & ATA_SR_DRQ)) return 0;
+    }
+    return -1;
+}
+
+static void ata_dma_finish(ata_channel_t *ch);
+
+/**
+ * ata_irq - Latch completion state and finish the channel's transfer
+ * @ch: Channel
+ *
+ * Reading the status register acknowledges the interrupt at the device.
+ * An interrupt left over from a PIO command does not set the bus master
+ * interrupt bit, so it cannot finish a DMA transfer early.
+ */
+static void ata_irq(ata_channel_t *ch) {
+    if (ch->bmide) {
+        ch->bm_status = port_byte_in(ch->bmide + ATA_BM_STATUS);
+        port_byte_out(ch->bmide + ATA_BM_STATUS, ATA_BM_SR_IRQ | ATA_BM_SR_ERROR);
+    }
+    ch->status = port_byte_in(ch->io + ATA_REG_STATUS);
+
+    if (ch->dma_active && (ch->bm_status & (ATA_BM_SR_IRQ | ATA_BM_SR_ERROR))) {
+        ata_dma_finish(ch);
+    }
+}
+
+/**
+ * ata_primary_handler - IRQ14 handler
+ * @regs: Register state at time of interrupt
+ */
+static void ata_primary_handler(registers_t regs) {
+    (void)regs;
+    ata_irq(&channels[0]);
+}
+
+/**
+ * ata_secondary_handler - IRQ15 handler
+ * @regs: Register state at time of interrupt
+ */
+static void ata_secondary_handler(registers_t regs) {
+    (void)regs;
+    ata_irq(&channels[1]);
+}
+
+/**
+ * ata_setup - Select a drive and load the task file for a transfer
+ * @drive: Drive
+ * @lba: First sector
+ * @count: Number of sectors (1 to ATA_MAX_SECTORS)
+ * @lba48: Use 48-bit addressing
+ *
+ * Return: 0 on success, -1 if the channel stays busy
+ */
+static int ata_setup(ata_drive_t *drive, uint64_t lba, uint32_t count, bool lba48) {
+    ata_channel_t *ch = drive->channel;
+
+    if (ata_wait(ch, false) != 0) return -1;
+
+    if (lba48) {
+        port_byte_out(ch->io + ATA_REG_DRIVE, 0x40 | (drive->slave << 4));
+        ata_delay(ch);
+
+        // High bytes first, then the low bytes
+        port_byte_out(ch->io + ATA_REG_SECCOUNT, (count >> 8) & 0xFF);
+        port_byte_out(ch->io + ATA_REG_LBA0, (lba >> 24) & 0xFF);
+        port_byte_out(ch->io + ATA_REG_LBA1, (lba >> 32) & 0xFF);
+        port_byte_out(ch->io + ATA_REG_LBA2, (lba >> 40) & 0xFF);
+    } else {
+        port_byte_out(ch->io + ATA_REG_DRIVE,
+                      0xE0 | (drive->slave << 4) | ((lba >> 24) & 0x0F));
+        ata_delay(ch);
+    }
+
+    // A count of 0 means 256 sectors for LBA28
+    port_byte_out(ch->io + ATA_REG_SECCOUNT, count & 0xFF);
+    port_byte_out(ch->io + ATA_REG_LBA0, lba & 0xFF);
+    port_byte_out(ch->io + ATA_REG_LBA1, (lba >> 8) & 0xFF);
+    port_byte_out(ch->io + ATA_REG_LBA2, (lba >> 16) & 0xFF);
+    return 0;
+}
+
+/**
+ * ata_flush - Flush the drive's write cache
+ * @drive: Drive
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int ata_flush(ata_drive_t *drive) {
+    ata_channel_t *ch = drive->channel;
+
+    port_byte_out(ch->io + ATA_REG_DRIVE, 0xE0 | (drive->slave << 4));
+    ata_delay(ch);
+    port_byte_out(ch->io + ATA_REG_COMMAND,
+                  drive->lba48 ? ATA_CMD_FLUSH_EXT : ATA_CMD_FLUSH);
+    ata_delay(ch);
+    return ata_wait(ch, false);
+}
+
+/**
+ * ata_pio - Transfer a request and its merged chain with programmed I/O
+ * @drive: Drive
+ * @req: First request of the chain (1 to ATA_MAX_SECTORS in total)
+ * @write: Direction
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int ata_pio(ata_drive_t *drive, blockdev_request_t *req, bool write) {
+    ata_channel_t *ch = drive->channel;
+    uint64_t lba = req->lba;
+    uint32_t count = req->total;
+    bool lba48 = lba + count - 1 > ATA_LBA28_LIMIT;
+    uint8_t command;
+
+    if (write) {
+        command = lba48 ? ATA_CMD_WRITE_PIO_EXT : ATA_CMD_WRITE_PIO;
+    } else {
+        command = lba48 ? ATA_CMD_READ_PIO_EXT : ATA_CMD_READ_PIO;
+    }
+
+    if (ata_setup(drive, lba, count, lba48) != 0) return -1;
+    port_byte_out(ch->io + ATA_REG_COMMAND, command);
+    ata_delay(ch);
+
+    // One command moves every sector, the drive asks for each with DRQ
+    for (blockdev_request_t *seg = req; seg; seg = seg->chain) {
+        uint8_t *p = seg->buffer;
+        for (uint32_t i = 0; i < seg->count; i++) {
+            if (ata_wait(ch, true) != 0) return -1;
+            if (write) {
+                port_words_out(ch->io + ATA_REG_DATA, p, BLOCKDEV_SECTOR_SIZE / 2);
+            } else {
+                port_words_in(ch->io + ATA_REG_DATA, p, BLOCKDEV_SECTOR_SIZE / 2);
+            }
+            p += BLOCKDEV_SECTOR_SIZE;
+        }
+    }
+
+    return write ? ata_wait(ch, false) : 0;
+}
+
+/**
+ * ata_build_prd - Describe the buffers of a chain in the channel's PRD table
+ * @ch: Channel
+ * @req: First request of the chain (buffers are physical addresses,
+ *       identity mapped)
+ *
+ * Entries may not cross a 64KB boundary, so a buffer is split there.
+ *
+ * Return: 0 on success, -1 if the table is too small
+ */
+static int ata_build_prd(ata_channel_t *ch, blockdev_request_t *req) {
+    int n = 0;
+
+    for (blockdev_request_t *seg = req; seg; seg = seg->chain) {
+        uint32_t address = (uint32_t)seg->buffer;
+        uint32_t bytes = seg->count * BLOCKDEV_SECTOR_SIZE;
+
+        while (bytes > 0) {
+            if (n == ATA_PRD_ENTRIES) return -1;
+
+            uint32_t chunk = 0x10000 - (address & 0xFFFF);
+            if (chunk > bytes) chunk = bytes;
+
+            ch->prd[n].address = address;
+            ch->prd[n].bytes = chunk & 0xFFFF;
+            ch->prd[n].flags = 0;
+            address += chunk;
+            bytes -= chunk;
+            n++;
+        }
+    }
+
+    ch->prd[n - 1].flags = ATA_PRD_LAST;
+    return 0;
+}
+
+/**
+ * ata_dma_start - Start a bus-master DMA transfer
+ * @drive: Drive
+ * @req: First request of the chain (1 to ATA_MAX_SECTORS in total),
+ *       buffers 2-byte aligned
+ * @write: Direction
+ *
+ * The transfer completes through ata_irq(), from IRQ14/15 or a poll.
+ *
+ * Return: 0 if started, -1 on error
+ */
+static int ata_dma_start(ata_drive_t *drive, blockdev_request_t *req, bool write) {
+    ata_channel_t *ch = drive->channel;
+    uint64_t lba = req->lba;
+    uint32_t count = req->total;
+    bool lba48 = lba + count - 1 > ATA_LBA28_LIMIT;
+    uint8_t command;
+
+    if (write) {
+        command = lba48 ? ATA_CMD_WRITE_DMA_EXT : ATA_CMD_WRITE_DMA;
+    } else {
+        command = lba48 ? ATA_CMD_READ_DMA_EXT : ATA_CMD_READ_DMA;
+    }
+
+    if (ata_build_prd(ch, req) != 0) return -1;
+
+    // Stop the engine, load the table and clear old status
+    port_byte_out(ch->bmide + ATA_BM_COMMAND, 0);
+    port_dword_out(ch->bmide + ATA_BM_PRD, (uint32_t)ch->prd);
+    port_byte_out(ch->bmide + ATA_BM_STATUS, ATA_BM_SR_IRQ | ATA_BM_SR_ERROR);
+    port_byte_out(ch->bmide + ATA_BM_COMMAND, write ? 0 : ATA_BM_CMD_READ);
+
+    if (ata_setup(drive, lba, count, lba48) != 0) return -1;
+
+    ch->bm_status = 0;
+    ch->dma_active = true;
+    ch->dma_start = timer_get_ticks();
+    ch->dma_polls = 0;
+    port_byte_out(ch->io + ATA_REG_COMMAND, command);
+    port_byte_out(ch->bmide + ATA_BM_COMMAND,
+                  (write ? 0 : ATA_BM_CMD_READ) | ATA_BM_CMD_START);
+    return 0;
+}
+
+/**
+ * ata_dma_aligned - Check that every buffer of a chain can be used for DMA
+ * @req: First request of the chain
+ *
+ * Return: true if all buffers are 2-byte aligned
+ */
+static bool ata_dma_aligned(blockdev_request_t *req) {
+    for (blockdev_request_t *seg = req; seg; seg = seg->chain) {
+        if ((uint32_t)seg->buffer & 1) return false;
+    }
+    return true;
+}
+
+/**
+ * ata_run - Run the channel's queued requests
+ * @ch: Channel
+ *
+ * PIO transfers and flushes are polled to completion in turn; a DMA
+ * transfer is started and the queue waits for its interrupt.
+ */
+static void ata_run(ata_channel_t *ch) {
+    // Completing a request may queue the next one and call back here
+    if (ch->running) return;
+    ch->running = true;
+
+    while (ch->head && !ch->dma_active) {
+        blockdev_request_t *req = ch->head;
+        ata_drive_t *drive = req->dev->driver;
+        bool write = req->op == BLOCKDEV_OP_WRITE;
+        int result;
+
+        if (req->op == BLOCKDEV_OP_FLUSH) {
+            result = ata_flush(drive);
+        } else if (drive->dma && ata_dma_aligned(req)) {
+            if (ata_dma_start(drive, req, write) == 0) break;
+            result = -1;
+        } else {
+            result = ata_pio(drive, req, write);
+        }
+
+        ch->head = req->next;
+        blockdev_complete(req->dev, req, result);
+    }
+
+    ch->running = false;
+}
+
+/**
+ * ata_dma_finish - Complete the channel's DMA transfer and run the next
+ * @ch: Channel, with bm_status and status latched
+ */
+static void ata_dma_finish(ata_channel_t *ch) {
+    blockdev_request_t *req = ch->head;
+    int result = 0;
+
+    port_byte_out(ch->bmide + ATA_BM_COMMAND, 0);
+    if (ch->bm_status & ATA_BM_SR_ERROR) result = -1;
+    if (ch->status & (ATA_SR_ERR | ATA_SR_DF)) result = -1;
+
+    ch->dma_active = false;
+    ch->head = req->next;
+    blockdev_complete(req->dev, req, result);
+    ata_run(ch);
+}
+
+/**
+ * ata_submit - Block device submit operation
+ * @dev: Block device
+ * @req: Request
+ *
+ * The request joins its channel's queue, which drives on the same
+ * channel share.
+ *
+ * Return: 0, the queue has no limit
+ */
+static int ata_submit(blockdev_t *dev, blockdev_request_t *req) {
+    ata_channel_t *ch = ((ata_drive_t *)dev->driver)->channel;
+
+    req->next = NULL;
+    if (ch->head) {
+        ch->tail->next = req;
+    } else {
+        ch->head = req;
+    }
+    ch->tail = req;
+
+    ata_run(ch);
+    return 0;
+}
+
+/**
+ * ata_poll - Block device poll operation
+ * @dev: Block device
+ *
+ * Shell commands run inside the keyboard IRQ with interrupts off, so
+ * DMA completion is detected here from the bus master interrupt bit
+ * instead of IRQ14/15. A transfer that never finishes fails after a
+ * timeout so the queue behind it can move on.
+ */
+static void ata_poll(blockdev_t *dev) {
+    ata_channel_t *ch = ((ata_drive_t *)dev->driver)->channel;
+    if (!ch->dma_active) return;
+
+    uint8_t bm = port_byte_in(ch->bmide + ATA_BM_STATUS);
+    if (bm & (ATA_BM_SR_IRQ | ATA_BM_SR_ERROR)) {
+        ata_irq(ch);
+    } else if (++ch->dma_polls > ATA_POLL_LIMIT * 10 ||
+               timer_get_ticks() - ch->dma_start > ATA_DMA_TIMEOUT) {
+        ch->bm_status = ATA_BM_SR_ERROR;
+        ata_dma_finish(ch);
+    }
+}
+
+/**
+ * ata_cancel - Block device cancel operation
+ * @dev: Block device
+ * @req: Request, possibly merged into a queued command
+ *
+ * Commands waiting behind the channel's running one are dropped; the
+ * running one finishes, or fails through the DMA timeout in ata_poll().
+ *
+ * Return: 0 if the command holding the request was dropped, -1 if it is
+ *         running
+ */
+static int ata_cancel(blockdev_t *dev, blockdev_request_t *req) {
+    ata_channel_t *ch = ((ata_drive_t *)dev->driver)->channel;
+    blockdev_request_t *prev = ch->head;
+
+    if (!prev) return -1;
+    for (blockdev_request_t *cmd = prev->next; cmd; prev = cmd, cmd = cmd->next) {
+        for (blockdev_request_t *r = cmd; r; r = r->chain) {
+            if (r != req) continue;
+
+            prev->next = cmd->next;
+            if (ch->tail == cmd) ch->tail = prev;
+            blockdev_complete(cmd->dev, cmd, -1);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static const blockdev_ops_t ata_ops = {
+    .submit = ata_submit,
+    .poll = ata_poll,
+    .cancel = ata_cancel,
+};
+
+/**
+ * ata_identify - Probe one drive position
+ * @drive: Drive to fill in, with channel and slave set
+ *
+ * Return: 0 if an ATA disk is present, -1 otherwise
+ */
+static int ata_identify(ata_drive_t *drive) {
+    ata_channel_t *ch = drive->channel;
+    uint16_t id[256];
+
+    // A floating bus reads as all ones
+    if (port_byte_in(ch->io + ATA_REG_STATUS) == 0xFF) return -1;
+
+    port_byte_out(ch->io + ATA_REG_DRIVE, 0xA0 | (drive->slave << 4));
+    ata_delay(ch);
+    port_byte_out(ch->io + ATA_REG_SECCOUNT, 0);
+    port_byte_out(ch->io + ATA_REG_LBA0, 0);
+    port_byte_out(ch->io + ATA_REG_LBA1, 0);
+    port_byte_out(ch->io + ATA_REG_LBA2, 0);
+    port_byte_out(ch->io + ATA_REG_COMMAND, ATA_CMD_IDENTIFY);
+    ata_delay(ch);
+
+    if (port_byte_in(ch->io + ATA_REG_STATUS) == 0) return -1;
+
+    for (int i = 0; i < ATA_POLL_LIMIT; i++) {
+        if (!(port_byte_in(ch->io + ATA_REG_STATUS) & ATA_SR_BSY)) break;
+    }
+
+    // ATAPI and SATA devices answer with a signature instead
+    if (port_byte_in(ch->io + ATA_REG_LBA1) || port_byte_in(ch->io + ATA_REG_LBA2)) {
+        return -1;
+    }
+    if (ata_wait(ch, true) != 0) return -1;
+
+    port_words_in(ch->io + ATA_REG_DATA, id, 256);
+
+    drive->lba48 = (id[83] & (1 << 10)) != 0;
+    if (drive->lba48) {
+        drive->dev.sectors = (uint64_t)id[100] | ((uint64_t)id[101] << 16) |
+                             ((uint64_t)id[102] << 32) | ((uint64_t)id[103] << 48);
+    } else {
+        drive->dev.sectors = (uint32_t)id[60] | ((uint32_t)id[61] << 16);
+    }
+    drive->dma = ch->bmide != 0 && (id[49] & (1 << 8)) != 0;
+
+    // The model string is stored as byte-swapped words
+    for (int i = 0; i < 20; i++) {
+        drive->model[i * 2] = id[27 + i] >> 8;
+        drive->model[i * 2 + 1] = id[27 + i] & 0xFF;
+    }
+    int len = 40;
+    while (len > 0 && drive->model[len - 1] == ' ') len--;
+    drive->model[len] = '\0';
+
+    return drive->dev.sectors ? 0 : -1;
+}
+
+/**
+ * ata_init - Detect ATA disks and register them as block devices
+ *
+ * Disks are named hda (primary master) to hdd (secondary slave).
+ *
+ * Return: Number of disks found
+ */
+__cold int ata_init(void) {
+    pci_device_t ide;
+    uint16_t bmide = 0;
+
+    channels[0] = (ata_channel_t){.io = ATA_PRIMARY_IO, .ctrl = ATA_PRIMARY_CTRL,
+                                  .irq = ATA_PRIMARY_IRQ};
+    channels[1] = (ata_channel_t){.io = ATA_SECONDARY_IO, .ctrl = ATA_SECONDARY_CTRL,
+                                  .irq = ATA_SECONDARY_IRQ};
+
+    // Bus mastering needs the PCI IDE controller's BAR4
+    if (pci_find_class(0x01, 0x01, &ide) == 0) {
+        pci_enable(&ide);
+        bmide = pci_bar(&ide, 4);
+    }
+
+    for (int c = 0; c < 2; c++) {
+        ata_channel_t *ch = &channels[c];
+        if (bmide) {
+            ch->bmide = bmide + c * 8;
+            ch->prd = kmalloc_aligned(ATA_PRD_ENTRIES * sizeof(ata_prd_t));
+            if (!ch->prd) ch->bmide = 0;
+        }
+    }
+    irq_register_handler(ATA_PRIMARY_IRQ, ata_primary_handler);
+    irq_register_handler(ATA_SECONDARY_IRQ, ata_secondary_handler);
+
+    int found = 0;
+    for (int i = 0; i < 4; i++) {
+        ata_drive_t *drive = &drives[i];
+        drive->channel = &channels[i / 2];
+        drive->slave = i % 2;
+        if (ata_identify(drive) != 0) continue;
+
+        drive->dev.name[0] = 'h';
+        drive->dev.name[1] = 'd';
+        drive->dev.name[2] = 'a' + i;
+        drive->dev.name[3] = '\0';
+        drive->dev.max_sectors = ATA_MAX_SECTORS;
+        drive->dev.max_segments = ATA_MAX_SEGMENTS;
+        drive->dev.sched = BLOCKDEV_SCHED_DEADLINE;
+        drive->dev.ops = &ata_ops;
+        drive->dev.driver = drive;
+        if (blockdev_register(&drive->dev) != 0) continue;
+        found++;
+
+        print("  ");
+        print(drive->dev.name);
+        print(": ");
+        print(drive->model);
+        print(", ");
+        print_int(drive->dev.sectors >> 11);
+        print(" MB, ");
+        print(drive->dma ? "DMA" : "PIO");
+        print(drive->lba48 ? ", LBA48\n" : ", LBA28\n");
+    }
+
+    return found;
+}
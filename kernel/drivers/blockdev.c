@@ -0,0 +1,617 @@
+/**
+ * blockdev.c - Block device registry and request rings
+ * Names disk drivers, checks requests and queues them through each
+ * device's submission and completion rings
+ */
+
+#include "../../include/blockdev.h"
+#include "../../include/timer.h"
+#include "../../include/memory.h"
+#include "../../include/isr.h"
+
+// Requests queued at once by blockdev_read() and blockdev_write()
+#define BLOCKDEV_SYNC_BATCH 16
+
+// Iterations before a polled wait gives up
+#define BLOCKDEV_POLL_LIMIT 10000000
+
+// Milliseconds before an interrupt-driven wait gives up
+#define BLOCKDEV_TIMEOUT 5000
+
+static blockdev_t *devices[BLOCKDEV_MAX];
+static int device_count = 0;
+
+/**
+ * blockdev_register - Make a device available by name
+ * @dev: Device, must stay valid while registered
+ *
+ * Return: 0 on success, -1 if the table is full
+ */
+int blockdev_register(blockdev_t *dev) {
+    if (device_count >= BLOCKDEV_MAX) return -1;
+
+    devices[device_count++] = dev;
+    return 0;
+}
+
+/**
+ * blockdev_get - Find a device by name
+ * @name: Device name, such as "hda"
+ *
+ * Return: Device, NULL if not registered
+ */
+blockdev_t *blockdev_get(const char *name) {
+    for (int i = 0; i < device_count; i++) {
+        if (strcmp(devices[i]->name, name) == 0) return devices[i];
+    }
+    return NULL;
+}
+
+/**
+ * blockdev_at - Get a registered device by position
+ * @index: Position in registration order
+ *
+ * Return: Device, NULL past the last one
+ */
+blockdev_t *blockdev_at(int index) {
+    if (index < 0 || index >= device_count) return NULL;
+    return devices[index];
+}
+
+/**
+ * blockdev_in_range - Check that a request lies within a device
+ * @dev: Device
+ * @lba: First sector
+ * @count: Number of sectors
+ *
+ * Return: true if every sector exists
+ */
+static bool blockdev_in_range(const blockdev_t *dev, uint64_t lba, uint32_t count) {
+    return count > 0 && lba < dev->sectors && count <= dev->sectors - lba;
+}
+
+/**
+ * blockdev_before - Compare arrival or command numbers across wraparound
+ * @a: Number
+ * @b: Number
+ *
+ * Return: true if a comes before b
+ */
+static bool blockdev_before(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) < 0;
+}
+
+/**
+ * blockdev_blocked - Check whether a queued request must wait its turn
+ * @dev: Device
+ * @req: Queued request
+ *
+ * A request may not pass an earlier queued one for an overlapping range
+ * when either of them writes, or the reader would see the wrong data.
+ *
+ * Return: true if an earlier conflicting request is still queued
+ */
+static bool blockdev_blocked(blockdev_t *dev, blockdev_request_t *req) {
+    for (blockdev_request_t *r = dev->queue; r; r = r->sched_next) {
+        if (!blockdev_before(r->seq, req->seq)) continue;
+        if (r->op != BLOCKDEV_OP_WRITE && req->op != BLOCKDEV_OP_WRITE) continue;
+        if (r->lba < req->lba + req->count && req->lba < r->lba + r->count) return true;
+    }
+    return false;
+}
+
+/**
+ * blockdev_unqueue - Remove a request from the scheduler queue
+ * @dev: Device
+ * @req: Queued request
+ */
+static void blockdev_unqueue(blockdev_t *dev, blockdev_request_t *req) {
+    blockdev_request_t **link = &dev->queue;
+    while (*link != req) link = &(*link)->sched_next;
+    *link = req->sched_next;
+}
+
+/**
+ * blockdev_pick - Choose the next queued request to start
+ * @dev: Device
+ *
+ * NOOP takes the oldest request. DEADLINE takes the earliest-expired
+ * request if there is one, and otherwise sweeps upwards from the last
+ * command, returning to the lowest sector at the end (C-SCAN). After an
+ * expired request the sweep continues from it for a batch of commands,
+ * so a backlog that expires at once is not served in arrival order.
+ * Deadlines count commands rather than ticks because the timer does not
+ * advance while shell commands run.
+ *
+ * Return: Request, NULL if the queue is empty
+ */
+static blockdev_request_t *blockdev_pick(blockdev_t *dev) {
+    blockdev_request_t *oldest = NULL;
+    blockdev_request_t *expired = NULL;
+    blockdev_request_t *ahead = NULL;
+    blockdev_request_t *lowest = NULL;
+
+    for (blockdev_request_t *r = dev->queue; r; r = r->sched_next) {
+        if (blockdev_blocked(dev, r)) continue;
+
+        if (!oldest || blockdev_before(r->seq, oldest->seq)) oldest = r;
+        if (!blockdev_before(dev->dispatches, r->deadline) &&
+            (!expired || blockdev_before(r->deadline, expired->deadline) ||
+             (r->deadline == expired->deadline && blockdev_before(r->seq, expired->seq)))) {
+            expired = r;
+        }
+        if (r->lba >= dev->next_lba && (!ahead || r->lba < ahead->lba)) ahead = r;
+        if (!lowest || r->lba < lowest->lba) lowest = r;
+    }
+
+    if (dev->sched == BLOCKDEV_SCHED_NOOP) return oldest;
+    if (dev->batch > 0) {
+        dev->batch--;
+    } else if (expired) {
+        dev->batch = BLOCKDEV_SCHED_BATCH;
+        return expired;
+    }
+    return ahead ? ahead : lowest;
+}
+
+/**
+ * blockdev_merge - Take a request off the queue with the ones it can absorb
+ * @dev: Device
+ * @req: Request chosen to start
+ *
+ * Queued requests of the same kind that end where the chain starts or
+ * start where it ends are linked into one command, up to the device's
+ * sector and buffer limits.
+ *
+ * Return: First request of the chain, with total set
+ */
+static blockdev_request_t *blockdev_merge(blockdev_t *dev, blockdev_request_t *req) {
+    blockdev_request_t *first = req;
+    blockdev_request_t *last = req;
+    uint32_t segments = 1;
+    bool grown = true;
+
+    blockdev_unqueue(dev, req);
+    req->chain = NULL;
+    req->total = req->count;
+
+    while (grown && segments < dev->max_segments) {
+        grown = false;
+        for (blockdev_request_t *r = dev->queue; r; r = r->sched_next) {
+            if (r->op != req->op || first->total + r->count > dev->max_sectors) continue;
+
+            bool back = r->lba == last->lba + last->count;
+            bool front = r->lba + r->count == first->lba;
+            if ((!back && !front) || blockdev_blocked(dev, r)) continue;
+
+            blockdev_unqueue(dev, r);
+            if (back) {
+                r->chain = NULL;
+                r->total = first->total + r->count;
+                last->chain = r;
+                last = r;
+                first->total = r->total;
+            } else {
+                r->chain = first;
+                r->total = first->total + r->count;
+                first = r;
+            }
+            segments++;
+            grown = true;
+            break;
+        }
+    }
+    return first;
+}
+
+/**
+ * blockdev_dispatch - Start the next queued request
+ * @dev: Device
+ *
+ * Return: 0 if a command was started, -1 if the queue is empty or the
+ *         driver has no room
+ */
+static int blockdev_dispatch(blockdev_t *dev) {
+    blockdev_request_t *req = blockdev_pick(dev);
+    if (!req) return -1;
+
+    req = blockdev_merge(dev, req);
+    uint32_t members = 0;
+    for (blockdev_request_t *r = req; r; r = r->chain) members++;
+
+    // Accounted first: the driver may complete the chain inside submit
+    uint64_t next_lba = dev->next_lba;
+    dev->inflight += members;
+    dev->dispatches++;
+    dev->next_lba = req->lba + req->total;
+    if (dev->ops->submit(dev, req) != 0) {
+        // Back into the queue, unmerged; arrival numbers keep their order
+        dev->inflight -= members;
+        dev->dispatches--;
+        dev->next_lba = next_lba;
+        while (req) {
+            blockdev_request_t *chain = req->chain;
+            req->chain = NULL;
+            req->sched_next = dev->queue;
+            dev->queue = req;
+            req = chain;
+        }
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * blockdev_start - Hand posted requests to the driver
+ * @dev: Device
+ *
+ * Requests move from the submission ring to the scheduler up to the
+ * next flush. The flush itself starts once the scheduler is empty and
+ * every earlier request has completed, since it only covers writes the
+ * device has already finished; nothing behind it moves until it is
+ * done. Called with interrupts off.
+ */
+static void blockdev_start(blockdev_t *dev) {
+    // A driver may complete a request inside submit, which calls back here
+    if (dev->starting) return;
+    dev->starting = true;
+
+    bool started = false;
+    while (!dev->flushing) {
+        while (dev->sq_head != dev->sq_tail) {
+            blockdev_request_t *req = dev->sq[dev->sq_head % BLOCKDEV_RING_SIZE];
+            if (req->op == BLOCKDEV_OP_FLUSH) break;
+
+            dev->sq_head++;
+            req->seq = dev->seq++;
+            req->deadline = dev->dispatches + (req->op == BLOCKDEV_OP_READ ?
+                                               BLOCKDEV_READ_EXPIRE : BLOCKDEV_WRITE_EXPIRE);
+            req->sched_next = dev->queue;
+            dev->queue = req;
+        }
+
+        if (dev->queue) {
+            if (blockdev_dispatch(dev) != 0) break;
+            started = true;
+            continue;
+        }
+
+        // Only a flush can be left at the head of the ring
+        if (dev->sq_head == dev->sq_tail || dev->inflight > 0) break;
+        blockdev_request_t *req = dev->sq[dev->sq_head % BLOCKDEV_RING_SIZE];
+        req->chain = NULL;
+        req->total = 0;
+
+        dev->sq_head++;
+        dev->inflight++;
+        dev->flushing = true;
+        if (dev->ops->submit(dev, req) != 0) {
+            dev->sq_head--;
+            dev->inflight--;
+            dev->flushing = false;
+            break;
+        }
+        started = true;
+    }
+
+    if (started && dev->ops->kick) dev->ops->kick(dev);
+    dev->starting = false;
+}
+
+/**
+ * blockdev_poll - Let the driver complete finished requests
+ * @dev: Device
+ */
+static void blockdev_poll(blockdev_t *dev) {
+    if (!dev->ops->poll) return;
+
+    uint32_t flags = irq_save();
+    dev->ops->poll(dev);
+    irq_restore(flags);
+}
+
+/**
+ * blockdev_submit - Post a request to a device's submission ring
+ * @dev: Device
+ * @req: Request with op, lba, count, buffer and callback filled in
+ *
+ * The request is not started until blockdev_kick(), so several can be
+ * handed to the driver as one batch. A flush starts only once every
+ * earlier request has completed, and later ones wait for it.
+ *
+ * Return: 0 on success, -1 if the request is invalid or the ring is full
+ */
+int blockdev_submit(blockdev_t *dev, blockdev_request_t *req) {
+    if (!dev || !req) return -1;
+    if (req->op == BLOCKDEV_OP_READ || req->op == BLOCKDEV_OP_WRITE) {
+        if (!blockdev_in_range(dev, req->lba, req->count)) return -1;
+        if (req->count > dev->max_sectors) return -1;
+    } else if (req->op != BLOCKDEV_OP_FLUSH) {
+        return -1;
+    }
+
+    uint32_t flags = irq_save();
+    if (dev->outstanding == BLOCKDEV_RING_SIZE) {
+        irq_restore(flags);
+        return -1;
+    }
+
+    req->dev = dev;
+    req->result = -1;
+    req->done = false;
+    req->next = NULL;
+    dev->sq[dev->sq_tail++ % BLOCKDEV_RING_SIZE] = req;
+    dev->outstanding++;
+    irq_restore(flags);
+    return 0;
+}
+
+/**
+ * blockdev_kick - Start the requests posted to a device
+ * @dev: Device
+ */
+void blockdev_kick(blockdev_t *dev) {
+    uint32_t flags = irq_save();
+    blockdev_start(dev);
+    irq_restore(flags);
+}
+
+/**
+ * blockdev_finish - Hand a finished request back to its submitter
+ * @dev: Device
+ * @req: Request, not merged with others
+ * @result: 0 on success, -1 on error
+ */
+static void blockdev_finish(blockdev_t *dev, blockdev_request_t *req, int result) {
+    req->result = result;
+    if (req->callback) {
+        // Nothing will reap it, the slot is free once the callback runs
+        dev->outstanding--;
+        req->done = true;
+        req->callback(req);
+    } else {
+        // outstanding never exceeds the ring size, so there is always room
+        dev->cq[dev->cq_tail++ % BLOCKDEV_RING_SIZE] = req;
+        req->done = true;
+    }
+}
+
+/**
+ * blockdev_complete - Finish a request, called by drivers
+ * @dev: Device
+ * @req: Request accepted by the driver's submit operation, with its chain
+ * @result: 0 on success, -1 on error
+ *
+ * Must be called with interrupts off.
+ */
+void blockdev_complete(blockdev_t *dev, blockdev_request_t *req, int result) {
+    if (req->op == BLOCKDEV_OP_FLUSH) dev->flushing = false;
+
+    // Every request merged into the command shares its result
+    while (req) {
+        blockdev_request_t *chain = req->chain;     // A callback may reuse req
+
+        dev->inflight--;
+        blockdev_finish(dev, req, result);
+        req = chain;
+    }
+
+    // The completion may have made room in the driver
+    blockdev_start(dev);
+}
+
+/**
+ * blockdev_withdraw - Take a request off the submission ring or scheduler
+ * @dev: Device
+ * @req: Request
+ *
+ * Return: true if it was there, false if the driver has it
+ */
+static bool blockdev_withdraw(blockdev_t *dev, blockdev_request_t *req) {
+    for (uint32_t i = dev->sq_head; i != dev->sq_tail; i++) {
+        if (dev->sq[i % BLOCKDEV_RING_SIZE] != req) continue;
+
+        // Close the gap, later requests keep their order
+        for (uint32_t j = i; j + 1 != dev->sq_tail; j++) {
+            dev->sq[j % BLOCKDEV_RING_SIZE] = dev->sq[(j + 1) % BLOCKDEV_RING_SIZE];
+        }
+        dev->sq_tail--;
+        return true;
+    }
+
+    for (blockdev_request_t *r = dev->queue; r; r = r->sched_next) {
+        if (r != req) continue;
+        blockdev_unqueue(dev, req);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * blockdev_cancel - Withdraw a request that has not started
+ * @dev: Device
+ * @req: Submitted request
+ *
+ * A request still on the submission ring or in the scheduler completes
+ * at once with -1. One already handed to the driver does too if the
+ * driver can drop its command before the hardware sees it; requests
+ * merged into that command fail with it.
+ *
+ * Return: 0 if the request is done, -1 if the hardware still has it
+ */
+int blockdev_cancel(blockdev_t *dev, blockdev_request_t *req) {
+    uint32_t flags = irq_save();
+    int result = 0;
+
+    if (!req->done) {
+        if (blockdev_withdraw(dev, req)) {
+            blockdev_finish(dev, req, -1);
+        } else if (!dev->ops->cancel || dev->ops->cancel(dev, req) != 0) {
+            result = -1;
+        }
+    }
+    irq_restore(flags);
+    return result;
+}
+
+/**
+ * blockdev_reap - Take finished requests off the completion ring
+ * @dev: Device
+ * @done: Receives the finished requests
+ * @max: Size of done
+ *
+ * Polls the driver first, so completions arrive with interrupts off.
+ *
+ * Return: Number of requests stored in done
+ */
+int blockdev_reap(blockdev_t *dev, blockdev_request_t **done, int max) {
+    int n = 0;
+
+    blockdev_poll(dev);
+
+    uint32_t flags = irq_save();
+    while (n < max && dev->cq_head != dev->cq_tail) {
+        done[n++] = dev->cq[dev->cq_head++ % BLOCKDEV_RING_SIZE];
+        dev->outstanding--;
+    }
+    irq_restore(flags);
+    return n;
+}
+
+/**
+ * blockdev_wait - Wait for a submitted request to finish
+ * @dev: Device
+ * @req: Request
+ *
+ * Shell commands run inside the keyboard IRQ with interrupts off, so
+ * the driver is polled there instead of waiting for its interrupt.
+ * With interrupts on the CPU sleeps between checks; the driver is still
+ * polled after each wakeup for devices without a usable IRQ line.
+ *
+ * Returns only once the device is done with the request, so it may live
+ * on the caller's stack: on timeout the request is cancelled, and if the
+ * hardware already has it the wait goes on until the driver completes
+ * it, since the device may still write to its buffer.
+ *
+ * Return: The request's result, -1 on timeout
+ */
+int blockdev_wait(blockdev_t *dev, blockdev_request_t *req) {
+    uint32_t start = timer_get_ticks();
+    uint32_t spins = 0;
+    bool expired = false;
+
+    blockdev_kick(dev);
+    while (!req->done) {
+        uint32_t flags;
+        __asm__ __volatile__("pushf; pop %0" : "=r" (flags));
+        bool interrupts = (flags & 0x200) != 0;
+
+        if (!expired && (interrupts ? timer_get_ticks() - start > BLOCKDEV_TIMEOUT :
+                                      ++spins > BLOCKDEV_POLL_LIMIT)) {
+            expired = true;
+            if (blockdev_cancel(dev, req) == 0) break;
+        }
+        if (interrupts) __asm__ __volatile__("hlt");
+        blockdev_poll(dev);
+    }
+    return expired ? -1 : req->result;
+}
+
+/**
+ * blockdev_sync_done - Completion callback of blockdev_transfer()
+ * @req: Request
+ *
+ * The waiter watches req->done, this only keeps the request off the
+ * completion ring.
+ */
+static void blockdev_sync_done(blockdev_request_t *req) {
+    (void)req;
+}
+
+/**
+ * blockdev_transfer - Split a transfer into requests and wait for them
+ * @dev: Device
+ * @op: BLOCKDEV_OP_READ or BLOCKDEV_OP_WRITE
+ * @lba: First sector
+ * @count: Number of sectors
+ * @buffer: Data buffer
+ *
+ * Up to BLOCKDEV_SYNC_BATCH requests are started as one batch. Writes
+ * end with a flush, queued behind the last batch.
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int blockdev_transfer(blockdev_t *dev, uint8_t op, uint64_t lba, uint32_t count,
+                             void *buffer) {
+    blockdev_request_t reqs[BLOCKDEV_SYNC_BATCH + 1];
+    uint8_t *p = buffer;
+    bool failed = false;
+
+    if (!dev || !blockdev_in_range(dev, lba, count)) return -1;
+
+    while (count > 0 && !failed) {
+        int batch = 0;
+
+        while (count > 0 && batch < BLOCKDEV_SYNC_BATCH) {
+            uint32_t n = count > dev->max_sectors ? dev->max_sectors : count;
+            blockdev_request_t *req = &reqs[batch];
+
+            req->op = op;
+            req->lba = lba;
+            req->count = n;
+            req->buffer = p;
+            req->callback = blockdev_sync_done;
+            if (blockdev_submit(dev, req) != 0) break;
+            batch++;
+
+            lba += n;
+            count -= n;
+            p += n * BLOCKDEV_SECTOR_SIZE;
+        }
+
+        // Writes are only durable once the device's cache is flushed
+        if (op == BLOCKDEV_OP_WRITE && count == 0) {
+            blockdev_request_t *req = &reqs[batch];
+            req->op = BLOCKDEV_OP_FLUSH;
+            req->count = 0;
+            req->buffer = NULL;
+            req->callback = blockdev_sync_done;
+            if (blockdev_submit(dev, req) == 0) batch++;
+            else failed = true;
+        }
+
+        // Every request lives on this stack, so wait for all of them;
+        // blockdev_wait() returns only once the device has let go of each
+        if (batch == 0) return -1;
+        for (int i = 0; i < batch; i++) {
+            if (blockdev_wait(dev, &reqs[i]) != 0) failed = true;
+        }
+    }
+    return failed ? -1 : 0;
+}
+
+/**
+ * blockdev_read - Read sectors from a device
+ * @dev: Device
+ * @lba: First sector
+ * @count: Number of sectors
+ * @buffer: Buffer of count * BLOCKDEV_SECTOR_SIZE bytes
+ *
+ * Return: 0 on success, -1 on error
+ */
+int blockdev_read(blockdev_t *dev, uint64_t lba, uint32_t count, void *buffer) {
+    return blockdev_transfer(dev, BLOCKDEV_OP_READ, lba, count, buffer);
+}
+
+/**
+ * blockdev_write - Write sectors to a device and flush its cache
+ * @dev: Device
+ * @lba: First sector
+ * @count: Number of sectors
+ * @buffer: Data of count * BLOCKDEV_SECTOR_SIZE bytes
+ *
+ * Return: 0 on success, -1 on error
+ */
+int blockdev_write(blockdev_t *dev, uint64_t lba, uint32_t count, const void *buffer) {
+    return blockdev_transfer(dev, BLOCKDEV_OP_WRITE, lba, count, (void *)buffer);
+}
@@ -1,16 +1,23 @@
 /**
- * font.c - Text mode font rendering
- * Uses VGA text mode for character display
+ * font.c - Font rendering
+ * Uses VGA text mode for character display and an 8x8 bitmap font
+ * for pixel surfaces
  */
 
 #include "../../include/font.h"
 #include "../../include/vga.h"
+#include "../../include/memory.h"
 
-#define VGA_TEXT_MEMORY 0xB8000
+// Printable ASCII range covered by the bitmap font
+#define FONT_FIRST_CHAR 32
+#define FONT_GLYPH_COUNT 95
 
-// We don't need bitmap font in text mode, we use VGA's built-in font
-// This is just a placeholder
-static const uint8_t font_8x8[95][8] = {
+// Number of color pairs kept pre-expanded at the same time
+#define FONT_CACHE_PAIRS 4
+
+// 8x8 bitmap font for pixel surfaces, bit 0 is the leftmost pixel.
+// Text mode uses the VGA's built-in font instead.
+static const uint8_t font_8x8[FONT_GLYPH_COUNT][8] = {
     {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // Space
     {0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18, 0x00}, // !
     {0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // "
@@ -82,9 +89,6 @@ static const uint8_t font_8x8[95][8] = {
  * @bg_color: Background color (use 0xFF for current background)
  */
 void font_draw_char(char c, int x, int y, uint8_t color, uint8_t bg_color) {
-    if (x < 0 || x >= 80 || y < 0 || y >= 25) return;
-
-    uint16_t *video_memory = (uint16_t *)VGA_TEXT_MEMORY;
     uint8_t attribute;
 
     if (bg_color == 0xFF) {
@@ -95,8 +99,7 @@ void font_draw_char(char c, int x, int y, uint8_t color, uint8_t bg_color) {
         attribute = (bg_color << 4) | (color & 0x0F);
     }
 
-    int offset = y * 80 + x;
-    video_memory[offset] = (attribute << 8) | c;
+    vga_put_char(x, y, c, attribute);
 }
 
 /**
@@ -108,11 +111,236 @@ void font_draw_char(char c, int x, int y, uint8_t color, uint8_t bg_color) {
  * @bg_color: Background color (0xFF for transparent)
  */
 void font_draw_string(const char *str, int x, int y, uint8_t color, uint8_t bg_color) {
+    int clip_x, clip_y, clip_w, clip_h;
+    vga_get_clip(&clip_x, &clip_y, &clip_w, &clip_h);
+
+    // Whole string falls outside the clipped rows
+    if (y < clip_y || y >= clip_y + clip_h) return;
+
     int offset = 0;
-    while (*str && (x + offset) < 80) {
+    while (*str && (x + offset) < clip_x + clip_w) {
         font_draw_char(*str, x + offset, y, color, bg_color);
         offset++;
         str++;
     }
 }
 
+
+// Byte masks for four pixels, indexed by four glyph bits
+static const uint32_t nibble_mask[16] = {
+    0x00000000, 0x000000FF, 0x0000FF00, 0x0000FFFF,
+    0x00FF0000, 0x00FF00FF, 0x00FFFF00, 0x00FFFFFF,
+    0xFF000000, 0xFF0000FF, 0xFF00FF00, 0xFF00FFFF,
+    0xFFFF0000, 0xFFFF00FF, 0xFFFFFF00, 0xFFFFFFFF
+};
+
+// Glyphs expanded to pixels for one foreground/background pair.
+// Each glyph row is eight pixel bytes held in two words.
+typedef struct {
+    uint8_t color;
+    uint8_t bg_color;
+    bool valid;
+    uint32_t last_used;
+    uint32_t (*glyphs)[FONT_GLYPH_HEIGHT][2];
+} glyph_cache_t;
+
+static glyph_cache_t glyph_cache[FONT_CACHE_PAIRS];
+static uint32_t glyph_cache_clock = 0;
+
+/**
+ * font_glyph_index - Map a character to its bitmap
+ * @c: Character
+ *
+ * Return: Index into font_8x8
+ */
+static int font_glyph_index(char c) {
+    // The table stops at 'Z'; draw lowercase with the uppercase glyphs
+    if (c >= 'a' && c <= 'z') {
+        c -= 'a' - 'A';
+    }
+    if (c < FONT_FIRST_CHAR || c >= FONT_FIRST_CHAR + FONT_GLYPH_COUNT) {
+        return 0; // Space
+    }
+    return c - FONT_FIRST_CHAR;
+}
+
+/**
+ * font_cache_lookup - Get the pre-expanded glyphs for a color pair
+ * @color: Foreground color
+ * @bg_color: Background color
+ *
+ * Builds the glyphs on a miss, replacing the least recently used pair.
+ *
+ * Return: Cache entry for the pair, NULL if its storage could not be
+ *         allocated
+ */
+static glyph_cache_t *font_cache_lookup(uint8_t color, uint8_t bg_color) {
+    glyph_cache_t *victim = &glyph_cache[0];
+
+    glyph_cache_clock++;
+    for (int i = 0; i < FONT_CACHE_PAIRS; i++) {
+        glyph_cache_t *entry = &glyph_cache[i];
+        if (entry->valid && entry->color == color && entry->bg_color == bg_color) {
+            entry->last_used = glyph_cache_clock;
+            return entry;
+        }
+        if (!entry->valid || entry->last_used < victim->last_used) {
+            victim = entry;
+        }
+    }
+
+    // Storage is allocated once per slot and reused for later pairs
+    if (!victim->glyphs) {
+        victim->glyphs = kmalloc(FONT_GLYPH_COUNT * FONT_GLYPH_HEIGHT * 2 * sizeof(uint32_t));
+        if (!victim->glyphs) return NULL;   // The slot stays invalid
+    }
+
+    uint32_t fg = color * 0x01010101u;
+    uint32_t bg = bg_color * 0x01010101u;
+    for (int g = 0; g < FONT_GLYPH_COUNT; g++) {
+        for (int row = 0; row < FONT_GLYPH_HEIGHT; row++) {
+            uint8_t bits = font_8x8[g][row];
+            uint32_t lo = nibble_mask[bits & 0x0F];
+            uint32_t hi = nibble_mask[bits >> 4];
+            victim->glyphs[g][row][0] = (fg & lo) | (bg & ~lo);
+            victim->glyphs[g][row][1] = (fg & hi) | (bg & ~hi);
+        }
+    }
+
+    victim->color = color;
+    victim->bg_color = bg_color;
+    victim->valid = true;
+    victim->last_used = glyph_cache_clock;
+    return victim;
+}
+
+/**
+ * font_blit_clipped - Draw a glyph pixel by pixel
+ * @surface: Destination surface
+ * @glyph: Glyph index
+ * @x: X position in pixels
+ * @y: Y position in pixels
+ * @color: Text color
+ * @bg_color: Background color (FONT_TRANSPARENT for none)
+ *
+ * Used for glyphs that cross the surface edge, and for any glyph when
+ * the cache has no storage for its color pair.
+ */
+static void font_blit_clipped(vga_surface_t *surface, int glyph, int x, int y,
+                              uint8_t color, uint8_t bg_color) {
+    for (int row = 0; row < FONT_GLYPH_HEIGHT; row++) {
+        int py = y + row;
+        if (py < 0 || py >= surface->height) continue;
+
+        uint8_t bits = font_8x8[glyph][row];
+        uint8_t *line = surface->pixels + py * surface->pitch;
+        for (int col = 0; col < FONT_GLYPH_WIDTH; col++) {
+            int px = x + col;
+            if (px < 0 || px >= surface->width) continue;
+
+            if (bits & (1 << col)) {
+                line[px] = color;
+            } else if (bg_color != FONT_TRANSPARENT) {
+                line[px] = bg_color;
+            }
+        }
+    }
+}
+
+/**
+ * font_blit_char - Draw a bitmap glyph into a pixel surface
+ * @surface: Destination surface
+ * @c: Character to draw
+ * @x: X position in pixels
+ * @y: Y position in pixels
+ * @color: Text color
+ * @bg_color: Background color (FONT_TRANSPARENT for none)
+ *
+ * Rows are written as two 32-bit stores rather than SSE2 stores: the
+ * kernel does not enable SSE or save its registers across interrupts.
+ */
+void font_blit_char(vga_surface_t *surface, char c, int x, int y,
+                    uint8_t color, uint8_t bg_color) {
+    int glyph = font_glyph_index(c);
+
+    if (x + FONT_GLYPH_WIDTH <= 0 || x >= surface->width ||
+        y + FONT_GLYPH_HEIGHT <= 0 || y >= surface->height) {
+        return;
+    }
+    if (x < 0 || x + FONT_GLYPH_WIDTH > surface->width ||
+        y < 0 || y + FONT_GLYPH_HEIGHT > surface->height) {
+        font_blit_clipped(surface, glyph, x, y, color, bg_color);
+        return;
+    }
+
+    uint8_t *line = surface->pixels + y * surface->pitch + x;
+
+    if (bg_color == FONT_TRANSPARENT) {
+        // Masked stores keep the pixels behind the glyph
+        uint32_t fg = color * 0x01010101u;
+        for (int row = 0; row < FONT_GLYPH_HEIGHT; row++, line += surface->pitch) {
+            uint8_t bits = font_8x8[glyph][row];
+            if (!bits) continue;
+
+            uint32_t *dst = (uint32_t *)line;
+            uint32_t lo = nibble_mask[bits & 0x0F];
+            uint32_t hi = nibble_mask[bits >> 4];
+            dst[0] = (dst[0] & ~lo) | (fg & lo);
+            dst[1] = (dst[1] & ~hi) | (fg & hi);
+        }
+        return;
+    }
+
+    glyph_cache_t *cache = font_cache_lookup(color, bg_color);
+    if (!cache) {
+        font_blit_clipped(surface, glyph, x, y, color, bg_color);
+        return;
+    }
+    for (int row = 0; row < FONT_GLYPH_HEIGHT; row++, line += surface->pitch) {
+        uint32_t *dst = (uint32_t *)line;
+        dst[0] = cache->glyphs[glyph][row][0];
+        dst[1] = cache->glyphs[glyph][row][1];
+    }
+}
+
+/**
+ * font_blit_string - Draw a string of bitmap glyphs into a pixel surface
+ * @surface: Destination surface
+ * @str: String to draw
+ * @x: X position in pixels
+ * @y: Y position in pixels
+ * @color: Text color
+ * @bg_color: Background color (FONT_TRANSPARENT for none)
+ */
+void font_blit_string(vga_surface_t *surface, const char *str, int x, int y,
+                      uint8_t color, uint8_t bg_color) {
+    if (y + FONT_GLYPH_HEIGHT <= 0 || y >= surface->height) return;
+
+    // Opaque text looks the pair up once for the whole string
+    if (bg_color != FONT_TRANSPARENT &&
+        x >= 0 && y >= 0 && y + FONT_GLYPH_HEIGHT <= surface->height) {
+        glyph_cache_t *cache = font_cache_lookup(color, bg_color);
+        uint8_t *base = surface->pixels + y * surface->pitch;
+
+        // Without a cache entry the loop below draws every glyph
+        while (cache && *str && x + FONT_GLYPH_WIDTH <= surface->width) {
+            int glyph = font_glyph_index(*str);
+            uint8_t *line = base + x;
+            for (int row = 0; row < FONT_GLYPH_HEIGHT; row++, line += surface->pitch) {
+                uint32_t *dst = (uint32_t *)line;
+                dst[0] = cache->glyphs[glyph][row][0];
+                dst[1] = cache->glyphs[glyph][row][1];
+            }
+            x += FONT_GLYPH_WIDTH;
+            str++;
+        }
+    }
+
+    // Transparent text, the glyph crossing the right edge, and opaque
+    // text the cache had no room for
+    while (*str && x < surface->width) {
+        font_blit_char(surface, *str, x, y, color, bg_color);
+        x += FONT_GLYPH_WIDTH;
+        str++;
+    }
+}
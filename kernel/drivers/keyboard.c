@@ -34,7 +34,7 @@ static keyboard_mode_t current_mode = KEYBOARD_MODE_SHELL;
  * keyboard_handler - IRQ1 interrupt handler for keyboard
  * @regs: Register state (unused)
  */
-void keyboard_handler(registers_t regs) {
+__hot void keyboard_handler(registers_t regs) {
     uint8_t scancode = port_byte_in(0x60);
 
     // Handle shift keys
@@ -88,7 +88,7 @@ keyboard_mode_t keyboard_get_mode(void) {
 /**
  * keyboard_init - Initialize keyboard driver
  */
-void keyboard_init(void) {
+__cold void keyboard_init(void) {
     // Keyboard uses IRQ1 (interrupt 33)
     // Handler will be registered through IRQ system
     current_mode = KEYBOARD_MODE_SHELL;
@@ -0,0 +1,153 @@
+/**
+ * pci.c - PCI configuration space access
+ * Uses configuration mechanism #1 (ports 0xCF8/0xCFC)
+ */
+
+#include "../../include/pci.h"
+#include "../../include/ports.h"
+
+/**
+ * pci_config_read - Read a double word from a function's configuration space
+ * @bus: Bus number
+ * @slot: Device number
+ * @func: Function number
+ * @offset: Register offset, aligned to 4
+ *
+ * Return: Register value
+ */
+static uint32_t pci_config_read(uint8_t bus, uint8_t slot, uint8_t func, uint8_t offset) {
+    uint32_t address = 0x80000000u | ((uint32_t)bus << 16) | ((uint32_t)slot << 11) |
+                       ((uint32_t)func << 8) | (offset & 0xFC);
+    port_dword_out(PCI_CONFIG_ADDRESS, address);
+    return port_dword_in(PCI_CONFIG_DATA);
+}
+
+/**
+ * pci_read - Read a double word from configuration space
+ * @dev: Device
+ * @offset: Register offset, aligned to 4
+ *
+ * Return: Register value
+ */
+uint32_t pci_read(const pci_device_t *dev, uint8_t offset) {
+    return pci_config_read(dev->bus, dev->slot, dev->func, offset);
+}
+
+/**
+ * pci_write - Write a double word to configuration space
+ * @dev: Device
+ * @offset: Register offset, aligned to 4
+ * @value: Value to write
+ */
+void pci_write(const pci_device_t *dev, uint8_t offset, uint32_t value) {
+    uint32_t address = 0x80000000u | ((uint32_t)dev->bus << 16) |
+                       ((uint32_t)dev->slot << 11) | ((uint32_t)dev->func << 8) |
+                       (offset & 0xFC);
+    port_dword_out(PCI_CONFIG_ADDRESS, address);
+    port_dword_out(PCI_CONFIG_DATA, value);
+}
+
+/**
+ * pci_scan - Walk every function on every bus
+ * @match: Returns true for the wanted device
+ * @a: First match argument
+ * @b: Second match argument
+ * @dev: Receives the first matching device
+ *
+ * Return: 0 if found, -1 otherwise
+ */
+static __cold int pci_scan(bool (*match)(const pci_device_t *, uint16_t, uint16_t),
+                           uint16_t a, uint16_t b, pci_device_t *dev) {
+    for (int bus = 0; bus < 256; bus++) {
+        for (int slot = 0; slot < 32; slot++) {
+            // Only probe other functions of multi-function devices
+            int functions = 1;
+            for (int func = 0; func < functions; func++) {
+                uint32_t id = pci_config_read(bus, slot, func, PCI_VENDOR_ID);
+                if ((id & 0xFFFF) == 0xFFFF) continue;
+
+                if (func == 0 &&
+                    (pci_config_read(bus, slot, 0, PCI_HEADER) >> 16) & 0x80) {
+                    functions = 8;
+                }
+
+                uint32_t class_reg = pci_config_read(bus, slot, func, PCI_CLASS_REVISION);
+                dev->bus = bus;
+                dev->slot = slot;
+                dev->func = func;
+                dev->vendor_id = id & 0xFFFF;
+                dev->device_id = id >> 16;
+                dev->class_code = class_reg >> 24;
+                dev->subclass = (class_reg >> 16) & 0xFF;
+                dev->prog_if = (class_reg >> 8) & 0xFF;
+                dev->irq_line = pci_config_read(bus, slot, func, PCI_INTERRUPT_LINE) & 0xFF;
+
+                if (match(dev, a, b)) return 0;
+            }
+        }
+    }
+    return -1;
+}
+
+/**
+ * pci_match_class - Match a device by class and subclass
+ */
+static bool pci_match_class(const pci_device_t *dev, uint16_t class_code, uint16_t subclass) {
+    return dev->class_code == class_code && dev->subclass == subclass;
+}
+
+/**
+ * pci_match_id - Match a device by vendor and device ID
+ */
+static bool pci_match_id(const pci_device_t *dev, uint16_t vendor_id, uint16_t device_id) {
+    return dev->vendor_id == vendor_id && dev->device_id == device_id;
+}
+
+/**
+ * pci_find_class - Find the first device of a class
+ * @class_code: Base class
+ * @subclass: Subclass
+ * @dev: Receives the device
+ *
+ * Return: 0 if found, -1 otherwise
+ */
+__cold int pci_find_class(uint8_t class_code, uint8_t subclass, pci_device_t *dev) {
+    return pci_scan(pci_match_class, class_code, subclass, dev);
+}
+
+/**
+ * pci_find_device - Find the first device with a vendor and device ID
+ * @vendor_id: Vendor ID
+ * @device_id: Device ID
+ * @dev: Receives the device
+ *
+ * Return: 0 if found, -1 otherwise
+ */
+__cold int pci_find_device(uint16_t vendor_id, uint16_t device_id, pci_device_t *dev) {
+    return pci_scan(pci_match_id, vendor_id, device_id, dev);
+}
+
+/**
+ * pci_bar - Get the address of a base address register
+ * @dev: Device
+ * @index: BAR number (0-5)
+ *
+ * Return: I/O port or memory address with the flag bits cleared
+ */
+uint32_t pci_bar(const pci_device_t *dev, int index) {
+    uint32_t bar = pci_read(dev, PCI_BAR0 + index * 4);
+    if (bar & 1) {
+        return bar & ~0x3u;    // I/O space
+    }
+    return bar & ~0xFu;        // Memory space
+}
+
+/**
+ * pci_enable - Enable I/O, memory and bus-master access for a device
+ * @dev: Device
+ */
+void pci_enable(const pci_device_t *dev) {
+    uint32_t reg = pci_read(dev, PCI_COMMAND);
+    reg |= PCI_COMMAND_IO | PCI_COMMAND_MEMORY | PCI_COMMAND_BUS_MASTER;
+    pci_write(dev, PCI_COMMAND, reg & 0xFFFF);
+}
@@ -47,3 +47,49 @@ void port_word_out(uint16_t port, uint16_t data) {
     __asm__ __volatile__("out %%ax, %%dx" : : "a" (data), "d" (port));
 }
 
+
+/**
+ * port_dword_in - Read a double word from a port
+ * @port: Port number
+ *
+ * Return: Double word read from port
+ */
+uint32_t port_dword_in(uint16_t port) {
+    uint32_t result;
+    __asm__ __volatile__("in %%dx, %%eax" : "=a" (result) : "d" (port));
+    return result;
+}
+
+/**
+ * port_dword_out - Write a double word to a port
+ * @port: Port number
+ * @data: Double word to write
+ */
+void port_dword_out(uint16_t port, uint32_t data) {
+    __asm__ __volatile__("out %%eax, %%dx" : : "a" (data), "d" (port));
+}
+
+/**
+ * port_words_in - Read a block of words from a port
+ * @port: Port number
+ * @buffer: Buffer to store the words
+ * @count: Number of words
+ */
+void port_words_in(uint16_t port, void *buffer, uint32_t count) {
+    __asm__ __volatile__("cld; rep insw"
+                         : "+D" (buffer), "+c" (count)
+                         : "d" (port)
+                         : "memory");
+}
+
+/**
+ * port_words_out - Write a block of words to a port
+ * @port: Port number
+ * @buffer: Words to write
+ * @count: Number of words
+ */
+void port_words_out(uint16_t port, const void *buffer, uint32_t count) {
+    __asm__ __volatile__("cld; rep outsw"
+                         : "+S" (buffer), "+c" (count)
+                         : "d" (port));
+}
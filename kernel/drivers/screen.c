@@ -30,7 +30,7 @@ void clear_screen(void) {
  * print - Print a null-terminated string to screen
  * @str: String to print
  */
-void print(const char *str) {
+__hot void print(const char *str) {
     int i = 0;
     while (str[i] != '\0') {
         print_char(str[i]);
@@ -42,7 +42,7 @@ void print(const char *str) {
  * print_char - Print a single character at current cursor position
  * @c: Character to print
  */
-void print_char(char c) {
+__hot void print_char(char c) {
     int offset = get_cursor();
     
     if (c == '\n') {
@@ -77,7 +77,7 @@ void print_at(const char *str, int col, int row) {
  * set_cursor - Set cursor position
  * @offset: Cursor offset in video memory
  */
-void set_cursor(int offset) {
+__hot void set_cursor(int offset) {
     offset /= 2;  // Convert from byte offset to character offset
     
     // Send high byte
@@ -94,7 +94,7 @@ void set_cursor(int offset) {
  *
  * Return: Current cursor offset
  */
-int get_cursor(void) {
+__hot int get_cursor(void) {
     // Request high byte
     port_byte_out(0x3D4, 14);
     int offset = port_byte_in(0x3D5) << 8;
@@ -113,7 +113,7 @@ int get_cursor(void) {
  *
  * Return: Byte offset in video memory
  */
-static int get_screen_offset(int col, int row) {
+static __hot int get_screen_offset(int col, int row) {
     return 2 * (row * MAX_COLS + col);
 }
 
@@ -123,7 +123,7 @@ static int get_screen_offset(int col, int row) {
  *
  * Return: Row number
  */
-static int get_offset_row(int offset) {
+static __hot int get_offset_row(int offset) {
     return offset / (2 * MAX_COLS);
 }
 
@@ -142,7 +142,7 @@ static int get_offset_col(int offset) {
  * @c: Character to write
  * @offset: Byte offset in video memory
  */
-static void set_char_at_offset(char c, int offset) {
+static __hot void set_char_at_offset(char c, int offset) {
     uint8_t *vidmem = (uint8_t *)VIDEO_ADDRESS;
     vidmem[offset] = c;
     vidmem[offset + 1] = DEFAULT_COLOR;
@@ -152,7 +152,7 @@ static void set_char_at_offset(char c, int offset) {
  * print_int - Print an integer to screen
  * @n: Integer to print
  */
-void print_int(int n) {
+__hot void print_int(int n) {
     if (n == 0) {
         print_char('0');
         return;
@@ -183,7 +183,7 @@ void print_int(int n) {
  *
  * Return: Adjusted cursor offset
  */
-static int scroll_screen(int offset) {
+static __hot int scroll_screen(int offset) {
     // If cursor is within screen bounds, return
     if (offset < MAX_ROWS * MAX_COLS * 2) {
         return offset;
@@ -0,0 +1,81 @@
+/**
+ * serial.c - Serial console on COM1
+ * Polled 16550 UART output: every character waits for the transmit
+ * holding register, so output works with interrupts off
+ */
+
+#include "../../include/serial.h"
+#include "../../include/ports.h"
+
+// UART registers, offsets from the base port
+#define UART_DATA        0      // Transmit holding, divisor low with DLAB
+#define UART_IER         1      // Interrupt enable, divisor high with DLAB
+#define UART_FCR         2      // FIFO control
+#define UART_LCR         3      // Line control
+#define UART_MCR         4      // Modem control
+#define UART_LSR         5      // Line status
+
+#define UART_LCR_8N1     0x03
+#define UART_LCR_DLAB    0x80
+#define UART_FCR_ENABLE  0xC7   // Enable and clear FIFOs, 14-byte threshold
+#define UART_MCR_READY   0x03   // DTR, RTS
+#define UART_MCR_LOOP    0x10
+#define UART_LSR_THRE    0x20   // Transmit holding register empty
+
+#define UART_CLOCK       115200
+
+// Give up on a character after this many status reads
+#define SERIAL_TIMEOUT   100000
+
+static bool serial_present = false;
+
+/**
+ * serial_init - Set up COM1 for 115200 baud, 8N1
+ *
+ * A byte sent in loopback mode must come back, so a missing port is not
+ * mistaken for a UART.
+ *
+ * Return: 0 on success, -1 if no UART answers
+ */
+__cold int serial_init(void) {
+    uint16_t divisor = UART_CLOCK / SERIAL_BAUD;
+
+    port_byte_out(SERIAL_COM1 + UART_IER, 0);
+    port_byte_out(SERIAL_COM1 + UART_LCR, UART_LCR_DLAB);
+    port_byte_out(SERIAL_COM1 + UART_DATA, divisor & 0xFF);
+    port_byte_out(SERIAL_COM1 + UART_IER, divisor >> 8);
+    port_byte_out(SERIAL_COM1 + UART_LCR, UART_LCR_8N1);
+    port_byte_out(SERIAL_COM1 + UART_FCR, UART_FCR_ENABLE);
+
+    port_byte_out(SERIAL_COM1 + UART_MCR, UART_MCR_LOOP | UART_MCR_READY);
+    port_byte_out(SERIAL_COM1 + UART_DATA, 0xAE);
+    if (port_byte_in(SERIAL_COM1 + UART_DATA) != 0xAE) return -1;
+
+    port_byte_out(SERIAL_COM1 + UART_MCR, UART_MCR_READY);
+    serial_present = true;
+    return 0;
+}
+
+/**
+ * serial_putc - Send a character
+ * @c: Character, '\n' is sent as "\r\n"
+ */
+void serial_putc(char c) {
+    if (!serial_present) return;
+    if (c == '\n') serial_putc('\r');
+
+    for (int i = 0; i < SERIAL_TIMEOUT; i++) {
+        if (port_byte_in(SERIAL_COM1 + UART_LSR) & UART_LSR_THRE) break;
+    }
+    port_byte_out(SERIAL_COM1 + UART_DATA, c);
+}
+
+/**
+ * serial_write - Send a string
+ * @str: Null-terminated string
+ *
+ * Does nothing if serial_init() found no UART.
+ */
+void serial_write(const char *str) {
+    while (*str) serial_putc(*str++);
+}
@@ -0,0 +1,101 @@
+/**
+ * timer.c - Programmable Interval Timer driver
+ * Counts IRQ0 ticks and calibrates the CPU time-stamp counter
+ */
+
+#include "../../include/timer.h"
+#include "../../include/ports.h"
+
+// PIT ports and input clock
+#define PIT_CHANNEL0 0x40
+#define PIT_COMMAND  0x43
+#define PIT_BASE_HZ  1193182
+
+// Ticks spent measuring the TSC rate at boot
+#define TIMER_CALIBRATION_TICKS 10
+
+static volatile uint32_t ticks = 0;
+static uint32_t tick_hz = 0;
+static uint32_t tsc_per_ms = 0;
+
+/**
+ * timer_handler - IRQ0 interrupt handler for the PIT
+ * @regs: Register state (unused)
+ */
+__hot void timer_handler(registers_t regs) {
+    (void)regs;
+    ticks++;
+}
+
+/**
+ * timer_get_ticks - Get the number of timer interrupts since boot
+ *
+ * Return: Tick count
+ */
+__hot uint32_t timer_get_ticks(void) {
+    return ticks;
+}
+
+/**
+ * timer_read_tsc - Read the CPU time-stamp counter
+ *
+ * Return: Current TSC value
+ */
+uint64_t timer_read_tsc(void) {
+    uint32_t low, high;
+    __asm__ __volatile__("rdtsc" : "=a" (low), "=d" (high));
+    return ((uint64_t)high << 32) | low;
+}
+
+/**
+ * timer_tsc_to_us - Convert a TSC cycle count to microseconds
+ * @cycles: Cycle count
+ *
+ * Return: Microseconds, 0 if the TSC is not calibrated
+ */
+uint32_t timer_tsc_to_us(uint64_t cycles) {
+    if (tsc_per_ms == 0) return 0;
+
+    // libgcc's 64-bit division is not linked; divl divides EDX:EAX by a
+    // 32-bit value as long as the quotient fits, so counts since reset
+    // that pass 2^32 cycles still convert
+    uint32_t per_us = tsc_per_ms / 1000;
+    if (per_us == 0) per_us = 1;
+    uint32_t high = cycles >> 32;
+    if (high >= per_us) return 0xFFFFFFFF;
+
+    uint32_t us, rem;
+    __asm__("divl %4" : "=a" (us), "=d" (rem) : "a" ((uint32_t)cycles), "d" (high), "rm" (per_us));
+    return us;
+}
+
+/**
+ * timer_init - Program the PIT and calibrate the TSC
+ * @hz: Timer interrupt frequency
+ */
+__cold void timer_init(uint32_t hz) {
+    uint32_t divisor = PIT_BASE_HZ / hz;
+
+    tick_hz = hz;
+
+    // Channel 0, low/high byte access, mode 3 (square wave)
+    port_byte_out(PIT_COMMAND, 0x36);
+    port_byte_out(PIT_CHANNEL0, (uint8_t)(divisor & 0xFF));
+    port_byte_out(PIT_CHANNEL0, (uint8_t)((divisor >> 8) & 0xFF));
+
+    // Count TSC cycles across a whole number of ticks
+    uint32_t start = ticks;
+    while (ticks == start) {
+        __asm__ __volatile__("hlt");
+    }
+    uint64_t tsc_start = timer_read_tsc();
+    start = ticks;
+    while (ticks - start < TIMER_CALIBRATION_TICKS) {
+        __asm__ __volatile__("hlt");
+    }
+    uint64_t elapsed = timer_read_tsc() - tsc_start;
+
+    uint32_t ms = TIMER_CALIBRATION_TICKS * 1000 / tick_hz;
+    if (ms == 0) ms = 1;
+    tsc_per_ms = (elapsed >> 32) ? 0xFFFFFFFF : (uint32_t)elapsed / ms;
+}
@@ -12,13 +12,46 @@
 #define VGA_WIDTH 80
 #define VGA_HEIGHT 25
 
-// Simulated graphics using text mode characters
-static uint16_t *vga_memory = (uint16_t *)VGA_TEXT_MEMORY;
+// VGA input status register, bit 3 is set during vertical retrace
+#define VGA_INPUT_STATUS 0x3DA
+#define VGA_RETRACE_BIT  0x08
+
+// Simulated graphics using text mode characters. Drawing goes to a
+// back buffer that vga_present() copies to the screen.
+static uint16_t back_buffer[VGA_WIDTH * VGA_HEIGHT];
+static uint16_t *vga_memory = back_buffer;
+static uint16_t *screen_memory = (uint16_t *)VGA_TEXT_MEMORY;
+
+// Rows changed since the last present (first > last when clean)
+static int dirty_first = 0;
+static int dirty_last = VGA_HEIGHT - 1;
 static uint8_t current_color = 0x0F; // White on black
 
+// Clip rectangle (exclusive right/bottom edges), always inside the screen
+static int clip_x1 = 0;
+static int clip_y1 = 0;
+static int clip_x2 = VGA_WIDTH;
+static int clip_y2 = VGA_HEIGHT;
+
 // Character to use for "pixels" (full block)
 #define PIXEL_CHAR 0xDB
 
+/**
+ * vga_mark_dirty - Record that rows of the back buffer changed
+ * @first: First changed row
+ * @last: Last changed row
+ */
+static void vga_mark_dirty(int first, int last) {
+    if (first > last) return;
+    if (dirty_first > dirty_last) {
+        dirty_first = first;
+        dirty_last = last;
+        return;
+    }
+    if (first < dirty_first) dirty_first = first;
+    if (last > dirty_last) dirty_last = last;
+}
+
 /**
  * vga_set_mode - Initialize VGA for GUI
  * @mode: VGA mode (ignored, we use text mode)
@@ -38,9 +71,62 @@ void vga_clear_screen(uint8_t color) {
     // Attribute = (background << 4) | foreground
     uint8_t attribute = (color << 4) | VGA_COLOR_BLACK; // Background color, black text
     uint16_t blank = (attribute << 8) | ' ';
-    for (int i = 0; i < VGA_WIDTH * VGA_HEIGHT; i++) {
-        vga_memory[i] = blank;
+    for (int y = clip_y1; y < clip_y2; y++) {
+        uint16_t *row = vga_memory + y * VGA_WIDTH;
+        for (int x = clip_x1; x < clip_x2; x++) {
+            row[x] = blank;
+        }
     }
+    if (clip_x2 > clip_x1) vga_mark_dirty(clip_y1, clip_y2 - 1);
+}
+
+/**
+ * vga_set_clip - Restrict drawing to a rectangle
+ * @x, y: Top-left corner
+ * @width, height: Rectangle dimensions
+ */
+void vga_set_clip(int x, int y, int width, int height) {
+    clip_x1 = x < 0 ? 0 : x;
+    clip_y1 = y < 0 ? 0 : y;
+    clip_x2 = x + width > VGA_WIDTH ? VGA_WIDTH : x + width;
+    clip_y2 = y + height > VGA_HEIGHT ? VGA_HEIGHT : y + height;
+
+    // Keep an empty clip well-formed so loops over it do nothing
+    if (clip_x2 < clip_x1) clip_x2 = clip_x1;
+    if (clip_y2 < clip_y1) clip_y2 = clip_y1;
+}
+
+/**
+ * vga_reset_clip - Allow drawing on the whole screen
+ */
+void vga_reset_clip(void) {
+    clip_x1 = 0;
+    clip_y1 = 0;
+    clip_x2 = VGA_WIDTH;
+    clip_y2 = VGA_HEIGHT;
+}
+
+/**
+ * vga_get_clip - Get the current clip rectangle
+ * @x, y: Receive the top-left corner
+ * @width, height: Receive the dimensions
+ */
+void vga_get_clip(int *x, int *y, int *width, int *height) {
+    *x = clip_x1;
+    *y = clip_y1;
+    *width = clip_x2 - clip_x1;
+    *height = clip_y2 - clip_y1;
+}
+
+/**
+ * vga_clip_test - Check if a point lies inside the clip rectangle
+ * @x: X coordinate
+ * @y: Y coordinate
+ *
+ * Return: true if drawing at (x, y) is allowed
+ */
+bool vga_clip_test(int x, int y) {
+    return x >= clip_x1 && x < clip_x2 && y >= clip_y1 && y < clip_y2;
 }
 
 /**
@@ -50,11 +136,26 @@ void vga_clear_screen(uint8_t color) {
  * @color: Color attribute (background color)
  */
 void vga_put_pixel(int x, int y, uint8_t color) {
-    if (x >= 0 && x < VGA_WIDTH && y >= 0 && y < VGA_HEIGHT) {
+    if (vga_clip_test(x, y)) {
         int offset = y * VGA_WIDTH + x;
         // Use full block character with color as background
         uint8_t attribute = (color << 4) | color; // Same color for fg and bg
         vga_memory[offset] = (attribute << 8) | PIXEL_CHAR;
+        vga_mark_dirty(y, y);
+    }
+}
+
+/**
+ * vga_put_char - Draw a character cell
+ * @x: X coordinate (0-79)
+ * @y: Y coordinate (0-24)
+ * @c: Character
+ * @attribute: Text mode attribute (background << 4 | foreground)
+ */
+void vga_put_char(int x, int y, char c, uint8_t attribute) {
+    if (vga_clip_test(x, y)) {
+        vga_memory[y * VGA_WIDTH + x] = (attribute << 8) | (uint8_t)c;
+        vga_mark_dirty(y, y);
     }
 }
 
@@ -105,11 +206,21 @@ void vga_draw_line(int x1, int y1, int x2, int y2, uint8_t color) {
  * @color: Fill color
  */
 void vga_draw_rect(int x, int y, int width, int height, uint8_t color) {
-    for (int dy = 0; dy < height && (y + dy) < VGA_HEIGHT; dy++) {
-        for (int dx = 0; dx < width && (x + dx) < VGA_WIDTH; dx++) {
-            vga_put_pixel(x + dx, y + dy, color);
+    // Only walk the part of the rectangle that survives clipping
+    int x1 = x < clip_x1 ? clip_x1 : x;
+    int y1 = y < clip_y1 ? clip_y1 : y;
+    int x2 = x + width > clip_x2 ? clip_x2 : x + width;
+    int y2 = y + height > clip_y2 ? clip_y2 : y + height;
+
+    uint8_t attribute = (color << 4) | color;
+    uint16_t cell = (attribute << 8) | PIXEL_CHAR;
+    for (int py = y1; py < y2; py++) {
+        uint16_t *row = vga_memory + py * VGA_WIDTH;
+        for (int px = x1; px < x2; px++) {
+            row[px] = cell;
         }
     }
+    if (x2 > x1) vga_mark_dirty(y1, y2 - 1);
 }
 
 /**
@@ -128,6 +239,35 @@ void vga_draw_rect_outline(int x, int y, int width, int height, uint8_t color) {
     vga_draw_line(x + width - 1, y, x + width - 1, y + height - 1, color);
 }
 
+/**
+ * vga_wait_retrace - Wait for the start of the next vertical retrace
+ *
+ * Waits for the current retrace (if any) to end first, so two calls
+ * never return within the same retrace.
+ */
+void vga_wait_retrace(void) {
+    while (port_byte_in(VGA_INPUT_STATUS) & VGA_RETRACE_BIT);
+    while (!(port_byte_in(VGA_INPUT_STATUS) & VGA_RETRACE_BIT));
+}
+
+/**
+ * vga_present - Copy changed rows of the back buffer to the screen
+ *
+ * Return: Number of rows copied
+ */
+int vga_present(void) {
+    if (dirty_first > dirty_last) return 0;
+
+    int first = dirty_first;
+    int last = dirty_last;
+    memcpy(screen_memory + first * VGA_WIDTH, vga_memory + first * VGA_WIDTH,
+           (last - first + 1) * VGA_WIDTH * sizeof(uint16_t));
+
+    dirty_first = VGA_HEIGHT;
+    dirty_last = -1;
+    return last - first + 1;
+}
+
 /**
  * vga_set_color - Set current drawing color
  * @color: Color to use for subsequent operations
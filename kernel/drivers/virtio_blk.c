@@ -0,0 +1,337 @@
+/**
+ * virtio_blk.c - virtio block device driver
+ * Legacy PCI transport with one split virtqueue; requests from the
+ * submission ring are queued in batches behind a single notify and
+ * completions reaped in bulk
+ */
+
+#include "../../include/virtio_blk.h"
+#include "../../include/virtio.h"
+#include "../../include/blockdev.h"
+#include "../../include/pci.h"
+#include "../../include/ports.h"
+#include "../../include/isr.h"
+#include "../../include/memory.h"
+#include "../../include/screen.h"
+
+// Descriptors per request: header, data and status
+#define VBLK_CHAIN 3
+
+/**
+ * Request header read by the device
+ */
+typedef struct {
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t sector;
+} __attribute__((packed)) vblk_header_t;
+
+/**
+ * Request slot; slot i always owns descriptors i*3 to i*3+2
+ */
+typedef struct {
+    vblk_header_t header;
+    volatile uint8_t status;    // Written by the device
+    blockdev_request_t *req;    // Request in flight, NULL if the slot is free
+} vblk_request_t;
+
+/**
+ * virtio block device with its queue
+ */
+typedef struct {
+    uint16_t io;
+    uint8_t irq;
+    uint16_t queue_size;
+    uint16_t max_requests;      // Request slots that fit in the queue
+    virtq_desc_t *desc;
+    volatile virtq_avail_t *avail;
+    volatile virtq_used_t *used;
+    uint16_t last_used;         // Next used ring entry to reap
+    uint16_t pending;           // Chains queued since the last notify
+    bool flush;                 // Device accepts flush requests
+    vblk_request_t requests[VIRTIO_BLK_MAX_REQUESTS];
+    blockdev_t dev;
+} vblk_device_t;
+
+static vblk_device_t vblk;
+
+/**
+ * vblk_barrier - Keep the compiler from reordering ring accesses
+ *
+ * x86 keeps stores in order with other stores and loads in order with
+ * other loads, so the descriptor writes before an index update, and the
+ * used index read before the entries it covers, only need the compiler.
+ * A store followed by a load needs vblk_fence().
+ */
+static inline void vblk_barrier(void) {
+    __asm__ __volatile__("" ::: "memory");
+}
+
+/**
+ * vblk_fence - Full memory barrier
+ *
+ * x86 may satisfy a load before an earlier store has left the store
+ * buffer. A locked instruction drains it, like mfence, on any CPU.
+ */
+static inline void vblk_fence(void) {
+    __asm__ __volatile__("lock; addl $0, (%%esp)" ::: "memory", "cc");
+}
+
+/**
+ * vblk_queue - Add a request to the available ring without notifying
+ * @vd: Device
+ * @slot: Request slot
+ * @type: VIRTIO_BLK_T_* request type
+ * @lba: First sector
+ * @buffer: Data buffer, NULL for flush
+ * @count: Number of sectors
+ *
+ * The chain stays invisible to the device until vblk_kick().
+ */
+static void vblk_queue(vblk_device_t *vd, int slot, uint32_t type, uint64_t lba,
+                       void *buffer, uint32_t count) {
+    vblk_request_t *req = &vd->requests[slot];
+    uint16_t head = slot * VBLK_CHAIN;
+    virtq_desc_t *d = &vd->desc[head];
+
+    req->header.type = type;
+    req->header.reserved = 0;
+    req->header.sector = lba;
+    req->status = 0xFF;
+
+    d[0].addr = (uint32_t)&req->header;
+    d[0].len = sizeof(vblk_header_t);
+    d[0].flags = VIRTQ_DESC_F_NEXT;
+    d[0].next = head + 1;
+
+    if (buffer) {
+        d[1].addr = (uint32_t)buffer;
+        d[1].len = count * BLOCKDEV_SECTOR_SIZE;
+        d[1].flags = VIRTQ_DESC_F_NEXT | (type == VIRTIO_BLK_T_IN ? VIRTQ_DESC_F_WRITE : 0);
+        d[1].next = head + 2;
+    } else {
+        // Flush carries no data, link the header straight to the status
+        d[0].next = head + 2;
+    }
+
+    d[2].addr = (uint32_t)&req->status;
+    d[2].len = 1;
+    d[2].flags = VIRTQ_DESC_F_WRITE;
+    d[2].next = 0;
+
+    vd->avail->ring[(uint16_t)(vd->avail->idx + vd->pending) % vd->queue_size] = head;
+    vd->pending++;
+}
+
+/**
+ * vblk_kick - Block device kick operation
+ * @dev: Block device
+ *
+ * Publishes every chain queued since the last kick with one notify.
+ */
+static void vblk_kick(blockdev_t *dev) {
+    vblk_device_t *vd = dev->driver;
+    if (vd->pending == 0) return;
+
+    vblk_barrier();
+    vd->avail->idx += vd->pending;
+    vd->pending = 0;
+
+    // The new index must be visible before the flags are read. Otherwise
+    // a stale NO_NOTIFY can skip the notify while the device, still seeing
+    // the old index, re-enables notifications and goes idle
+    vblk_fence();
+    if (!(vd->used->flags & VIRTQ_USED_F_NO_NOTIFY)) {
+        port_word_out(vd->io + VIRTIO_REG_QUEUE_NOTIFY, 0);
+    }
+}
+
+/**
+ * vblk_reap - Complete every chain the device has returned
+ * @vd: Device
+ *
+ * Return: Number of requests completed
+ */
+static int vblk_reap(vblk_device_t *vd) {
+    int reaped = 0;
+
+    while (vd->last_used != vd->used->idx) {
+        vblk_barrier();
+        uint32_t id = vd->used->ring[vd->last_used % vd->queue_size].id;
+        vd->last_used++;
+
+        if (id / VBLK_CHAIN >= vd->max_requests) continue;
+        vblk_request_t *slot = &vd->requests[id / VBLK_CHAIN];
+        blockdev_request_t *req = slot->req;
+        if (!req) continue;
+
+        // Free the slot first, the completion may queue a new request in it
+        slot->req = NULL;
+        blockdev_complete(&vd->dev, req, slot->status == VIRTIO_BLK_S_OK ? 0 : -1);
+        reaped++;
+    }
+    return reaped;
+}
+
+/**
+ * vblk_handler - Queue interrupt handler
+ * @regs: Register state at time of interrupt
+ *
+ * Reading the ISR status register acknowledges the interrupt. One
+ * interrupt reaps every chain completed since the last one.
+ */
+static void vblk_handler(registers_t regs) {
+    (void)regs;
+    port_byte_in(vblk.io + VIRTIO_REG_ISR_STATUS);
+    vblk_reap(&vblk);
+}
+
+/**
+ * vblk_submit - Block device submit operation
+ * @dev: Block device
+ * @req: Request
+ *
+ * Each request takes one slot, so up to max_requests are in flight.
+ *
+ * Return: 0 if queued, -1 if every slot is busy
+ */
+static int vblk_submit(blockdev_t *dev, blockdev_request_t *req) {
+    vblk_device_t *vd = dev->driver;
+
+    // Without a write cache to flush, writes are durable once complete
+    if (req->op == BLOCKDEV_OP_FLUSH && !vd->flush) {
+        blockdev_complete(dev, req, 0);
+        return 0;
+    }
+
+    for (int slot = 0; slot < vd->max_requests; slot++) {
+        if (vd->requests[slot].req) continue;
+
+        uint32_t type = VIRTIO_BLK_T_FLUSH;
+        if (req->op == BLOCKDEV_OP_READ) type = VIRTIO_BLK_T_IN;
+        if (req->op == BLOCKDEV_OP_WRITE) type = VIRTIO_BLK_T_OUT;
+
+        vd->requests[slot].req = req;
+        vblk_queue(vd, slot, type, req->lba,
+                   req->op == BLOCKDEV_OP_FLUSH ? NULL : req->buffer, req->count);
+        return 0;
+    }
+    return -1;
+}
+
+/**
+ * vblk_poll - Block device poll operation
+ * @dev: Block device
+ */
+static void vblk_poll(blockdev_t *dev) {
+    vblk_reap(dev->driver);
+}
+
+// No cancel operation: the device may take a chain as soon as it is
+// queued, and only the used ring says it is done with the buffers
+static const blockdev_ops_t vblk_ops = {
+    .submit = vblk_submit,
+    .kick = vblk_kick,
+    .poll = vblk_poll,
+};
+
+/**
+ * vblk_setup_queue - Allocate queue 0 and hand it to the device
+ * @vd: Device
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int vblk_setup_queue(vblk_device_t *vd) {
+    port_word_out(vd->io + VIRTIO_REG_QUEUE_SELECT, 0);
+    vd->queue_size = port_word_in(vd->io + VIRTIO_REG_QUEUE_SIZE);
+    if (vd->queue_size < VBLK_CHAIN) return -1;
+
+    vd->max_requests = vd->queue_size / VBLK_CHAIN;
+    if (vd->max_requests > VIRTIO_BLK_MAX_REQUESTS) {
+        vd->max_requests = VIRTIO_BLK_MAX_REQUESTS;
+    }
+
+    // Legacy layout: descriptors and available ring, then the used
+    // ring on the next page boundary
+    uint32_t n = vd->queue_size;
+    uint32_t ring = n * sizeof(virtq_desc_t) + 6 + n * 2;
+    uint32_t used_offset = (ring + VIRTQ_ALIGN - 1) & ~(VIRTQ_ALIGN - 1);
+    uint32_t size = used_offset + ((6 + n * sizeof(virtq_used_elem_t) + VIRTQ_ALIGN - 1) &
+                                   ~(VIRTQ_ALIGN - 1));
+
+    uint8_t *queue = kmalloc_aligned(size);
+    if (!queue) return -1;
+    memset(queue, 0, size);
+
+    vd->desc = (virtq_desc_t *)queue;
+    vd->avail = (virtq_avail_t *)(queue + n * sizeof(virtq_desc_t));
+    vd->used = (virtq_used_t *)(queue + used_offset);
+    vd->last_used = 0;
+    vd->pending = 0;
+
+    port_dword_out(vd->io + VIRTIO_REG_QUEUE_PFN, (uint32_t)queue / VIRTQ_ALIGN);
+    return 0;
+}
+
+/**
+ * virtio_blk_init - Detect a virtio block device and register it as vda
+ *
+ * Return: 1 if a device was found, 0 otherwise
+ */
+__cold int virtio_blk_init(void) {
+    pci_device_t pci;
+    vblk_device_t *vd = &vblk;
+
+    if (pci_find_device(VIRTIO_VENDOR_ID, VIRTIO_BLK_DEVICE_ID, &pci) != 0) return 0;
+
+    // Legacy devices expose their registers through I/O BAR0
+    uint32_t bar = pci_bar(&pci, 0);
+    if (!bar) return 0;
+    pci_enable(&pci);
+
+    vd->io = bar;
+    vd->irq = pci.irq_line;
+
+    // Reset, then announce a driver
+    port_byte_out(vd->io + VIRTIO_REG_DEVICE_STATUS, 0);
+    port_byte_out(vd->io + VIRTIO_REG_DEVICE_STATUS, VIRTIO_STATUS_ACKNOWLEDGE);
+    port_byte_out(vd->io + VIRTIO_REG_DEVICE_STATUS,
+                  VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER);
+
+    uint32_t features = port_dword_in(vd->io + VIRTIO_REG_DEVICE_FEATURES);
+    vd->flush = (features & (1u << VIRTIO_BLK_F_FLUSH)) != 0;
+    port_dword_out(vd->io + VIRTIO_REG_GUEST_FEATURES,
+                   vd->flush ? (1u << VIRTIO_BLK_F_FLUSH) : 0);
+
+    if (vblk_setup_queue(vd) != 0) {
+        port_byte_out(vd->io + VIRTIO_REG_DEVICE_STATUS, VIRTIO_STATUS_FAILED);
+        return 0;
+    }
+
+    uint16_t cfg = vd->io + VIRTIO_REG_CONFIG + VIRTIO_BLK_CONFIG_CAPACITY;
+    vd->dev.sectors = (uint64_t)port_dword_in(cfg) | ((uint64_t)port_dword_in(cfg + 4) << 32);
+
+    if (vd->irq < 16) {
+        irq_register_handler(vd->irq, vblk_handler);
+    }
+    port_byte_out(vd->io + VIRTIO_REG_DEVICE_STATUS,
+                  VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER | VIRTIO_STATUS_DRIVER_OK);
+
+    vd->dev.name[0] = 'v';
+    vd->dev.name[1] = 'd';
+    vd->dev.name[2] = 'a';
+    vd->dev.name[3] = '\0';
+    vd->dev.max_sectors = VIRTIO_BLK_MAX_SECTORS;
+    vd->dev.max_segments = 1;              // Chains have one data descriptor
+    vd->dev.sched = BLOCKDEV_SCHED_NOOP;   // No seek cost to sort for
+    vd->dev.ops = &vblk_ops;
+    vd->dev.driver = vd;
+    if (blockdev_register(&vd->dev) != 0) return 0;
+
+    print("  vda: virtio, ");
+    print_int(vd->dev.sectors >> 11);
+    print(" MB, queue ");
+    print_int(vd->queue_size);
+    print(vd->flush ? ", flush\n" : "\n");
+    return 1;
+}
@@ -0,0 +1,629 @@
+/**
+ * bcache.c - Block buffer cache
+ * Hashes (device, block) to buffers, evicts least recently used clean
+ * buffers first and writes dirty blocks back in coalesced runs
+ */
+
+#include "../../include/bcache.h"
+#include "../../include/memory.h"
+#include "../../include/timer.h"
+#include "../../include/isr.h"
+
+static bcache_buf_t buffers[BCACHE_BUFFERS];
+static bcache_buf_t *hash_table[BCACHE_HASH_SIZE];
+
+// LRU list, head is the most recently used buffer
+static bcache_buf_t *lru_head = NULL;
+static bcache_buf_t *lru_tail = NULL;
+
+// Staging area for runs of adjacent blocks, room for every buffer so a
+// whole write-back can be queued at once
+static uint8_t *run_buffer = NULL;
+
+/**
+ * Prefetch read of one run, free while n is 0
+ */
+typedef struct {
+    blockdev_request_t req;
+    bcache_buf_t *run[BCACHE_MAX_RUN];  // Held loading buffers, in block order
+    int n;
+    uint8_t *staging;                   // BCACHE_MAX_RUN blocks read by req
+} bcache_load_t;
+
+static bcache_load_t loads[BCACHE_LOADS];
+
+static uint32_t hit_count = 0;
+static uint32_t miss_count = 0;
+static uint32_t dirty_count = 0;
+static uint32_t last_flush = 0;
+
+/**
+ * bcache_hash - Hash a (device, block) pair to a bucket
+ * @dev: Block device
+ * @block: Block number
+ *
+ * Return: Bucket index
+ */
+static uint32_t bcache_hash(blockdev_t *dev, uint32_t block) {
+    uint32_t h = (((uint32_t)dev >> 4) + block) * 2654435761u;
+    return (h >> 16) & (BCACHE_HASH_SIZE - 1);
+}
+
+/**
+ * bcache_lookup - Find a cached block
+ * @dev: Block device
+ * @block: Block number
+ *
+ * Return: Buffer, NULL if not cached
+ */
+static bcache_buf_t *bcache_lookup(blockdev_t *dev, uint32_t block) {
+    bcache_buf_t *buf = hash_table[bcache_hash(dev, block)];
+
+    while (buf && (buf->dev != dev || buf->block != block)) {
+        buf = buf->hash_next;
+    }
+    return buf;
+}
+
+/**
+ * bcache_unhash - Remove a buffer from its hash chain
+ * @buf: Buffer with a device assigned
+ */
+static void bcache_unhash(bcache_buf_t *buf) {
+    bcache_buf_t **link = &hash_table[bcache_hash(buf->dev, buf->block)];
+
+    while (*link && *link != buf) {
+        link = &(*link)->hash_next;
+    }
+    if (*link) *link = buf->hash_next;
+    buf->hash_next = NULL;
+    buf->dev = NULL;
+}
+
+/**
+ * bcache_lru_unlink - Take a buffer out of the LRU list
+ * @buf: Buffer
+ */
+static void bcache_lru_unlink(bcache_buf_t *buf) {
+    if (buf->lru_prev) buf->lru_prev->lru_next = buf->lru_next;
+    else lru_head = buf->lru_next;
+    if (buf->lru_next) buf->lru_next->lru_prev = buf->lru_prev;
+    else lru_tail = buf->lru_prev;
+    buf->lru_prev = buf->lru_next = NULL;
+}
+
+/**
+ * bcache_touch - Mark a buffer as most recently used
+ * @buf: Buffer
+ */
+static void bcache_touch(bcache_buf_t *buf) {
+    if (lru_head == buf) return;
+
+    bcache_lru_unlink(buf);
+    buf->lru_next = lru_head;
+    if (lru_head) lru_head->lru_prev = buf;
+    lru_head = buf;
+    if (!lru_tail) lru_tail = buf;
+}
+
+/**
+ * bcache_find_run - Gather a dirty block with its dirty neighbours
+ * @buf: Dirty buffer
+ * @run: Receives the buffers of the run, in block order
+ *
+ * Cached dirty blocks directly before and after @buf are gathered into
+ * one run of up to BCACHE_MAX_RUN blocks.
+ *
+ * Return: Number of buffers in the run
+ */
+static int bcache_find_run(bcache_buf_t *buf, bcache_buf_t **run) {
+    blockdev_t *dev = buf->dev;
+    uint32_t start = buf->block;
+    int n = 0;
+
+    // Walk back to the first dirty block of the run
+    while (start > 0 && buf->block - (start - 1) < BCACHE_MAX_RUN) {
+        bcache_buf_t *prev = bcache_lookup(dev, start - 1);
+        if (!prev || !prev->dirty || prev->pinned) break;
+        start--;
+    }
+
+    while (n < BCACHE_MAX_RUN) {
+        bcache_buf_t *next = bcache_lookup(dev, start + n);
+        if (!next || !next->dirty || next->pinned) break;
+        run[n++] = next;
+    }
+    return n;
+}
+
+/**
+ * bcache_stage - Get the data of a run as one contiguous buffer
+ * @run: Buffers of the run
+ * @n: Number of buffers
+ * @staging: Area of at least n blocks
+ *
+ * Return: The only block's data, or @staging holding a copy of every block
+ */
+static uint8_t *bcache_stage(bcache_buf_t **run, int n, uint8_t *staging) {
+    if (n == 1) return run[0]->data;
+
+    for (int i = 0; i < n; i++) {
+        memcpy(staging + i * BCACHE_BLOCK_SIZE, run[i]->data, BCACHE_BLOCK_SIZE);
+    }
+    return staging;
+}
+
+/**
+ * bcache_write_run - Write back a dirty block with its dirty neighbours
+ * @buf: Dirty buffer
+ *
+ * Return: Number of blocks written, -1 on I/O error
+ */
+static int bcache_write_run(bcache_buf_t *buf) {
+    bcache_buf_t *run[BCACHE_MAX_RUN];
+    int n = bcache_find_run(buf, run);
+
+    if (blockdev_write(buf->dev, (uint64_t)run[0]->block * BCACHE_BLOCK_SECTORS,
+                       n * BCACHE_BLOCK_SECTORS, bcache_stage(run, n, run_buffer)) != 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        run[i]->dirty = false;
+    }
+    dirty_count -= n;
+    return n;
+}
+
+/**
+ * bcache_evict - Find a buffer to reuse
+ *
+ * The least recently used buffer that nobody holds is taken. A dirty
+ * victim is written back first, together with its dirty neighbours.
+ *
+ * Return: Free buffer, NULL if every buffer is in use or write-back failed
+ */
+static bcache_buf_t *bcache_evict(void) {
+    for (bcache_buf_t *buf = lru_tail; buf; buf = buf->lru_prev) {
+        if (buf->refcount) continue;
+
+        if (buf->dirty && bcache_write_run(buf) < 0) return NULL;
+        if (buf->dev) bcache_unhash(buf);
+        buf->valid = false;
+        buf->checked = false;
+        return buf;
+    }
+    return NULL;
+}
+
+/**
+ * bcache_acquire - Find or assign the buffer for a block and hold it
+ * @dev: Block device
+ * @block: Block number
+ *
+ * Return: Held buffer, possibly not yet valid; NULL if none is free
+ */
+static bcache_buf_t *bcache_acquire(blockdev_t *dev, uint32_t block) {
+    bcache_buf_t *buf = bcache_lookup(dev, block);
+
+    if (buf) {
+        hit_count++;
+    } else {
+        miss_count++;
+        buf = bcache_evict();
+        if (!buf) return NULL;
+
+        uint32_t bucket = bcache_hash(dev, block);
+        buf->dev = dev;
+        buf->block = block;
+        buf->hash_next = hash_table[bucket];
+        hash_table[bucket] = buf;
+    }
+
+    buf->refcount++;
+    bcache_touch(buf);
+    return buf;
+}
+
+/**
+ * bcache_init - Allocate the cache buffers
+ *
+ * Return: 0 on success, -1 if out of memory
+ */
+__cold int bcache_init(void) {
+    uint8_t *data = kmalloc(BCACHE_BUFFERS * BCACHE_BLOCK_SIZE);
+    uint8_t *staging = kmalloc(BCACHE_LOADS * BCACHE_MAX_RUN * BCACHE_BLOCK_SIZE);
+    run_buffer = kmalloc(BCACHE_BUFFERS * BCACHE_BLOCK_SIZE);
+    if (!data || !staging || !run_buffer) return -1;
+
+    for (int i = 0; i < BCACHE_LOADS; i++) {
+        loads[i].n = 0;
+        loads[i].staging = staging + i * BCACHE_MAX_RUN * BCACHE_BLOCK_SIZE;
+    }
+
+    for (int i = 0; i < BCACHE_HASH_SIZE; i++) {
+        hash_table[i] = NULL;
+    }
+
+    for (int i = 0; i < BCACHE_BUFFERS; i++) {
+        bcache_buf_t *buf = &buffers[i];
+        buf->dev = NULL;
+        buf->block = 0;
+        buf->data = data + i * BCACHE_BLOCK_SIZE;
+        buf->refcount = 0;
+        buf->valid = false;
+        buf->dirty = false;
+        buf->pinned = false;
+        buf->checked = false;
+        buf->loading = NULL;
+        buf->hash_next = NULL;
+        buf->lru_prev = i > 0 ? &buffers[i - 1] : NULL;
+        buf->lru_next = i < BCACHE_BUFFERS - 1 ? &buffers[i + 1] : NULL;
+    }
+    lru_head = &buffers[0];
+    lru_tail = &buffers[BCACHE_BUFFERS - 1];
+
+    hit_count = miss_count = dirty_count = 0;
+    last_flush = timer_get_ticks();
+    return 0;
+}
+
+/**
+ * bcache_wait_load - Wait for the prefetch read filling a buffer
+ * @buf: Held buffer
+ *
+ * The buffer is valid afterwards unless the read failed.
+ */
+static void bcache_wait_load(bcache_buf_t *buf) {
+    blockdev_request_t *req = buf->loading;
+
+    if (req) blockdev_wait(req->dev, req);
+}
+
+/**
+ * bcache_read - Get a block, reading it from the device if not cached
+ * @dev: Block device
+ * @block: Block number in BCACHE_BLOCK_SIZE units
+ *
+ * Return: Buffer holding the block, NULL on I/O error or if every
+ *         buffer is in use
+ */
+bcache_buf_t *bcache_read(blockdev_t *dev, uint32_t block) {
+    bcache_buf_t *buf = bcache_acquire(dev, block);
+    if (!buf) return NULL;
+
+    bcache_wait_load(buf);
+    if (!buf->valid) {
+        if (blockdev_read(dev, (uint64_t)block * BCACHE_BLOCK_SECTORS,
+                          BCACHE_BLOCK_SECTORS, buf->data) != 0) {
+            buf->refcount--;
+            bcache_unhash(buf);
+            return NULL;
+        }
+        buf->valid = true;
+    }
+    return buf;
+}
+
+/**
+ * bcache_get - Get a block that will be completely overwritten
+ * @dev: Block device
+ * @block: Block number
+ *
+ * Return: Buffer holding the block, NULL if every buffer is in use
+ */
+bcache_buf_t *bcache_get(blockdev_t *dev, uint32_t block) {
+    bcache_buf_t *buf = bcache_acquire(dev, block);
+    if (!buf) return NULL;
+
+    // A prefetch read landing later would overwrite the new contents
+    bcache_wait_load(buf);
+    if (!buf->valid) {
+        memset(buf->data, 0, BCACHE_BLOCK_SIZE);
+        buf->valid = true;
+    }
+    return buf;
+}
+
+/**
+ * bcache_load_done - Completion callback of a prefetch read
+ * @req: Request; data points to its bcache_load_t
+ *
+ * Copies the run into its buffers and lets go of them. After a failed
+ * read they stay invalid, so the next bcache_read() reads them itself.
+ */
+static void bcache_load_done(blockdev_request_t *req) {
+    bcache_load_t *load = req->data;
+
+    for (int i = 0; i < load->n; i++) {
+        bcache_buf_t *buf = load->run[i];
+        if (req->result == 0 && buf->dev) {
+            memcpy(buf->data, load->staging + i * BCACHE_BLOCK_SIZE, BCACHE_BLOCK_SIZE);
+            buf->valid = true;
+        }
+        buf->loading = NULL;
+        buf->refcount--;
+    }
+    load->n = 0;
+}
+
+/**
+ * bcache_load_slot - Find a free prefetch read
+ *
+ * Return: Free slot, NULL if every one is in flight
+ */
+static bcache_load_t *bcache_load_slot(void) {
+    for (int i = 0; i < BCACHE_LOADS; i++) {
+        if (loads[i].n == 0) return &loads[i];
+    }
+    return NULL;
+}
+
+/**
+ * bcache_prefetch - Load a range of blocks into the cache
+ * @dev: Block device
+ * @block: First block
+ * @count: Number of blocks, at most BCACHE_MAX_RUN are loaded
+ *
+ * Each run is held by a bcache_load_t until its read completes; with
+ * every one in flight the rest of the range is left for bcache_read().
+ *
+ * Return: Number of blocks queued, -1 if a read could not be queued
+ */
+int bcache_prefetch(blockdev_t *dev, uint32_t block, uint32_t count) {
+    uint32_t max_run = dev->max_sectors / BCACHE_BLOCK_SECTORS;
+    uint32_t i = 0;
+    int fetched = 0;
+    bool failed = false;
+
+    if (count > BCACHE_MAX_RUN) count = BCACHE_MAX_RUN;
+    if (max_run > BCACHE_MAX_RUN) max_run = BCACHE_MAX_RUN;
+
+    while (i < count) {
+        bcache_buf_t *buf = bcache_lookup(dev, block + i);
+        if (buf && (buf->valid || buf->loading)) {
+            i++;
+            continue;
+        }
+
+        bcache_load_t *load = bcache_load_slot();
+        if (!load) break;
+
+        // Hold buffers for the run of uncached blocks starting here
+        uint32_t start = i;
+        while (i < count && (uint32_t)load->n < max_run) {
+            buf = bcache_lookup(dev, block + i);
+            if (buf && (buf->valid || buf->loading)) break;
+            buf = bcache_acquire(dev, block + i);
+            if (!buf) break;
+            load->run[load->n++] = buf;
+            i++;
+        }
+        if (load->n == 0) break;    // Every buffer is in use
+
+        blockdev_request_t *req = &load->req;
+        req->op = BLOCKDEV_OP_READ;
+        req->lba = (uint64_t)(block + start) * BCACHE_BLOCK_SECTORS;
+        req->count = load->n * BCACHE_BLOCK_SECTORS;
+        req->buffer = load->staging;
+        req->callback = bcache_load_done;
+        req->data = load;
+        if (blockdev_submit(dev, req) != 0) {
+            for (int j = 0; j < load->n; j++) {
+                load->run[j]->refcount--;
+            }
+            load->n = 0;
+            failed = true;
+            break;
+        }
+
+        for (int j = 0; j < load->n; j++) {
+            load->run[j]->loading = req;
+        }
+        fetched += load->n;
+    }
+
+    if (fetched) blockdev_kick(dev);
+    return failed ? -1 : fetched;
+}
+
+/**
+ * bcache_mark_dirty - Schedule a modified buffer for write-back
+ * @buf: Buffer
+ */
+void bcache_mark_dirty(bcache_buf_t *buf) {
+    if (buf->dirty) return;
+
+    // A clean cache starts its flush interval at the first dirty block
+    if (dirty_count == 0) last_flush = timer_get_ticks();
+    buf->dirty = true;
+    dirty_count++;
+}
+
+/**
+ * bcache_release - Return a buffer obtained from bcache_read/bcache_get
+ * @buf: Buffer
+ */
+void bcache_release(bcache_buf_t *buf) {
+    if (buf && buf->refcount) buf->refcount--;
+}
+
+/**
+ * bcache_write_done - Completion callback of a write-back request
+ * @req: Request; data points to the first buffer of the run
+ *
+ * The run was marked clean when it was queued, a failed write makes it
+ * dirty again for the next flush.
+ */
+static void bcache_write_done(blockdev_request_t *req) {
+    if (req->op != BLOCKDEV_OP_WRITE || req->result == 0) return;
+
+    bcache_buf_t *first = req->data;
+    uint32_t n = req->count / BCACHE_BLOCK_SECTORS;
+    for (uint32_t i = 0; i < n; i++) {
+        bcache_buf_t *buf = bcache_lookup(first->dev, first->block + i);
+        if (buf && !buf->dirty) {
+            buf->dirty = true;
+            dirty_count++;
+        }
+    }
+}
+
+/**
+ * bcache_sync_wait - Wait for queued write-back requests
+ * @dev: Device
+ * @reqs: Requests
+ * @count: Number of requests
+ *
+ * Waits for every request, even after one has failed: they live on the
+ * caller's stack, and blockdev_wait() returns only once the device has
+ * let go of each.
+ *
+ * Return: 0 if all succeeded, -1 otherwise
+ */
+static int bcache_sync_wait(blockdev_t *dev, blockdev_request_t *reqs, int count) {
+    int result = 0;
+
+    for (int i = 0; i < count; i++) {
+        if (blockdev_wait(dev, &reqs[i]) != 0) result = -1;
+    }
+    return result;
+}
+
+/**
+ * bcache_sync_device - Write back the dirty blocks of one device
+ * @dev: Device
+ *
+ * Each run becomes one request, and up to BCACHE_SYNC_DEPTH of them
+ * are handed to the device at once instead of one write and flush per
+ * run. A single flush after the last makes them all durable.
+ *
+ * Return: Number of blocks written, -1 on I/O error
+ */
+static int bcache_sync_device(blockdev_t *dev) {
+    blockdev_request_t reqs[BCACHE_SYNC_DEPTH + 1];
+    bcache_buf_t *run[BCACHE_MAX_RUN];
+    uint32_t before = dirty_count;
+    uint32_t staged = 0;            // Blocks of run_buffer in use
+    int queued = 0;
+    bool submitted = false;
+    bool failed = false;
+
+    for (int i = 0; i < BCACHE_BUFFERS; i++) {
+        bcache_buf_t *buf = &buffers[i];
+        if (!buf->dirty || buf->pinned || buf->dev != dev) continue;
+
+        if (queued == BCACHE_SYNC_DEPTH) {
+            if (bcache_sync_wait(dev, reqs, queued) != 0) failed = true;
+            queued = 0;
+            staged = 0;
+        }
+
+        // Every dirty block fits in run_buffer, so runs never overlap there
+        int n = bcache_find_run(buf, run);
+        blockdev_request_t *req = &reqs[queued];
+        req->op = BLOCKDEV_OP_WRITE;
+        req->lba = (uint64_t)run[0]->block * BCACHE_BLOCK_SECTORS;
+        req->count = n * BCACHE_BLOCK_SECTORS;
+        req->buffer = bcache_stage(run, n, run_buffer + staged * BCACHE_BLOCK_SIZE);
+        req->callback = bcache_write_done;
+        req->data = run[0];
+        if (blockdev_submit(dev, req) != 0) {
+            failed = true;
+            continue;
+        }
+        if (n > 1) staged += n;
+        queued++;
+        submitted = true;
+
+        for (int j = 0; j < n; j++) {
+            run[j]->dirty = false;
+        }
+        dirty_count -= n;
+    }
+    if (!submitted) return failed ? -1 : 0;
+
+    // The flush starts once every write before it has completed
+    blockdev_request_t *flush = &reqs[queued];
+    flush->op = BLOCKDEV_OP_FLUSH;
+    flush->count = 0;
+    flush->buffer = NULL;
+    flush->callback = bcache_write_done;
+    if (blockdev_submit(dev, flush) == 0) {
+        queued++;
+    } else {
+        failed = true;
+    }
+    if (bcache_sync_wait(dev, reqs, queued) != 0) failed = true;
+
+    return failed ? -1 : (int)(before - dirty_count);
+}
+
+/**
+ * bcache_sync - Write back dirty blocks
+ * @dev: Device to flush, NULL for all devices
+ *
+ * Return: Number of blocks written, -1 on I/O error
+ */
+int bcache_sync(blockdev_t *dev) {
+    int written = 0;
+    bool failed = false;
+
+    for (int i = 0; blockdev_at(i); i++) {
+        if (dev && blockdev_at(i) != dev) continue;
+
+        int n = bcache_sync_device(blockdev_at(i));
+        if (n < 0) {
+            failed = true;
+        } else {
+            written += n;
+        }
+    }
+
+    last_flush = timer_get_ticks();
+    return failed ? -1 : written;
+}
+
+/**
+ * bcache_invalidate - Drop every cached block of a device
+ * @dev: Device
+ */
+void bcache_invalidate(blockdev_t *dev) {
+    for (int i = 0; i < BCACHE_BUFFERS; i++) {
+        bcache_buf_t *buf = &buffers[i];
+        if (buf->dev != dev) continue;
+
+        if (buf->dirty) dirty_count--;
+        bcache_unhash(buf);
+        buf->valid = false;
+        buf->dirty = false;
+        buf->checked = false;
+    }
+}
+
+/**
+ * bcache_writeback - Periodic background flush
+ *
+ * The flush runs with interrupts off, like shell commands, so it can
+ * never interleave with a command that is using the cache.
+ */
+void bcache_writeback(void) {
+    if (dirty_count == 0) return;
+    if (timer_get_ticks() - last_flush < BCACHE_FLUSH_INTERVAL) return;
+
+    uint32_t flags = irq_save();
+    bcache_sync(NULL);
+    irq_restore(flags);
+}
+
+/**
+ * bcache_stats - Get cache statistics
+ * @hits: Receives the number of lookups served from the cache
+ * @misses: Receives the number of lookups that needed a buffer
+ * @dirty: Receives the number of dirty buffers
+ */
+void bcache_stats(uint32_t *hits, uint32_t *misses, uint32_t *dirty) {
+    *hits = hit_count;
+    *misses = miss_count;
+    *dirty = dirty_count;
+}
@@ -1,182 +1,1499 @@
 /**
  * filesystem.c - Simple in-memory file system
- * Provides basic file operations
+ * Provides basic file and directory operations
  */
 
 #include "../../include/filesystem.h"
 #include "../../include/memory.h"
 #include "../../include/screen.h"
+#include "../../include/lz4.h"
+#include "../../include/crc32c.h"
+
+#define FS_INDEX_MASK (FS_INDEX_SIZE - 1)
+#define FS_INDEX_EMPTY -1
+
+// Slot of the root directory, never freed
+#define FS_ROOT 0
 
 // File system storage
 static file_t files[MAX_FILES];
 
+// Open-addressing (parent, name) index (linear probing) holding file indices
+static int16_t name_index[FS_INDEX_SIZE];
+
+// Stack of unused file slots
+static int16_t free_slots[MAX_FILES];
+static int free_count = 0;
+
+// Current working directory
+static int cwd = FS_ROOT;
+
+/**
+ * Dentry cache entry: a whole path resolved from a base directory.
+ * Positive entries stay valid while the target slot keeps its
+ * generation, negative entries (target -1) while nothing is created.
+ */
+typedef struct {
+    uint32_t hash;
+    int16_t base;
+    int16_t target;
+    uint32_t generation;
+    char path[FS_PATH_MAX];
+} dentry_t;
+
+static dentry_t dcache[FS_DCACHE_SIZE];
+
+// Bumped on every create, invalidates all negative entries
+static uint32_t create_generation = 1;
+
+// Scratch space for one decoded chunk and one compressed chunk
+static uint8_t chunk_buffer[FS_CHUNK_SIZE];
+static uint8_t chunk_packed[FS_CHUNK_SIZE];
+
+/**
+ * fs_init - Initialize the file system
+ */
+__cold void fs_init(void) {
+    for (int i = 0; i < MAX_FILES; i++) {
+        files[i].in_use = false;
+        files[i].name[0] = '\0';
+        files[i].size = 0;
+        files[i].hash = 0;
+        files[i].extents = NULL;
+        files[i].extent_count = 0;
+        files[i].mapped = NULL;
+        files[i].csums = NULL;
+        files[i].csum_slots = 0;
+        files[i].chunks = NULL;
+        files[i].chunk_slots = 0;
+        files[i].flags = 0;
+        files[i].generation = 0;
+        files[i].parent = FS_ROOT;
+        files[i].type = FS_TYPE_FILE;
+    }
+
+    // The root directory is its own parent and is not in the index
+    files[FS_ROOT].in_use = true;
+    files[FS_ROOT].type = FS_TYPE_DIR;
+    files[FS_ROOT].generation = 1;
+    cwd = FS_ROOT;
+
+    for (int i = 0; i < FS_INDEX_SIZE; i++) {
+        name_index[i] = FS_INDEX_EMPTY;
+    }
+
+    for (int i = 0; i < FS_DCACHE_SIZE; i++) {
+        dcache[i].path[0] = '\0';
+        dcache[i].generation = 0;
+    }
+    create_generation = 1;
+
+    // Push in reverse so the lowest slots are handed out first
+    free_count = 0;
+    for (int i = MAX_FILES - 1; i > FS_ROOT; i--) {
+        free_slots[free_count++] = i;
+    }
+}
+
+/**
+ * fs_hash - Hash a string (CRC32C)
+ * @seed: Value mixed in before the string
+ * @str: String to hash
+ *
+ * Return: 32-bit hash
+ */
+static uint32_t fs_hash(uint32_t seed, const char *str) {
+    return crc32c(seed, str, strlen(str));
+}
+
+/**
+ * fs_lookup - Probe the name index
+ * @parent: Directory holding the entry
+ * @name: Name of the entry
+ * @hash: Hash of parent and name
+ * @pos: Receives the index slot holding the entry, or the empty slot
+ *       where it would be inserted
+ *
+ * Names are only compared when the stored hash matches.
+ *
+ * Return: Index of entry, -1 if not found
+ */
+static int fs_lookup(int parent, const char *name, uint32_t hash, int *pos) {
+    int i = hash & FS_INDEX_MASK;
+
+    // The index is at most half full, so an empty slot always ends the probe
+    while (name_index[i] != FS_INDEX_EMPTY) {
+        int idx = name_index[i];
+        if (files[idx].hash == hash && files[idx].parent == parent &&
+            strcmp(files[idx].name, name) == 0) {
+            *pos = i;
+            return idx;
+        }
+        i = (i + 1) & FS_INDEX_MASK;
+    }
+
+    *pos = i;
+    return -1;
+}
+
+/**
+ * fs_index_remove - Remove an entry from the name index
+ * @pos: Index slot to clear
+ *
+ * Later entries of the same probe run are shifted back into the hole,
+ * so no tombstones are needed and probe runs stay short.
+ */
+static void fs_index_remove(int pos) {
+    int hole = pos;
+    int i = pos;
+
+    name_index[hole] = FS_INDEX_EMPTY;
+    while (1) {
+        i = (i + 1) & FS_INDEX_MASK;
+        if (name_index[i] == FS_INDEX_EMPTY) return;
+
+        // Leave the entry if its home slot lies cyclically in (hole, i]
+        int home = files[name_index[i]].hash & FS_INDEX_MASK;
+        if (hole <= i ? (home > hole && home <= i) : (home > hole || home <= i)) {
+            continue;
+        }
+
+        name_index[hole] = name_index[i];
+        name_index[i] = FS_INDEX_EMPTY;
+        hole = i;
+    }
+}
+
+/**
+ * fs_extent_start - Get the file offset where an extent begins
+ * @index: Extent number
+ *
+ * Return: Offset of the first byte stored in the extent
+ */
+static uint32_t fs_extent_start(int index) {
+    return FS_EXTENT_BASE * ((1u << index) - 1);
+}
+
+/**
+ * fs_extent_of - Find the extent holding a file offset
+ * @offset: Byte offset in the file
+ *
+ * Extent i covers [BASE * (2^i - 1), BASE * (2^(i+1) - 1)), so the
+ * extent number is the highest set bit of offset / BASE + 1.
+ *
+ * Return: Extent number
+ */
+static int fs_extent_of(uint32_t offset) {
+    return 31 - __builtin_clz(offset / FS_EXTENT_BASE + 1);
+}
+
+/**
+ * fs_reserve - Make sure a file has extents covering a size
+ * @file: File to grow
+ * @size: Number of bytes that must be storable
+ *
+ * Return: 0 on success, -1 if the file would be too large or the heap
+ *         is exhausted
+ */
+static int fs_reserve(file_t *file, uint32_t size) {
+    if (size == 0) return 0;
+    if (size > MAX_FILE_SIZE) return -1;
+
+    if (!file->extents) {
+        file->extents = kmalloc(FS_MAX_EXTENTS * sizeof(char *));
+        if (!file->extents) return -1;
+    }
+
+    int last = fs_extent_of(size - 1);
+    while (file->extent_count <= last) {
+        char *extent = kmalloc(FS_EXTENT_BASE << file->extent_count);
+        if (!extent) return -1;
+        file->extents[file->extent_count++] = extent;
+    }
+    return 0;
+}
+
+/**
+ * fs_release - Free the extents a file no longer needs
+ * @file: File to shrink
+ * @size: Number of bytes still in use
+ *
+ * The checksum table goes with the last extent.
+ */
+static void fs_release(file_t *file, uint32_t size) {
+    while (file->extent_count > 0 &&
+           fs_extent_start(file->extent_count - 1) >= size) {
+        kfree(file->extents[--file->extent_count]);
+    }
+
+    if (file->extent_count == 0 && file->extents) {
+        kfree(file->extents);
+        file->extents = NULL;
+    }
+    if (file->extent_count == 0 && file->csums) {
+        kfree(file->csums);
+        file->csums = NULL;
+        file->csum_slots = 0;
+    }
+}
+
+/**
+ * fs_copy_in - Copy data into a file's extents
+ * @file: Destination file, with extents already reserved
+ * @offset: Byte offset in the file
+ * @data: Source data, NULL to fill with zeros
+ * @len: Number of bytes
+ */
+static void fs_copy_in(file_t *file, uint32_t offset, const char *data, uint32_t len) {
+    while (len > 0) {
+        int index = fs_extent_of(offset);
+        uint32_t at = offset - fs_extent_start(index);
+        uint32_t chunk = (FS_EXTENT_BASE << index) - at;
+        if (chunk > len) chunk = len;
+
+        if (data) {
+            memcpy(file->extents[index] + at, data, chunk);
+            data += chunk;
+        } else {
+            memset(file->extents[index] + at, 0, chunk);
+        }
+        offset += chunk;
+        len -= chunk;
+    }
+}
+
+/**
+ * fs_copy_out - Copy data out of a file's extents
+ * @file: Source file
+ * @offset: Byte offset in the file
+ * @buffer: Destination buffer
+ * @len: Number of bytes, must lie within the file
+ */
+static void fs_copy_out(const file_t *file, uint32_t offset, char *buffer, uint32_t len) {
+    while (len > 0) {
+        int index = fs_extent_of(offset);
+        uint32_t at = offset - fs_extent_start(index);
+        uint32_t chunk = (FS_EXTENT_BASE << index) - at;
+        if (chunk > len) chunk = len;
+
+        memcpy(buffer, file->extents[index] + at, chunk);
+        offset += chunk;
+        buffer += chunk;
+        len -= chunk;
+    }
+}
+
+/**
+ * fs_extent_crc - Checksum a range of a file's extents
+ * @file: Plain file
+ * @offset: Byte offset in the file
+ * @len: Number of bytes, must lie within the extents
+ *
+ * Return: CRC32C of the range
+ */
+static uint32_t fs_extent_crc(const file_t *file, uint32_t offset, uint32_t len) {
+    uint32_t crc = 0;
+
+    while (len > 0) {
+        int index = fs_extent_of(offset);
+        uint32_t at = offset - fs_extent_start(index);
+        uint32_t chunk = (FS_EXTENT_BASE << index) - at;
+        if (chunk > len) chunk = len;
+
+        crc = crc32c(crc, file->extents[index] + at, chunk);
+        offset += chunk;
+        len -= chunk;
+    }
+    return crc;
+}
+
+/**
+ * fs_csum_table - Make room for the block checksums of a plain file
+ * @file: Plain file
+ * @size: File size the table must cover
+ *
+ * The table doubles when it grows.
+ *
+ * Return: 0 on success, -1 if out of memory
+ */
+static int fs_csum_table(file_t *file, uint32_t size) {
+    uint32_t count = (size + FS_CSUM_BLOCK - 1) / FS_CSUM_BLOCK;
+    if (count <= file->csum_slots) return 0;
+
+    uint32_t slots = file->csum_slots ? file->csum_slots : 4;
+    while (slots < count) slots *= 2;
+
+    uint32_t *table = kmalloc(slots * sizeof(uint32_t));
+    if (!table) return -1;
+    if (file->csums) {
+        memcpy(table, file->csums, file->csum_slots * sizeof(uint32_t));
+        kfree(file->csums);
+    }
+
+    file->csums = table;
+    file->csum_slots = slots;
+    return 0;
+}
+
+/**
+ * fs_csum_of - Checksum one block of a plain file as it is now
+ * @file: Plain file
+ * @block: Block number, within the file
+ *
+ * The last block only covers the bytes up to the end of the file.
+ *
+ * Return: CRC32C of the block
+ */
+static uint32_t fs_csum_of(const file_t *file, uint32_t block) {
+    uint32_t start = block * FS_CSUM_BLOCK;
+    uint32_t len = file->size - start;
+    if (len > FS_CSUM_BLOCK) len = FS_CSUM_BLOCK;
+
+    return fs_extent_crc(file, start, len);
+}
+
+/**
+ * fs_csum_update - Recompute the checksums of the blocks holding a range
+ * @file: Plain file, with the table covering its size
+ * @offset: First changed byte
+ * @end: End of the changed bytes, clipped to the file size
+ */
+static void fs_csum_update(file_t *file, uint32_t offset, uint32_t end) {
+    if (end > file->size) end = file->size;
+
+    for (uint32_t block = offset / FS_CSUM_BLOCK; block * FS_CSUM_BLOCK < end; block++) {
+        file->csums[block] = fs_csum_of(file, block);
+    }
+}
+
+/**
+ * fs_csum_verify - Check the blocks holding a range against their checksums
+ * @file: Plain file
+ * @offset: First byte
+ * @end: End of the range, clipped to the file size
+ *
+ * Return: 0 if every block matches, -1 if the data is corrupt
+ */
+static int fs_csum_verify(const file_t *file, uint32_t offset, uint32_t end) {
+    if (end > file->size) end = file->size;
+
+    for (uint32_t block = offset / FS_CSUM_BLOCK; block * FS_CSUM_BLOCK < end; block++) {
+        if (file->csums[block] != fs_csum_of(file, block)) return -1;
+    }
+    return 0;
+}
+
+/**
+ * fs_chunk_table - Make room for a number of chunks in a file's chunk table
+ * @file: Compressed file
+ * @count: Number of chunks the table must hold
+ *
+ * The table doubles when it grows, new entries are empty.
+ *
+ * Return: 0 on success, -1 if out of memory
+ */
+static int fs_chunk_table(file_t *file, uint32_t count) {
+    if (count <= file->chunk_slots) return 0;
+
+    uint32_t slots = file->chunk_slots ? file->chunk_slots : 4;
+    while (slots < count) slots *= 2;
+
+    fs_chunk_t **table = kmalloc(slots * sizeof(fs_chunk_t *));
+    if (!table) return -1;
+    for (uint32_t i = 0; i < slots; i++) {
+        table[i] = i < file->chunk_slots ? file->chunks[i] : NULL;
+    }
+
+    if (file->chunks) kfree(file->chunks);
+    file->chunks = table;
+    file->chunk_slots = slots;
+    return 0;
+}
+
+/**
+ * fs_chunks_release - Free the chunks of a compressed file from an index on
+ * @file: Compressed file
+ * @keep: Number of leading chunks to keep
+ */
+static void fs_chunks_release(file_t *file, uint32_t keep) {
+    for (uint32_t i = keep; i < file->chunk_slots; i++) {
+        if (file->chunks[i]) {
+            kfree(file->chunks[i]);
+            file->chunks[i] = NULL;
+        }
+    }
+
+    if (keep == 0 && file->chunks) {
+        kfree(file->chunks);
+        file->chunks = NULL;
+        file->chunk_slots = 0;
+    }
+}
+
+/**
+ * fs_chunk_decode - Decode a chunk
+ * @chunk: Chunk
+ * @out: Receives chunk->length bytes
+ *
+ * The stored bytes are checked against the chunk's checksum before
+ * they reach the decoder.
+ *
+ * Return: 0 on success, -1 if the chunk is corrupt
+ */
+static int fs_chunk_decode(const fs_chunk_t *chunk, uint8_t *out) {
+    const uint8_t *data = (const uint8_t *)(chunk + 1);
+
+    if (crc32c(0, data, chunk->stored) != chunk->crc) return -1;
+    if (chunk->stored == chunk->length) {
+        memcpy(out, data, chunk->length);
+        return 0;
+    }
+    return lz4_decompress(data, chunk->stored, out, chunk->length) == chunk->length ? 0 : -1;
+}
+
+/**
+ * fs_chunk_load - Decode a chunk of a compressed file into a full-size buffer
+ * @file: Compressed file
+ * @index: Chunk number
+ * @out: Receives FS_CHUNK_SIZE bytes, zeros past the chunk's data
+ *
+ * Return: 0 on success, -1 if the chunk is corrupt
+ */
+static int fs_chunk_load(const file_t *file, uint32_t index, uint8_t *out) {
+    fs_chunk_t *chunk = index < file->chunk_slots ? file->chunks[index] : NULL;
+    uint32_t length = 0;
+
+    if (chunk) {
+        if (fs_chunk_decode(chunk, out) != 0) return -1;
+        length = chunk->length;
+    }
+    memset(out + length, 0, FS_CHUNK_SIZE - length);
+    return 0;
+}
+
+/**
+ * fs_chunk_store - Compress data into a chunk of a compressed file
+ * @file: Compressed file
+ * @index: Chunk number
+ * @data: Chunk data
+ * @length: Bytes of file data in the chunk, at most FS_CHUNK_SIZE
+ *
+ * The old chunk is replaced only once the new one is allocated.
+ *
+ * Return: 0 on success, -1 if out of memory
+ */
+static int fs_chunk_store(file_t *file, uint32_t index, const uint8_t *data, uint32_t length) {
+    // Keep the data raw unless compression saves at least a byte
+    int stored = lz4_compress(data, length, chunk_packed, length - 1);
+    const uint8_t *source = chunk_packed;
+    if (stored < 0) {
+        stored = length;
+        source = data;
+    }
+
+    fs_chunk_t *chunk = kmalloc(sizeof(fs_chunk_t) + stored);
+    if (!chunk) return -1;
+    if (fs_chunk_table(file, index + 1) != 0) {
+        kfree(chunk);
+        return -1;
+    }
+
+    chunk->stored = stored;
+    chunk->length = length;
+    chunk->crc = crc32c(0, source, stored);
+    memcpy(chunk + 1, source, stored);
+
+    if (file->chunks[index]) kfree(file->chunks[index]);
+    file->chunks[index] = chunk;
+    return 0;
+}
+
+/**
+ * fs_chunked_pread - Read part of a compressed file
+ * @file: Compressed file
+ * @out: Buffer to store data
+ * @offset: Byte offset, within the file
+ * @len: Number of bytes, within the file
+ *
+ * A read that wants a whole chunk decodes it straight into @out; only
+ * partial chunks go through the scratch buffer.
+ *
+ * Return: @len on success, -1 if a chunk is corrupt
+ */
+static int fs_chunked_pread(const file_t *file, uint8_t *out, uint32_t offset, uint32_t len) {
+    uint32_t done = 0;
+
+    while (done < len) {
+        uint32_t pos = offset + done;
+        uint32_t index = pos / FS_CHUNK_SIZE;
+        uint32_t at = pos % FS_CHUNK_SIZE;
+        uint32_t n = FS_CHUNK_SIZE - at;
+        if (n > len - done) n = len - done;
+
+        fs_chunk_t *chunk = index < file->chunk_slots ? file->chunks[index] : NULL;
+        if (at == 0 && chunk && n >= chunk->length) {
+            if (fs_chunk_decode(chunk, out + done) != 0) return -1;
+            memset(out + done + chunk->length, 0, n - chunk->length);
+        } else {
+            if (fs_chunk_load(file, index, chunk_buffer) != 0) return -1;
+            memcpy(out + done, chunk_buffer + at, n);
+        }
+        done += n;
+    }
+    return len;
+}
+
+/**
+ * fs_chunked_pwrite - Write part of a compressed file
+ * @file: Compressed file
+ * @data: Data to write, NULL to write zeros
+ * @offset: Byte offset to start writing at
+ * @len: Number of bytes to write
+ *
+ * Every chunk the write touches is compressed again. Chunks between the
+ * old end and @offset are left out and read as zeros.
+ *
+ * Return: Number of bytes written, -1 if too large or out of memory
+ */
+static int fs_chunked_pwrite(file_t *file, const uint8_t *data, uint32_t offset, uint32_t len) {
+    uint32_t end = offset + len;
+    uint32_t size = end > file->size ? end : file->size;
+    uint32_t done = 0;
+
+    if (end < offset || end > MAX_FILE_SIZE) return -1;
+
+    while (done < len) {
+        uint32_t pos = offset + done;
+        uint32_t index = pos / FS_CHUNK_SIZE;
+        uint32_t at = pos % FS_CHUNK_SIZE;
+        uint32_t n = FS_CHUNK_SIZE - at;
+        if (n > len - done) n = len - done;
+
+        uint32_t length = size - index * FS_CHUNK_SIZE;
+        if (length > FS_CHUNK_SIZE) length = FS_CHUNK_SIZE;
+
+        // Whole chunks are compressed straight from the caller's data
+        const uint8_t *source = data ? data + done : NULL;
+        if (at != 0 || n != length || !data) {
+            if (fs_chunk_load(file, index, chunk_buffer) != 0) return -1;
+            if (data) {
+                memcpy(chunk_buffer + at, data + done, n);
+            } else {
+                memset(chunk_buffer + at, 0, n);
+            }
+            source = chunk_buffer;
+        }
+
+        if (fs_chunk_store(file, index, source, length) != 0) return -1;
+        done += n;
+    }
+
+    if (end > file->size) {
+        file->size = end;
+    }
+    return len;
+}
+
+/**
+ * fs_chunked_truncate - Shrink a compressed file
+ * @file: Compressed file
+ * @size: New size, at most the current size
+ *
+ * Return: 0 on success, -1 if out of memory
+ */
+static int fs_chunked_truncate(file_t *file, uint32_t size) {
+    uint32_t keep = (size + FS_CHUNK_SIZE - 1) / FS_CHUNK_SIZE;
+    uint32_t tail = size % FS_CHUNK_SIZE;
+
+    // Cut the last chunk so growing the file again reads zeros
+    if (tail && keep <= file->chunk_slots && file->chunks[keep - 1] &&
+        file->chunks[keep - 1]->length > tail) {
+        if (fs_chunk_load(file, keep - 1, chunk_buffer) != 0 ||
+            fs_chunk_store(file, keep - 1, chunk_buffer, tail) != 0) {
+            return -1;
+        }
+    }
+
+    fs_chunks_release(file, keep);
+    file->size = size;
+    return 0;
+}
+
+/**
+ * fs_unshare - Copy a file's boot archive data into its own extents
+ * @file: File
+ *
+ * Return: 0 on success (or if the file is not mapped), -1 if out of memory
+ */
+static int fs_unshare(file_t *file) {
+    if (!file->mapped) return 0;
+
+    if (fs_reserve(file, file->size) != 0 || fs_csum_table(file, file->size) != 0) {
+        fs_release(file, 0);
+        return -1;
+    }
+    fs_copy_in(file, 0, file->mapped, file->size);
+    fs_csum_update(file, 0, file->size);
+    file->mapped = NULL;
+    return 0;
+}
+
+/**
+ * fs_stored_size - Get the heap space holding a file's data
+ * @file: File
+ *
+ * Return: Bytes of extents or chunks allocated
+ */
+static uint32_t fs_stored_size(const file_t *file) {
+    if (file->mapped) return 0;
+    if (!(file->flags & FS_FLAG_COMPRESS)) {
+        return fs_extent_start(file->extent_count);
+    }
+
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < file->chunk_slots; i++) {
+        if (file->chunks[i]) total += sizeof(fs_chunk_t) + file->chunks[i]->stored;
+    }
+    return total;
+}
+
+/**
+ * fs_set_compressed - Convert a file between extents and LZ4 chunks
+ * @file: File
+ * @compressed: true to compress, false to store plainly
+ *
+ * The old representation is freed only after the new one is complete.
+ *
+ * Return: 0 on success, -1 if out of memory or a chunk is corrupt
+ */
+static int fs_set_compressed(file_t *file, bool compressed) {
+    uint32_t size = file->size;
+
+    if (compressed == ((file->flags & FS_FLAG_COMPRESS) != 0)) return 0;
+    if (fs_unshare(file) != 0) return -1;
+
+    if (compressed) {
+        // Do not carry corrupt data over under fresh checksums
+        if (fs_csum_verify(file, 0, size) != 0) return -1;
+
+        for (uint32_t pos = 0; pos < size; pos += FS_CHUNK_SIZE) {
+            uint32_t n = size - pos < FS_CHUNK_SIZE ? size - pos : FS_CHUNK_SIZE;
+            fs_copy_out(file, pos, (char *)chunk_buffer, n);
+            if (fs_chunk_store(file, pos / FS_CHUNK_SIZE, chunk_buffer, n) != 0) {
+                fs_chunks_release(file, 0);
+                return -1;
+            }
+        }
+        fs_release(file, 0);
+    } else {
+        if (fs_reserve(file, size) != 0 || fs_csum_table(file, size) != 0) {
+            fs_release(file, 0);
+            return -1;
+        }
+        for (uint32_t pos = 0; pos < size; pos += FS_CHUNK_SIZE) {
+            uint32_t n = size - pos < FS_CHUNK_SIZE ? size - pos : FS_CHUNK_SIZE;
+            if (fs_chunk_load(file, pos / FS_CHUNK_SIZE, chunk_buffer) != 0) {
+                fs_release(file, 0);
+                return -1;
+            }
+            fs_copy_in(file, pos, (const char *)chunk_buffer, n);
+        }
+        fs_csum_update(file, 0, size);
+        fs_chunks_release(file, 0);
+    }
+
+    file->flags ^= FS_FLAG_COMPRESS;
+    return 0;
+}
+
+/**
+ * fs_file_pread - Read part of a file's data
+ * @file: File to read
+ * @buffer: Buffer to store data
+ * @offset: Byte offset to start reading at
+ * @len: Maximum number of bytes to read
+ *
+ * Return: Number of bytes read (0 at end of file), -1 if the data is corrupt
+ */
+static int fs_file_pread(const file_t *file, void *buffer, uint32_t offset, uint32_t len) {
+    if (offset >= file->size) {
+        return 0; // End of file
+    }
+    if (len > file->size - offset) {
+        len = file->size - offset;
+    }
+
+    // Archive data was checked as a whole when it was loaded
+    if (file->mapped) {
+        memcpy(buffer, file->mapped + offset, len);
+        return len;
+    }
+    if (file->flags & FS_FLAG_COMPRESS) {
+        return fs_chunked_pread(file, buffer, offset, len);
+    }
+    if (fs_csum_verify(file, offset, offset + len) != 0) {
+        return -1; // Corrupt data
+    }
+    fs_copy_out(file, offset, buffer, len);
+    return len;
+}
+
+/**
+ * fs_file_pwrite - Write part of a file's data
+ * @file: File to write
+ * @data: Data to write, NULL to write zeros
+ * @offset: Byte offset to start writing at
+ * @len: Number of bytes to write
+ *
+ * Return: Number of bytes written, -1 if too large or out of memory
+ */
+static int fs_file_pwrite(file_t *file, const void *data, uint32_t offset, uint32_t len) {
+    if (fs_unshare(file) != 0) {
+        return -1; // Out of memory
+    }
+    if (file->flags & FS_FLAG_COMPRESS) {
+        return fs_chunked_pwrite(file, data, offset, len);
+    }
+
+    uint32_t end = offset + len;
+    uint32_t from = offset < file->size ? offset : file->size;
+
+    // The blocks at either edge keep bytes the write does not replace
+    if (from < file->size &&
+        (fs_csum_verify(file, from, from + 1) != 0 ||
+         (end <= file->size && fs_csum_verify(file, end - 1, end) != 0))) {
+        return -1; // Corrupt data
+    }
+
+    if (end < offset || fs_reserve(file, end) != 0 || fs_csum_table(file, end) != 0) {
+        fs_release(file, file->size);
+        return -1; // Too large or out of memory
+    }
+
+    if (offset > file->size) {
+        fs_copy_in(file, file->size, NULL, offset - file->size);
+    }
+    fs_copy_in(file, offset, data, len);
+    if (end > file->size) {
+        file->size = end;
+    }
+    fs_csum_update(file, from, end);
+
+    return len;
+}
+
 /**
- * fs_init - Initialize the file system
+ * fs_walk - Resolve a path one component at a time
+ * @dir: Directory to start from
+ * @path: Path relative to @dir
+ * @cacheable: Set to false if the path uses "." or ".."
+ *
+ * Return: Index of entry, -1 if not found
  */
-void fs_init(void) {
-    for (int i = 0; i < MAX_FILES; i++) {
-        files[i].in_use = false;
-        files[i].name[0] = '\0';
-        files[i].size = 0;
+static int fs_walk(int dir, const char *path, bool *cacheable) {
+    char name[MAX_FILENAME];
+
+    while (*path) {
+        while (*path == '/') path++;
+        if (!*path) break;
+
+        int len = 0;
+        while (*path && *path != '/') {
+            if (len >= MAX_FILENAME - 1) return -1; // Name too long
+            name[len++] = *path++;
+        }
+        name[len] = '\0';
+
+        if (files[dir].type != FS_TYPE_DIR) return -1;
+
+        if (strcmp(name, ".") == 0) {
+            *cacheable = false;
+        } else if (strcmp(name, "..") == 0) {
+            *cacheable = false;
+            dir = files[dir].parent;
+        } else {
+            int pos;
+            dir = fs_lookup(dir, name, fs_hash(dir, name), &pos);
+            if (dir == -1) return -1;
+        }
     }
+
+    return dir;
 }
 
 /**
- * fs_find - Find a file by name
- * @filename: Name of the file
+ * fs_resolve - Find the entry a path refers to
+ * @path: Absolute path, or relative to the working directory
  *
- * Return: Index of file, -1 if not found
+ * Whole paths are looked up in the dentry cache first, so repeated
+ * lookups of deep paths cost one hash and one string compare.
+ *
+ * Return: Index of entry, -1 if not found
  */
-static int fs_find(const char *filename) {
-    for (int i = 0; i < MAX_FILES; i++) {
-        if (files[i].in_use && strcmp(files[i].name, filename) == 0) {
-            return i;
+static int fs_resolve(const char *path) {
+    int base = path[0] == '/' ? FS_ROOT : cwd;
+    uint32_t len = strlen(path);
+    uint32_t hash = fs_hash(base, path);
+    dentry_t *d = &dcache[hash % FS_DCACHE_SIZE];
+
+    if (d->generation != 0 && d->hash == hash && d->base == base &&
+        strcmp(d->path, path) == 0) {
+        if (d->target == -1) {
+            if (d->generation == create_generation) return -1;
+        } else if (files[d->target].in_use &&
+                   files[d->target].generation == d->generation) {
+            return d->target;
         }
     }
-    return -1;
+
+    bool cacheable = len < FS_PATH_MAX;
+    int idx = fs_walk(base, path, &cacheable);
+
+    if (cacheable) {
+        d->hash = hash;
+        d->base = base;
+        d->target = idx;
+        d->generation = idx == -1 ? create_generation : files[idx].generation;
+        strcpy(d->path, path);
+    }
+    return idx;
+}
+
+/**
+ * fs_resolve_parent - Find the directory that holds a path's last component
+ * @path: Path to split
+ * @name: Receives the last component, MAX_FILENAME bytes
+ *
+ * Return: Index of the parent directory, -1 if it does not exist or
+ *         the last component is not a valid name
+ */
+static int fs_resolve_parent(const char *path, char *name) {
+    char parent[FS_PATH_MAX];
+    uint32_t len = strlen(path);
+
+    if (len >= FS_PATH_MAX) return -1;
+
+    // Ignore trailing slashes, then split at the last one
+    while (len > 1 && path[len - 1] == '/') len--;
+    uint32_t start = len;
+    while (start > 0 && path[start - 1] != '/') start--;
+
+    uint32_t name_len = len - start;
+    if (name_len == 0 || name_len >= MAX_FILENAME) return -1;
+    memcpy(name, path + start, name_len);
+    name[name_len] = '\0';
+    if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) return -1;
+
+    // Keep the leading slash of entries directly under the root
+    uint32_t parent_len = start;
+    while (parent_len > 1 && path[parent_len - 1] == '/') parent_len--;
+    memcpy(parent, path, parent_len);
+    parent[parent_len] = '\0';
+
+    int dir = fs_resolve(parent);
+    if (dir == -1 || files[dir].type != FS_TYPE_DIR) return -1;
+    return dir;
+}
+
+/**
+ * fs_find - Find a regular file by path
+ * @path: Path of the file
+ *
+ * Return: Index of file, -1 if not found or a directory
+ */
+static int fs_find(const char *path) {
+    int idx = fs_resolve(path);
+    if (idx == -1 || files[idx].type != FS_TYPE_FILE) return -1;
+    return idx;
+}
+
+/**
+ * fs_add - Create a directory entry
+ * @path: Path of the new entry
+ * @type: FS_TYPE_FILE or FS_TYPE_DIR
+ *
+ * Return: Slot of the new entry, -1 on error
+ */
+static int fs_add(const char *path, uint8_t type) {
+    char name[MAX_FILENAME];
+    int parent = fs_resolve_parent(path, name);
+    if (parent == -1) {
+        return -1; // Bad path or missing parent
+    }
+
+    // Check if the name already exists
+    uint32_t hash = fs_hash(parent, name);
+    int pos;
+    if (fs_lookup(parent, name, hash, &pos) != -1) {
+        return -1; // Already exists
+    }
+
+    if (free_count == 0) {
+        return -1; // No space available
+    }
+
+    // Take a free slot and insert it where the probe stopped
+    int i = free_slots[--free_count];
+    files[i].in_use = true;
+    strcpy(files[i].name, name);
+    files[i].hash = hash;
+    files[i].size = 0;
+    files[i].extents = NULL;
+    files[i].extent_count = 0;
+    files[i].mapped = NULL;
+    files[i].csums = NULL;
+    files[i].csum_slots = 0;
+    files[i].chunks = NULL;
+    files[i].chunk_slots = 0;
+    files[i].flags = 0;
+    files[i].generation++;
+    files[i].parent = parent;
+    files[i].type = type;
+    name_index[pos] = i;
+
+    files[parent].size++;
+    create_generation++;
+
+    return i;
+}
+
+/**
+ * fs_remove - Delete a directory entry
+ * @path: Path of the entry
+ * @type: Type the entry must have
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int fs_remove(const char *path, uint8_t type) {
+    char name[MAX_FILENAME];
+    int parent = fs_resolve_parent(path, name);
+    if (parent == -1) {
+        return -1; // Bad path or missing parent
+    }
+
+    int pos;
+    int idx = fs_lookup(parent, name, fs_hash(parent, name), &pos);
+    if (idx == -1 || files[idx].type != type) {
+        return -1; // Not found
+    }
+    if (type == FS_TYPE_DIR && (files[idx].size != 0 || idx == cwd)) {
+        return -1; // Not empty or in use
+    }
+
+    fs_index_remove(pos);
+    fs_release(&files[idx], 0);
+    fs_chunks_release(&files[idx], 0);
+    files[idx].mapped = NULL;
+
+    // Changing the generation invalidates cached lookups of this entry
+    files[idx].in_use = false;
+    files[idx].name[0] = '\0';
+    files[idx].size = 0;
+    files[idx].generation++;
+    free_slots[free_count++] = idx;
+
+    files[parent].size--;
+
+    return 0;
 }
 
 /**
  * fs_create - Create a new file
- * @filename: Name of the file to create
+ * @path: Path of the file to create
+ *
+ * Return: 0 on success, -1 on error
+ */
+int fs_create(const char *path) {
+    return fs_add(path, FS_TYPE_FILE) == -1 ? -1 : 0;
+}
+
+/**
+ * fs_create_mapped - Create a file whose data stays in read-only memory
+ * @path: Path of the file to create
+ * @data: File contents, must stay valid and unchanged
+ * @size: Number of bytes
  *
  * Return: 0 on success, -1 on error
  */
-int fs_create(const char *filename) {
-    // Check if file already exists
-    if (fs_find(filename) != -1) {
-        return -1; // File already exists
+int fs_create_mapped(const char *path, const void *data, uint32_t size) {
+    if (size > MAX_FILE_SIZE) {
+        return -1; // Could never be copied on write
     }
-    
-    // Check filename length
-    if (strlen(filename) >= MAX_FILENAME) {
-        return -1; // Filename too long
+
+    int idx = fs_add(path, FS_TYPE_FILE);
+    if (idx == -1) {
+        return -1;
     }
-    
-    // Find empty slot
-    for (int i = 0; i < MAX_FILES; i++) {
-        if (!files[i].in_use) {
-            files[i].in_use = true;
-            strcpy(files[i].name, filename);
-            files[i].size = 0;
-            files[i].content[0] = '\0';
-            return 0;
-        }
+
+    files[idx].mapped = data;
+    files[idx].size = size;
+    return 0;
+}
+
+/**
+ * fs_mkdir - Create a new directory
+ * @path: Path of the directory to create
+ *
+ * Return: 0 on success, -1 on error
+ */
+int fs_mkdir(const char *path) {
+    return fs_add(path, FS_TYPE_DIR) == -1 ? -1 : 0;
+}
+
+/**
+ * fs_rmdir - Delete an empty directory
+ * @path: Path of the directory
+ *
+ * Return: 0 on success, -1 if missing, not empty or the working directory
+ */
+int fs_rmdir(const char *path) {
+    return fs_remove(path, FS_TYPE_DIR);
+}
+
+/**
+ * fs_chdir - Change the working directory
+ * @path: Path of the new working directory
+ *
+ * Return: 0 on success, -1 if not a directory
+ */
+int fs_chdir(const char *path) {
+    int idx = fs_resolve(path);
+    if (idx == -1 || files[idx].type != FS_TYPE_DIR) {
+        return -1; // Not a directory
+    }
+
+    cwd = idx;
+    return 0;
+}
+
+/**
+ * fs_getcwd - Get the absolute path of the working directory
+ * @buffer: Buffer to store the path
+ * @size: Size of buffer
+ *
+ * Return: 0 on success, -1 if the path does not fit
+ */
+int fs_getcwd(char *buffer, uint32_t size) {
+    if (size < 2) return -1;
+
+    // Build the path backwards from the working directory to the root
+    uint32_t pos = size - 1;
+    buffer[pos] = '\0';
+    for (int dir = cwd; dir != FS_ROOT; dir = files[dir].parent) {
+        uint32_t len = strlen(files[dir].name);
+        if (pos < len + 1) return -1;
+        pos -= len;
+        memcpy(buffer + pos, files[dir].name, len);
+        buffer[--pos] = '/';
     }
-    
-    return -1; // No space available
+    if (cwd == FS_ROOT) {
+        buffer[--pos] = '/';
+    }
+
+    // Move the path to the start of the buffer
+    uint32_t i = 0;
+    while (buffer[pos]) {
+        buffer[i++] = buffer[pos++];
+    }
+    buffer[i] = '\0';
+
+    return 0;
 }
 
 /**
  * fs_write - Write content to a file
- * @filename: Name of the file
+ * @path: Path of the file
  * @content: Content to write
  *
  * Return: 0 on success, -1 on error
  */
-int fs_write(const char *filename, const char *content) {
-    int idx = fs_find(filename);
+int fs_write(const char *path, const char *content) {
+    int idx = fs_find(path);
     if (idx == -1) {
         return -1; // File not found
     }
-    
+
+    file_t *file = &files[idx];
     uint32_t len = strlen(content);
-    if (len >= MAX_FILE_SIZE) {
-        len = MAX_FILE_SIZE - 1;
+
+    // The old content is replaced, so archive data need not be copied
+    if (file->mapped) {
+        file->mapped = NULL;
+        file->size = 0;
+    }
+
+    if (file->flags & FS_FLAG_COMPRESS) {
+        fs_chunks_release(file, 0);
+        file->size = 0;
+        return fs_chunked_pwrite(file, (const uint8_t *)content, 0, len) == -1 ? -1 : 0;
     }
-    
-    // Copy content
-    for (uint32_t i = 0; i < len; i++) {
-        files[idx].content[i] = content[i];
+
+    // Keep only the extents the new content needs
+    fs_release(file, len);
+    if (fs_reserve(file, len) != 0 || fs_csum_table(file, len) != 0) {
+        fs_release(file, file->size);
+        return -1; // Too large or out of memory
     }
-    files[idx].content[len] = '\0';
-    files[idx].size = len;
-    
+
+    fs_copy_in(file, 0, content, len);
+    file->size = len;
+    fs_csum_update(file, 0, len);
+
     return 0;
 }
 
 /**
  * fs_read - Read content from a file
- * @filename: Name of the file
+ * @path: Path of the file
  * @buffer: Buffer to store content
  * @size: Size of buffer
  *
  * Return: Number of bytes read, -1 on error
  */
-int fs_read(const char *filename, char *buffer, uint32_t size) {
-    int idx = fs_find(filename);
-    if (idx == -1) {
+int fs_read(const char *path, char *buffer, uint32_t size) {
+    int idx = fs_find(path);
+    if (idx == -1 || size == 0) {
         return -1; // File not found
     }
-    
-    uint32_t len = files[idx].size;
-    if (len >= size) {
-        len = size - 1;
-    }
-    
-    // Copy content
-    for (uint32_t i = 0; i < len; i++) {
-        buffer[i] = files[idx].content[i];
+
+    int len = fs_file_pread(&files[idx], buffer, 0, size - 1);
+    if (len == -1) {
+        return -1; // Corrupt data
     }
     buffer[len] = '\0';
-    
+
     return len;
 }
 
 /**
- * fs_delete - Delete a file
- * @filename: Name of the file to delete
+ * fs_pread - Read part of a file
+ * @path: Path of the file
+ * @buffer: Buffer to store data, not NUL-terminated
+ * @offset: Byte offset to start reading at
+ * @len: Maximum number of bytes to read
  *
- * Return: 0 on success, -1 on error
+ * Return: Number of bytes read (0 at end of file), -1 on error
  */
-int fs_delete(const char *filename) {
-    int idx = fs_find(filename);
+int fs_pread(const char *path, void *buffer, uint32_t offset, uint32_t len) {
+    int idx = fs_find(path);
     if (idx == -1) {
         return -1; // File not found
     }
-    
-    files[idx].in_use = false;
-    files[idx].name[0] = '\0';
-    files[idx].size = 0;
-    
-    return 0;
+
+    return fs_file_pread(&files[idx], buffer, offset, len);
 }
 
 /**
- * fs_list - List all files
+ * fs_pwrite - Write part of a file
+ * @path: Path of the file
+ * @data: Data to write
+ * @offset: Byte offset to start writing at
+ * @len: Number of bytes to write
+ *
+ * Writing past the end grows the file, any gap reads back as zeros.
+ *
+ * Return: Number of bytes written, -1 on error
  */
-void fs_list(void) {
-    int count = 0;
-    for (int i = 0; i < MAX_FILES; i++) {
-        if (files[i].in_use) {
-            count++;
-        }
+int fs_pwrite(const char *path, const void *data, uint32_t offset, uint32_t len) {
+    int idx = fs_find(path);
+    if (idx == -1) {
+        return -1; // File not found
+    }
+
+    return fs_file_pwrite(&files[idx], data, offset, len);
+}
+
+/**
+ * fs_append - Append data to the end of a file
+ * @path: Path of the file
+ * @data: Data to append
+ * @len: Number of bytes to append
+ *
+ * Return: Number of bytes written, -1 on error
+ */
+int fs_append(const char *path, const void *data, uint32_t len) {
+    int size = fs_size(path);
+    if (size == -1) {
+        return -1; // File not found
+    }
+
+    return fs_pwrite(path, data, size, len);
+}
+
+/**
+ * fs_size - Get the size of a file
+ * @path: Path of the file
+ *
+ * Return: Size in bytes, -1 if not found
+ */
+int fs_size(const char *path) {
+    int idx = fs_find(path);
+    if (idx == -1) {
+        return -1; // File not found
+    }
+
+    return files[idx].size;
+}
+
+/**
+ * fs_delete - Delete a file
+ * @path: Path of the file to delete
+ *
+ * Return: 0 on success, -1 on error
+ */
+int fs_delete(const char *path) {
+    return fs_remove(path, FS_TYPE_FILE);
+}
+
+/**
+ * fs_list - List the entries of a directory
+ * @path: Path of the directory, NULL or empty for the working directory
+ *
+ * Return: 0 on success, -1 if not a directory
+ */
+int fs_list(const char *path) {
+    int dir = (path && *path) ? fs_resolve(path) : cwd;
+    if (dir == -1 || files[dir].type != FS_TYPE_DIR) {
+        return -1; // Not a directory
     }
-    
-    if (count == 0) {
+
+    // A directory's size is its number of entries
+    if (files[dir].size == 0) {
         print("No files found.\n");
-        return;
+        return 0;
     }
-    
+
     print("Files:\n");
     for (int i = 0; i < MAX_FILES; i++) {
-        if (files[i].in_use) {
+        if (files[i].in_use && i != FS_ROOT && files[i].parent == dir) {
             print("  ");
             print(files[i].name);
-            print(" (");
-            print_int(files[i].size);
-            print(" bytes)\n");
+            if (files[i].type == FS_TYPE_DIR) {
+                print("/\n");
+            } else {
+                print(" (");
+                print_int(files[i].size);
+                print(" bytes)\n");
+            }
         }
     }
+    return 0;
+}
+
+/**
+ * fs_exists - Check if a file or directory exists
+ * @path: Path to check
+ *
+ * Return: true if it exists, false otherwise
+ */
+bool fs_exists(const char *path) {
+    return fs_resolve(path) != -1;
 }
 
 /**
- * fs_exists - Check if a file exists
- * @filename: Name of the file
+ * fs_is_dir - Check if a path is a directory
+ * @path: Path to check
  *
- * Return: true if file exists, false otherwise
+ * Return: true if it is a directory, false otherwise
+ */
+bool fs_is_dir(const char *path) {
+    int idx = fs_resolve(path);
+    return idx != -1 && files[idx].type == FS_TYPE_DIR;
+}
+
+/*
+ * RAM filesystem backend for the VFS. Inode numbers carry the slot in
+ * the low 8 bits and the slot generation above it, so a descriptor
+ * left open on a deleted file fails instead of reaching its successor.
+ */
+
+/**
+ * ramfs_ino - Build the inode number of a slot
+ * @idx: Slot
+ *
+ * Return: Inode number
+ */
+static uint32_t ramfs_ino(int idx) {
+    return (files[idx].generation << 8) | idx;
+}
+
+/**
+ * ramfs_slot - Get the slot an inode number refers to
+ * @ino: Inode number
+ *
+ * Return: Slot, -1 if the entry no longer exists
+ */
+static int ramfs_slot(uint32_t ino) {
+    int idx = ino & 0xFF;
+    if (idx >= MAX_FILES || !files[idx].in_use ||
+        ramfs_ino(idx) != ino) {
+        return -1;
+    }
+    return idx;
+}
+
+/**
+ * ramfs_lookup - Find the inode of a path
+ */
+static int ramfs_lookup(void *fs, const char *path, uint32_t *ino) {
+    (void)fs;
+    int idx = fs_resolve(path);
+    if (idx == -1) return -1;
+
+    *ino = ramfs_ino(idx);
+    return 0;
+}
+
+/**
+ * ramfs_create - Create a file and return its inode
+ */
+static int ramfs_create(void *fs, const char *path, uint32_t *ino) {
+    (void)fs;
+    int idx = fs_add(path, FS_TYPE_FILE);
+    if (idx == -1) return -1;
+
+    *ino = ramfs_ino(idx);
+    return 0;
+}
+
+/**
+ * ramfs_mkdir - Create a directory
+ */
+static int ramfs_mkdir(void *fs, const char *path) {
+    (void)fs;
+    return fs_mkdir(path);
+}
+
+/**
+ * ramfs_unlink - Delete a file
+ */
+static int ramfs_unlink(void *fs, const char *path) {
+    (void)fs;
+    return fs_delete(path);
+}
+
+/**
+ * ramfs_rmdir - Delete an empty directory
+ */
+static int ramfs_rmdir(void *fs, const char *path) {
+    (void)fs;
+    return fs_rmdir(path);
+}
+
+/**
+ * ramfs_read - Read part of a file by inode
+ */
+static int ramfs_read(void *fs, uint32_t ino, void *buffer, uint32_t offset, uint32_t len) {
+    (void)fs;
+    int idx = ramfs_slot(ino);
+    if (idx == -1 || files[idx].type != FS_TYPE_FILE) return -1;
+
+    return fs_file_pread(&files[idx], buffer, offset, len);
+}
+
+/**
+ * ramfs_write - Write part of a file by inode
+ */
+static int ramfs_write(void *fs, uint32_t ino, const void *data, uint32_t offset, uint32_t len) {
+    (void)fs;
+    int idx = ramfs_slot(ino);
+    if (idx == -1 || files[idx].type != FS_TYPE_FILE) return -1;
+
+    return fs_file_pwrite(&files[idx], data, offset, len);
+}
+
+/**
+ * ramfs_truncate - Set the size of a file by inode
+ */
+static int ramfs_truncate(void *fs, uint32_t ino, uint32_t size) {
+    (void)fs;
+    int idx = ramfs_slot(ino);
+    if (idx == -1 || files[idx].type != FS_TYPE_FILE) return -1;
+
+    file_t *file = &files[idx];
+    if (size > file->size) {
+        // Growing zero-fills up to the new size
+        return fs_file_pwrite(file, NULL, size, 0) == -1 ? -1 : 0;
+    }
+
+    if (file->mapped) {
+        file->size = size; // Still a prefix of the archive data
+        return 0;
+    }
+    if (file->flags & FS_FLAG_COMPRESS) {
+        return fs_chunked_truncate(file, size);
+    }
+
+    // The new last block keeps part of its old data
+    if (size > 0 && fs_csum_verify(file, size - 1, size) != 0) {
+        return -1; // Corrupt data
+    }
+    fs_release(file, size);
+    file->size = size;
+    if (size > 0) fs_csum_update(file, size - 1, size);
+    return 0;
+}
+
+/**
+ * ramfs_stat - Get the size and type of an inode
+ */
+static int ramfs_stat(void *fs, uint32_t ino, vfs_stat_t *st) {
+    (void)fs;
+    int idx = ramfs_slot(ino);
+    if (idx == -1) return -1;
+
+    st->size = files[idx].size;
+    st->type = files[idx].type == FS_TYPE_DIR ? VFS_TYPE_DIR : VFS_TYPE_FILE;
+    st->stored = fs_stored_size(&files[idx]);
+    st->flags = files[idx].flags & FS_FLAG_COMPRESS ? VFS_ATTR_COMPRESS : 0;
+    return 0;
+}
+
+/**
+ * ramfs_readdir - Get the next entry of a directory
+ */
+static int ramfs_readdir(void *fs, uint32_t ino, uint32_t *cookie, vfs_dirent_t *entry) {
+    (void)fs;
+    int dir = ramfs_slot(ino);
+    if (dir == -1 || files[dir].type != FS_TYPE_DIR) return -1;
+
+    // The cookie is the next slot to scan
+    for (uint32_t i = *cookie; i < MAX_FILES; i++) {
+        if (files[i].in_use && i != FS_ROOT && files[i].parent == dir) {
+            strcpy(entry->name, files[i].name);
+            entry->size = files[i].size;
+            entry->type = files[i].type == FS_TYPE_DIR ? VFS_TYPE_DIR : VFS_TYPE_FILE;
+            *cookie = i + 1;
+            return 0;
+        }
+    }
+
+    *cookie = MAX_FILES;
+    return -1;
+}
+
+/**
+ * ramfs_setattr - Change the storage attributes of a file by inode
  */
-bool fs_exists(const char *filename) {
-    return fs_find(filename) != -1;
+static int ramfs_setattr(void *fs, uint32_t ino, uint8_t flags) {
+    (void)fs;
+    int idx = ramfs_slot(ino);
+    if (idx == -1 || files[idx].type != FS_TYPE_FILE) return -1;
+
+    return fs_set_compressed(&files[idx], (flags & VFS_ATTR_COMPRESS) != 0);
 }
 
+const vfs_ops_t ramfs_ops = {
+    .name = "ramfs",
+    .lookup = ramfs_lookup,
+    .create = ramfs_create,
+    .mkdir = ramfs_mkdir,
+    .unlink = ramfs_unlink,
+    .rmdir = ramfs_rmdir,
+    .read = ramfs_read,
+    .write = ramfs_write,
+    .truncate = ramfs_truncate,
+    .stat = ramfs_stat,
+    .readdir = ramfs_readdir,
+    .setattr = ramfs_setattr,
+};
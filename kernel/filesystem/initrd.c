@@ -0,0 +1,53 @@
+/**
+ * initrd.c - Boot-time archive of files
+ * Adds the archive loaded by the bootloader to the RAM filesystem
+ */
+
+#include "../../include/initrd.h"
+#include "../../include/filesystem.h"
+#include "../../include/memory.h"
+#include "../../include/crc32c.h"
+
+/**
+ * initrd_load - Add the files of the boot archive to the RAM filesystem
+ *
+ * The whole archive is checked against its checksum once; file data is
+ * then referenced in place rather than copied.
+ *
+ * Return: Number of entries added, 0 if there is no archive, -1 if the
+ *         archive is corrupt
+ */
+__cold int initrd_load(void) {
+    const uint8_t *base = (const uint8_t *)INITRD_ADDR;
+    const initrd_header_t *header = (const initrd_header_t *)base;
+    const initrd_entry_t *entries = (const initrd_entry_t *)(header + 1);
+    char path[INITRD_PATH_MAX + 1];
+    int added = 0;
+
+    if (header->magic != INITRD_MAGIC) return 0;
+
+    if (header->size < sizeof(initrd_header_t) || header->size > INITRD_MAX_SIZE ||
+        header->count > (header->size - sizeof(initrd_header_t)) / sizeof(initrd_entry_t) ||
+        crc32c(0, header + 1, header->size - sizeof(initrd_header_t)) != header->checksum) {
+        return -1;
+    }
+
+    path[0] = '/';
+    for (uint32_t i = 0; i < header->count; i++) {
+        const initrd_entry_t *entry = &entries[i];
+
+        // Skip entries whose name or data lies outside the archive
+        uint32_t len = 0;
+        while (len < INITRD_PATH_MAX && entry->path[len]) len++;
+        if (len == 0 || len == INITRD_PATH_MAX) continue;
+        if (entry->offset > header->size || entry->size > header->size - entry->offset) continue;
+
+        memcpy(path + 1, entry->path, len + 1);
+        if (entry->type == INITRD_TYPE_DIR) {
+            if (fs_mkdir(path) == 0) added++;
+        } else if (entry->type == INITRD_TYPE_FILE) {
+            if (fs_create_mapped(path, base + entry->offset, entry->size) == 0) added++;
+        }
+    }
+    return added;
+}
@@ -0,0 +1,1183 @@
+/**
+ * sfs.c - Simple on-disk filesystem
+ * Extent-mapped files in block groups, accessed through the block cache
+ */
+
+#include "../../include/sfs.h"
+#include "../../include/bcache.h"
+#include "../../include/memory.h"
+#include "../../include/crc32c.h"
+
+// Most blocks pinned by one transaction, so the rest of the cache stays usable
+#define SFS_TXN_MAX (BCACHE_BUFFERS / 4)
+
+/**
+ * Mounted volume
+ */
+typedef struct {
+    blockdev_t *dev;
+    sfs_super_t super;
+    uint16_t free_blocks[SFS_MAX_GROUPS];   // Counted from the bitmaps at mount
+    uint16_t free_inodes[SFS_MAX_GROUPS];
+    uint32_t sequence;                      // Number of the last committed transaction
+    uint32_t txn_count;                     // Blocks in the open transaction
+    uint32_t txn_capacity;                  // 0 if the volume has no journal
+    bcache_buf_t *txn[SFS_TXN_MAX];         // Pinned until the transaction commits
+    uint8_t *journal;                       // Staging buffer for a whole transaction
+} sfs_t;
+
+/**
+ * sfs_group_start - Get the first block of a group
+ * @group: Group number
+ *
+ * Return: Block number
+ */
+static uint32_t sfs_group_start(uint32_t group) {
+    return SFS_FIRST_GROUP + group * SFS_BLOCKS_PER_GROUP;
+}
+
+/**
+ * sfs_group_size - Get the number of blocks in a group
+ * @fs: Volume
+ * @group: Group number
+ *
+ * Return: Block count, smaller than SFS_BLOCKS_PER_GROUP for the last group
+ */
+static uint32_t sfs_group_size(sfs_t *fs, uint32_t group) {
+    uint32_t left = fs->super.block_count - sfs_group_start(group);
+    return left < SFS_BLOCKS_PER_GROUP ? left : SFS_BLOCKS_PER_GROUP;
+}
+
+/**
+ * sfs_inode_group - Get the group holding an inode
+ * @ino: Inode number
+ *
+ * Return: Group number
+ */
+static uint32_t sfs_inode_group(uint32_t ino) {
+    return (ino - 1) / SFS_INODES_PER_GROUP;
+}
+
+/**
+ * sfs_inode_block - Locate an inode in its group's inode table
+ * @ino: Inode number
+ * @offset: Receives the byte offset within the block
+ *
+ * Return: Block number
+ */
+static uint32_t sfs_inode_block(uint32_t ino, uint32_t *offset) {
+    uint32_t index = (ino - 1) % SFS_INODES_PER_GROUP;
+
+    *offset = (index % SFS_INODES_PER_BLOCK) * SFS_INODE_SIZE;
+    return sfs_group_start(sfs_inode_group(ino)) + SFS_GROUP_INODE_TABLE +
+           index / SFS_INODES_PER_BLOCK;
+}
+
+/**
+ * sfs_dirty - Record a modified metadata block
+ * @fs: Volume
+ * @buf: Bitmap, inode table or directory block
+ *
+ * With a journal the block joins the open transaction: it stays pinned
+ * in the cache and is not written home before the transaction commits.
+ */
+static void sfs_dirty(sfs_t *fs, bcache_buf_t *buf) {
+    if (buf->pinned) return;
+
+    // sfs_begin() makes room or fails the operation, so a full transaction
+    // only means an operation dirtied more than its credits
+    if (fs->txn_count == fs->txn_capacity) {
+        bcache_mark_dirty(buf);
+        return;
+    }
+
+    buf->pinned = true;
+    buf->refcount++;
+    fs->txn[fs->txn_count++] = buf;
+}
+
+/**
+ * sfs_commit - Commit the open transaction
+ * @fs: Volume
+ *
+ * The previous transaction and all file data are written home first,
+ * so the journal can be reused and no committed metadata points at
+ * unwritten data. The header, the logged blocks and the commit record
+ * then go to the journal in one sequential write, which the driver
+ * completes with a cache flush. Afterwards the blocks are unpinned and
+ * reach their home locations through normal write-back.
+ *
+ * Return: 0 on success, -1 on I/O error (the transaction stays open)
+ */
+static int sfs_commit(sfs_t *fs) {
+    uint32_t count = fs->txn_count;
+
+    if (count == 0) return 0;
+    if (bcache_sync(fs->dev) < 0) return -1;
+
+    sfs_journal_header_t *header = (sfs_journal_header_t *)fs->journal;
+    memset(fs->journal, 0, SFS_BLOCK_SIZE);
+    header->magic = SFS_JOURNAL_MAGIC;
+    header->sequence = fs->sequence + 1;
+    header->count = count;
+    for (uint32_t i = 0; i < count; i++) {
+        header->blocks[i] = fs->txn[i]->block;
+        memcpy(fs->journal + (i + 1) * SFS_BLOCK_SIZE, fs->txn[i]->data, SFS_BLOCK_SIZE);
+    }
+
+    uint32_t logged = (count + 1) * SFS_BLOCK_SIZE;
+    sfs_commit_t *commit = (sfs_commit_t *)(fs->journal + logged);
+    memset(commit, 0, SFS_BLOCK_SIZE);
+    commit->magic = SFS_COMMIT_MAGIC;
+    commit->sequence = header->sequence;
+    commit->checksum = crc32c(0, fs->journal, logged);
+
+    uint32_t sectors = SFS_BLOCK_SIZE / BLOCKDEV_SECTOR_SIZE;
+    if (blockdev_write(fs->dev, (uint64_t)fs->super.journal_start * sectors,
+                       (count + 2) * sectors, fs->journal) != 0) {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        bcache_buf_t *buf = fs->txn[i];
+        buf->pinned = false;
+        bcache_mark_dirty(buf);
+        bcache_release(buf);
+    }
+    fs->txn_count = 0;
+    fs->sequence++;
+    return 0;
+}
+
+/**
+ * sfs_begin - Start an operation that modifies metadata
+ * @fs: Volume
+ *
+ * Operations join the open transaction, which is committed between
+ * operations once it could not take another SFS_OP_CREDITS blocks. If
+ * that commit fails the transaction stays full, and the operation must
+ * not go ahead: its blocks could no longer be journaled.
+ *
+ * Return: 0 on success, -1 if the transaction has no room
+ */
+static int sfs_begin(sfs_t *fs) {
+    if (fs->txn_capacity && fs->txn_count + SFS_OP_CREDITS > fs->txn_capacity) {
+        return sfs_commit(fs);
+    }
+    return 0;
+}
+
+/**
+ * sfs_csum_block - Locate the checksum of a data block
+ * @block: Data block
+ * @index: Receives the entry within the checksum block
+ *
+ * Return: Checksum table block holding the entry
+ */
+static uint32_t sfs_csum_block(uint32_t block, uint32_t *index) {
+    uint32_t group = (block - SFS_FIRST_GROUP) / SFS_BLOCKS_PER_GROUP;
+    uint32_t bit = (block - SFS_FIRST_GROUP) % SFS_BLOCKS_PER_GROUP;
+
+    *index = bit % SFS_CSUMS_PER_BLOCK;
+    return sfs_group_start(group) + SFS_GROUP_CSUM + bit / SFS_CSUMS_PER_BLOCK;
+}
+
+/**
+ * sfs_csum_set - Record the checksum of a file data block
+ * @fs: Volume
+ * @buf: Data block, just modified
+ *
+ * Return: 0 on success, -1 on I/O error
+ */
+static int sfs_csum_set(sfs_t *fs, bcache_buf_t *buf) {
+    uint32_t index;
+    bcache_buf_t *table = bcache_read(fs->dev, sfs_csum_block(buf->block, &index));
+    if (!table) return -1;
+
+    ((uint32_t *)table->data)[index] = crc32c(0, buf->data, SFS_BLOCK_SIZE);
+    sfs_dirty(fs, table);
+    bcache_release(table);
+    buf->checked = true;
+    return 0;
+}
+
+/**
+ * sfs_csum_verify - Check a file data block against its checksum
+ * @fs: Volume
+ * @buf: Data block
+ *
+ * A block is checked once after it is loaded; the cached copy is
+ * trusted until it is evicted.
+ *
+ * Return: 0 if it matches, -1 if the block is corrupt or on I/O error
+ */
+static int sfs_csum_verify(sfs_t *fs, bcache_buf_t *buf) {
+    uint32_t index;
+
+    if (buf->checked) return 0;
+
+    bcache_buf_t *table = bcache_read(fs->dev, sfs_csum_block(buf->block, &index));
+    if (!table) return -1;
+    uint32_t expected = ((uint32_t *)table->data)[index];
+    bcache_release(table);
+
+    if (crc32c(0, buf->data, SFS_BLOCK_SIZE) != expected) return -1;
+    buf->checked = true;
+    return 0;
+}
+
+/**
+ * sfs_replay - Recover the transaction left in the journal
+ * @fs: Volume
+ *
+ * A transaction is replayed only if its commit record is present and
+ * the checksum matches; a torn write leaves the metadata as it was
+ * before the transaction. The journal is marked empty afterwards.
+ *
+ * Return: 0 on success, -1 on I/O error
+ */
+static int sfs_replay(sfs_t *fs) {
+    uint32_t sectors = SFS_BLOCK_SIZE / BLOCKDEV_SECTOR_SIZE;
+    uint64_t lba = (uint64_t)fs->super.journal_start * sectors;
+    sfs_journal_header_t *header = (sfs_journal_header_t *)fs->journal;
+
+    if (blockdev_read(fs->dev, lba, sectors, fs->journal) != 0) return -1;
+    if (header->magic != SFS_JOURNAL_MAGIC) return 0;
+
+    fs->sequence = header->sequence;
+    uint32_t count = header->count;
+    if (count == 0 || count > fs->txn_capacity) return 0;
+
+    // Logged blocks and commit record follow the header
+    if (blockdev_read(fs->dev, lba + sectors, (count + 1) * sectors,
+                      fs->journal + SFS_BLOCK_SIZE) != 0) {
+        return -1;
+    }
+
+    uint32_t logged = (count + 1) * SFS_BLOCK_SIZE;
+    sfs_commit_t *commit = (sfs_commit_t *)(fs->journal + logged);
+    if (commit->magic != SFS_COMMIT_MAGIC || commit->sequence != header->sequence ||
+        commit->checksum != crc32c(0, fs->journal, logged)) {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t block = header->blocks[i];
+        if (block <= SFS_SUPER_BLOCK || block >= fs->super.block_count) continue;
+
+        bcache_buf_t *buf = bcache_get(fs->dev, block);
+        if (!buf) return -1;
+        memcpy(buf->data, fs->journal + (i + 1) * SFS_BLOCK_SIZE, SFS_BLOCK_SIZE);
+        bcache_mark_dirty(buf);
+        bcache_release(buf);
+    }
+    if (bcache_sync(fs->dev) < 0) return -1;
+
+    // Replayed blocks are home, an empty journal keeps the sequence
+    header->count = 0;
+    return blockdev_write(fs->dev, lba, sectors, fs->journal);
+}
+
+/**
+ * sfs_read_inode - Copy an inode out of the inode table
+ * @fs: Volume
+ * @ino: Inode number
+ * @inode: Receives the inode
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int sfs_read_inode(sfs_t *fs, uint32_t ino, sfs_inode_t *inode) {
+    uint32_t offset;
+
+    if (ino == 0 || ino > fs->super.inode_count) return -1;
+
+    bcache_buf_t *buf = bcache_read(fs->dev, sfs_inode_block(ino, &offset));
+    if (!buf) return -1;
+
+    memcpy(inode, buf->data + offset, sizeof(sfs_inode_t));
+    bcache_release(buf);
+    return 0;
+}
+
+/**
+ * sfs_write_inode - Store an inode in the inode table
+ * @fs: Volume
+ * @ino: Inode number
+ * @inode: Inode contents
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int sfs_write_inode(sfs_t *fs, uint32_t ino, const sfs_inode_t *inode) {
+    uint32_t offset;
+
+    bcache_buf_t *buf = bcache_read(fs->dev, sfs_inode_block(ino, &offset));
+    if (!buf) return -1;
+
+    memcpy(buf->data + offset, inode, sizeof(sfs_inode_t));
+    sfs_dirty(fs, buf);
+    bcache_release(buf);
+    return 0;
+}
+
+/**
+ * sfs_bitmap_alloc - Find and set a clear bit in a bitmap block
+ * @fs: Volume
+ * @block: Bitmap block
+ * @start: Bit to start searching from
+ * @limit: Number of valid bits
+ *
+ * Return: Bit number, -1 if every bit is set
+ */
+static int sfs_bitmap_alloc(sfs_t *fs, uint32_t block, uint32_t start, uint32_t limit) {
+    bcache_buf_t *buf = bcache_read(fs->dev, block);
+    if (!buf) return -1;
+
+    // Search from the goal to the end, then wrap around
+    for (uint32_t i = 0; i < limit; i++) {
+        uint32_t bit = start + i < limit ? start + i : start + i - limit;
+        uint8_t *byte = &buf->data[bit / 8];
+
+        if (*byte == 0xFF) {
+            // Skip the rest of a full byte
+            i += 7 - bit % 8;
+            continue;
+        }
+        if (!(*byte & (1 << (bit % 8)))) {
+            *byte |= 1 << (bit % 8);
+            sfs_dirty(fs, buf);
+            bcache_release(buf);
+            return bit;
+        }
+    }
+
+    bcache_release(buf);
+    return -1;
+}
+
+/**
+ * sfs_bitmap_clear - Clear a bit in a bitmap block
+ * @fs: Volume
+ * @block: Bitmap block
+ * @bit: Bit number
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int sfs_bitmap_clear(sfs_t *fs, uint32_t block, uint32_t bit) {
+    bcache_buf_t *buf = bcache_read(fs->dev, block);
+    if (!buf) return -1;
+
+    buf->data[bit / 8] &= ~(1 << (bit % 8));
+    sfs_dirty(fs, buf);
+    bcache_release(buf);
+    return 0;
+}
+
+/**
+ * sfs_bitmap_count - Count the clear bits in a bitmap block
+ * @fs: Volume
+ * @block: Bitmap block
+ * @limit: Number of valid bits
+ *
+ * Return: Number of clear bits, 0 on error
+ */
+static uint32_t sfs_bitmap_count(sfs_t *fs, uint32_t block, uint32_t limit) {
+    bcache_buf_t *buf = bcache_read(fs->dev, block);
+    uint32_t count = 0;
+    if (!buf) return 0;
+
+    for (uint32_t bit = 0; bit < limit; bit++) {
+        if (!(buf->data[bit / 8] & (1 << (bit % 8)))) count++;
+    }
+    bcache_release(buf);
+    return count;
+}
+
+/**
+ * sfs_alloc_block - Allocate a data block near a goal
+ * @fs: Volume
+ * @goal: Preferred block; the search continues forward from it and
+ *        then through the other groups
+ *
+ * Return: Block number, 0 if the volume is full
+ */
+static uint32_t sfs_alloc_block(sfs_t *fs, uint32_t goal) {
+    uint32_t first = 0;
+
+    if (goal >= SFS_FIRST_GROUP && goal < fs->super.block_count) {
+        first = (goal - SFS_FIRST_GROUP) / SFS_BLOCKS_PER_GROUP;
+    }
+
+    for (uint32_t i = 0; i < fs->super.group_count; i++) {
+        uint32_t group = (first + i) % fs->super.group_count;
+        if (fs->free_blocks[group] == 0) continue;
+
+        uint32_t start = sfs_group_start(group);
+        uint32_t size = sfs_group_size(fs, group);
+        uint32_t bit = goal >= start && goal - start < size ? goal - start : SFS_GROUP_DATA;
+        int found = sfs_bitmap_alloc(fs, start + SFS_GROUP_BLOCK_BITMAP, bit, size);
+        if (found >= 0) {
+            fs->free_blocks[group]--;
+            return start + found;
+        }
+    }
+    return 0;
+}
+
+/**
+ * sfs_free_block - Return a data block to its group
+ * @fs: Volume
+ * @block: Block number
+ */
+static void sfs_free_block(sfs_t *fs, uint32_t block) {
+    uint32_t group = (block - SFS_FIRST_GROUP) / SFS_BLOCKS_PER_GROUP;
+    uint32_t start = sfs_group_start(group);
+
+    if (sfs_bitmap_clear(fs, start + SFS_GROUP_BLOCK_BITMAP, block - start) == 0) {
+        fs->free_blocks[group]++;
+    }
+}
+
+/**
+ * sfs_alloc_inode - Allocate an inode, preferably in a given group
+ * @fs: Volume
+ * @group: Preferred group
+ *
+ * Return: Inode number, 0 if no inode is free
+ */
+static uint32_t sfs_alloc_inode(sfs_t *fs, uint32_t group) {
+    for (uint32_t i = 0; i < fs->super.group_count; i++) {
+        uint32_t g = (group + i) % fs->super.group_count;
+        if (fs->free_inodes[g] == 0) continue;
+
+        int bit = sfs_bitmap_alloc(fs, sfs_group_start(g) + SFS_GROUP_INODE_BITMAP,
+                                   0, SFS_INODES_PER_GROUP);
+        if (bit >= 0) {
+            fs->free_inodes[g]--;
+            return g * SFS_INODES_PER_GROUP + bit + 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * sfs_free_inode - Clear an inode and return it to its group
+ * @fs: Volume
+ * @ino: Inode number
+ */
+static void sfs_free_inode(sfs_t *fs, uint32_t ino) {
+    sfs_inode_t inode;
+    uint32_t group = sfs_inode_group(ino);
+
+    memset(&inode, 0, sizeof(inode));
+    sfs_write_inode(fs, ino, &inode);
+
+    if (sfs_bitmap_clear(fs, sfs_group_start(group) + SFS_GROUP_INODE_BITMAP,
+                         (ino - 1) % SFS_INODES_PER_GROUP) == 0) {
+        fs->free_inodes[group]++;
+    }
+}
+
+/**
+ * sfs_dir_group - Choose the group for a new directory
+ * @fs: Volume
+ *
+ * Directories are spread out to the group with the most free blocks,
+ * leaving room for the files that will be created next to them.
+ *
+ * Return: Group number
+ */
+static uint32_t sfs_dir_group(sfs_t *fs) {
+    uint32_t best = 0;
+
+    for (uint32_t g = 1; g < fs->super.group_count; g++) {
+        if (fs->free_inodes[g] && fs->free_blocks[g] > fs->free_blocks[best]) best = g;
+    }
+    return best;
+}
+
+/**
+ * sfs_bmap - Map a file block to a disk block
+ * @inode: Inode
+ * @index: Block index within the file
+ *
+ * Return: Disk block, 0 if not allocated
+ */
+static uint32_t sfs_bmap(const sfs_inode_t *inode, uint32_t index) {
+    for (uint32_t i = 0; i < inode->extent_count; i++) {
+        if (index < inode->extents[i].count) return inode->extents[i].start + index;
+        index -= inode->extents[i].count;
+    }
+    return 0;
+}
+
+/**
+ * sfs_block_count - Count the blocks allocated to an inode
+ * @inode: Inode
+ *
+ * Return: Number of blocks
+ */
+static uint32_t sfs_block_count(const sfs_inode_t *inode) {
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i < inode->extent_count; i++) {
+        count += inode->extents[i].count;
+    }
+    return count;
+}
+
+/**
+ * sfs_extend - Add one zeroed block to the end of an inode
+ * @fs: Volume
+ * @ino: Inode number
+ * @inode: Inode to grow, written back by the caller
+ *
+ * The block right after the last extent is tried first so the extent
+ * simply grows; a new file starts at the data area of its inode's group.
+ *
+ * Return: Disk block, 0 if out of space or extents
+ */
+static uint32_t sfs_extend(sfs_t *fs, uint32_t ino, sfs_inode_t *inode) {
+    sfs_extent_t *last = inode->extent_count ? &inode->extents[inode->extent_count - 1] : NULL;
+    uint32_t goal = last ? last->start + last->count
+                         : sfs_group_start(sfs_inode_group(ino)) + SFS_GROUP_DATA;
+
+    uint32_t block = sfs_alloc_block(fs, goal);
+    if (!block) return 0;
+
+    if (last && block == last->start + last->count) {
+        last->count++;
+    } else if (inode->extent_count < SFS_EXTENTS) {
+        inode->extents[inode->extent_count].start = block;
+        inode->extents[inode->extent_count].count = 1;
+        inode->extent_count++;
+    } else {
+        sfs_free_block(fs, block);
+        return 0;
+    }
+
+    // The cache may still hold the block's contents from a deleted file
+    bcache_buf_t *buf = bcache_get(fs->dev, block);
+    if (buf) {
+        memset(buf->data, 0, SFS_BLOCK_SIZE);
+        if (inode->type == SFS_TYPE_DIR) {
+            sfs_dirty(fs, buf);
+        } else {
+            bcache_mark_dirty(buf);
+            sfs_csum_set(fs, buf);
+        }
+        bcache_release(buf);
+    }
+    return block;
+}
+
+/**
+ * sfs_shrink - Free the blocks of an inode beyond a size
+ * @fs: Volume
+ * @inode: Inode to shrink, written back by the caller
+ * @size: New size in bytes
+ */
+static void sfs_shrink(sfs_t *fs, sfs_inode_t *inode, uint32_t size) {
+    uint32_t keep = (size + SFS_BLOCK_SIZE - 1) / SFS_BLOCK_SIZE;
+    uint32_t total = sfs_block_count(inode);
+
+    while (total > keep) {
+        sfs_extent_t *last = &inode->extents[inode->extent_count - 1];
+        sfs_free_block(fs, last->start + last->count - 1);
+        total--;
+        if (--last->count == 0) inode->extent_count--;
+    }
+
+    // Clear the tail of the last block so growing again reads zeros; a
+    // corrupt block is left alone rather than given a fresh checksum
+    uint32_t block = size % SFS_BLOCK_SIZE ? sfs_bmap(inode, size / SFS_BLOCK_SIZE) : 0;
+    if (block) {
+        bcache_buf_t *buf = bcache_read(fs->dev, block);
+        if (buf && (inode->type != SFS_TYPE_FILE || sfs_csum_verify(fs, buf) == 0)) {
+            memset(buf->data + size % SFS_BLOCK_SIZE, 0, SFS_BLOCK_SIZE - size % SFS_BLOCK_SIZE);
+            bcache_mark_dirty(buf);
+            if (inode->type == SFS_TYPE_FILE) sfs_csum_set(fs, buf);
+        }
+        if (buf) bcache_release(buf);
+    }
+    inode->size = size;
+}
+
+/**
+ * sfs_pread - Read part of an inode's data
+ * @fs: Volume
+ * @inode: Inode
+ * @buffer: Buffer to store data
+ * @offset: Byte offset to start at
+ * @len: Maximum number of bytes to read
+ *
+ * File data blocks are verified against their checksums.
+ *
+ * Return: Number of bytes read (0 at or past the end), -1 on I/O error
+ *         or corrupt data
+ */
+static int sfs_pread(sfs_t *fs, const sfs_inode_t *inode, void *buffer,
+                     uint32_t offset, uint32_t len) {
+    uint8_t *out = buffer;
+    uint32_t done = 0;
+
+    if (offset >= inode->size) return 0;
+    if (len > inode->size - offset) len = inode->size - offset;
+
+    while (done < len) {
+        uint32_t pos = offset + done;
+        uint32_t in_block = pos % SFS_BLOCK_SIZE;
+        uint32_t n = SFS_BLOCK_SIZE - in_block;
+        if (n > len - done) n = len - done;
+
+        uint32_t block = sfs_bmap(inode, pos / SFS_BLOCK_SIZE);
+        if (block) {
+            bcache_buf_t *buf = bcache_read(fs->dev, block);
+            if (!buf) return -1;
+            if (inode->type == SFS_TYPE_FILE && sfs_csum_verify(fs, buf) != 0) {
+                bcache_release(buf);
+                return -1;
+            }
+            memcpy(out + done, buf->data + in_block, n);
+            bcache_release(buf);
+        } else {
+            // Unallocated space past a truncate reads as zeros
+            memset(out + done, 0, n);
+        }
+        done += n;
+    }
+    return done;
+}
+
+/**
+ * sfs_pwrite - Write part of an inode's data and store the inode
+ * @fs: Volume
+ * @ino: Inode number
+ * @inode: Inode, updated with new extents and size
+ * @data: Data to write
+ * @offset: Byte offset to start at
+ * @len: Number of bytes to write
+ *
+ * Return: Number of bytes written, -1 if nothing could be written
+ */
+static int sfs_pwrite(sfs_t *fs, uint32_t ino, sfs_inode_t *inode, const void *data,
+                      uint32_t offset, uint32_t len) {
+    const uint8_t *in = data;
+    uint32_t done = 0;
+
+    if (offset + len < offset) return -1;
+
+    while (done < len) {
+        uint32_t pos = offset + done;
+        uint32_t index = pos / SFS_BLOCK_SIZE;
+        uint32_t in_block = pos % SFS_BLOCK_SIZE;
+        uint32_t n = SFS_BLOCK_SIZE - in_block;
+        if (n > len - done) n = len - done;
+
+        // Allocate every block up to this one
+        uint32_t block = sfs_bmap(inode, index);
+        while (!block && sfs_block_count(inode) <= index) {
+            if (!sfs_extend(fs, ino, inode)) break;
+            block = sfs_bmap(inode, index);
+        }
+        if (!block) break;
+
+        // Whole blocks are overwritten without reading them first
+        bcache_buf_t *buf = n == SFS_BLOCK_SIZE ? bcache_get(fs->dev, block)
+                                                : bcache_read(fs->dev, block);
+        if (!buf) break;
+
+        // The bytes a partial write keeps must not be corrupt already
+        bool file = inode->type == SFS_TYPE_FILE;
+        if (file && n != SFS_BLOCK_SIZE && sfs_csum_verify(fs, buf) != 0) {
+            bcache_release(buf);
+            break;
+        }
+        memcpy(buf->data + in_block, in + done, n);
+
+        // Directory blocks are metadata and go through the journal
+        if (file) {
+            bcache_mark_dirty(buf);
+            sfs_csum_set(fs, buf);
+        } else {
+            sfs_dirty(fs, buf);
+        }
+        bcache_release(buf);
+        done += n;
+    }
+
+    if (offset + done > inode->size) inode->size = offset + done;
+    if (sfs_write_inode(fs, ino, inode) != 0) return -1;
+    return done == 0 && len > 0 ? -1 : (int)done;
+}
+
+/**
+ * sfs_dir_find - Find a name in a directory
+ * @fs: Volume
+ * @dir: Directory inode
+ * @name: Entry name
+ * @slot: Receives the entry index
+ *
+ * Return: Inode number, 0 if not found
+ */
+static uint32_t sfs_dir_find(sfs_t *fs, const sfs_inode_t *dir, const char *name, uint32_t *slot) {
+    uint32_t count = dir->size / SFS_DIRENT_SIZE;
+
+    for (uint32_t i = 0; i < count; i += SFS_DIRENTS_PER_BLOCK) {
+        uint32_t block = sfs_bmap(dir, i / SFS_DIRENTS_PER_BLOCK);
+        if (!block) return 0;
+
+        bcache_buf_t *buf = bcache_read(fs->dev, block);
+        if (!buf) return 0;
+
+        sfs_dirent_t *entries = (sfs_dirent_t *)buf->data;
+        for (uint32_t j = 0; j < SFS_DIRENTS_PER_BLOCK && i + j < count; j++) {
+            if (entries[j].ino && strcmp(entries[j].name, name) == 0) {
+                uint32_t ino = entries[j].ino;
+                *slot = i + j;
+                bcache_release(buf);
+                return ino;
+            }
+        }
+        bcache_release(buf);
+    }
+    return 0;
+}
+
+/**
+ * sfs_dir_add - Add an entry to a directory
+ * @fs: Volume
+ * @dir_ino: Directory inode number
+ * @name: Entry name
+ * @ino: Inode the entry refers to
+ *
+ * Free slots left by deleted entries are reused before the directory grows.
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int sfs_dir_add(sfs_t *fs, uint32_t dir_ino, const char *name, uint32_t ino) {
+    sfs_inode_t dir;
+    sfs_dirent_t entry;
+    uint32_t slot;
+
+    if (sfs_read_inode(fs, dir_ino, &dir) != 0) return -1;
+
+    uint32_t count = dir.size / SFS_DIRENT_SIZE;
+    for (slot = 0; slot < count; slot++) {
+        if (sfs_pread(fs, &dir, &entry, slot * SFS_DIRENT_SIZE, SFS_DIRENT_SIZE) != SFS_DIRENT_SIZE) {
+            return -1;
+        }
+        if (entry.ino == 0) break;
+    }
+
+    memset(&entry, 0, sizeof(entry));
+    entry.ino = ino;
+    strcpy(entry.name, name);
+    if (sfs_pwrite(fs, dir_ino, &dir, &entry, slot * SFS_DIRENT_SIZE, SFS_DIRENT_SIZE) != SFS_DIRENT_SIZE) {
+        return -1;
+    }
+
+    dir.entries++;
+    return sfs_write_inode(fs, dir_ino, &dir);
+}
+
+/**
+ * sfs_dir_remove - Clear a directory entry
+ * @fs: Volume
+ * @dir_ino: Directory inode number
+ * @dir: Directory inode
+ * @slot: Entry index
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int sfs_dir_remove(sfs_t *fs, uint32_t dir_ino, sfs_inode_t *dir, uint32_t slot) {
+    sfs_dirent_t entry;
+
+    memset(&entry, 0, sizeof(entry));
+    if (sfs_pwrite(fs, dir_ino, dir, &entry, slot * SFS_DIRENT_SIZE, SFS_DIRENT_SIZE) != SFS_DIRENT_SIZE) {
+        return -1;
+    }
+
+    dir->entries--;
+    return sfs_write_inode(fs, dir_ino, dir);
+}
+
+/**
+ * sfs_walk - Resolve a path to an inode
+ * @fs: Volume
+ * @path: Absolute path within the volume
+ * @ino: Receives the inode number
+ *
+ * Return: 0 on success, -1 if not found
+ */
+static int sfs_walk(sfs_t *fs, const char *path, uint32_t *ino) {
+    uint32_t current = SFS_ROOT_INO;
+    char name[SFS_NAME_MAX + 1];
+
+    while (*path) {
+        while (*path == '/') path++;
+        if (!*path) break;
+
+        int len = 0;
+        while (path[len] && path[len] != '/') {
+            if (len == SFS_NAME_MAX) return -1;
+            name[len] = path[len];
+            len++;
+        }
+        name[len] = '\0';
+        path += len;
+
+        sfs_inode_t dir;
+        uint32_t slot;
+        if (sfs_read_inode(fs, current, &dir) != 0 || dir.type != SFS_TYPE_DIR) return -1;
+        current = sfs_dir_find(fs, &dir, name, &slot);
+        if (!current) return -1;
+    }
+
+    *ino = current;
+    return 0;
+}
+
+/**
+ * sfs_walk_parent - Resolve the directory that holds a path
+ * @fs: Volume
+ * @path: Absolute path within the volume
+ * @parent: Receives the directory's inode number
+ * @dir: Receives the directory's inode
+ * @name: Receives the last component, SFS_NAME_MAX + 1 bytes
+ *
+ * Return: 0 on success, -1 if the directory does not exist or the name is invalid
+ */
+static int sfs_walk_parent(sfs_t *fs, const char *path, uint32_t *parent,
+                           sfs_inode_t *dir, char *name) {
+    char prefix[VFS_PATH_MAX];
+    uint32_t len = strlen(path);
+    uint32_t cut = len;
+
+    if (len >= VFS_PATH_MAX) return -1;
+    while (cut > 0 && path[cut - 1] != '/') cut--;
+    if (len - cut == 0 || len - cut > SFS_NAME_MAX) return -1;
+
+    strcpy(name, path + cut);
+    memcpy(prefix, path, cut);
+    prefix[cut] = '\0';
+
+    if (sfs_walk(fs, prefix, parent) != 0) return -1;
+    if (sfs_read_inode(fs, *parent, dir) != 0 || dir->type != SFS_TYPE_DIR) return -1;
+    return 0;
+}
+
+/**
+ * sfs_make - Create a file or directory
+ * @fs: Volume
+ * @path: Path within the volume
+ * @type: SFS_TYPE_FILE or SFS_TYPE_DIR
+ * @ino: Receives the new inode number
+ *
+ * Files get an inode in their directory's group, directories in the
+ * group with the most free space.
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int sfs_make(sfs_t *fs, const char *path, uint16_t type, uint32_t *ino) {
+    sfs_inode_t dir, inode;
+    uint32_t parent, slot;
+    char name[SFS_NAME_MAX + 1];
+
+    if (sfs_walk_parent(fs, path, &parent, &dir, name) != 0) return -1;
+    if (sfs_dir_find(fs, &dir, name, &slot)) return -1;
+
+    if (sfs_begin(fs) != 0) return -1;
+    uint32_t group = type == SFS_TYPE_DIR ? sfs_dir_group(fs) : sfs_inode_group(parent);
+    uint32_t new_ino = sfs_alloc_inode(fs, group);
+    if (!new_ino) return -1;
+
+    memset(&inode, 0, sizeof(inode));
+    inode.type = type;
+    inode.links = 1;
+    if (sfs_write_inode(fs, new_ino, &inode) != 0 ||
+        sfs_dir_add(fs, parent, name, new_ino) != 0) {
+        sfs_free_inode(fs, new_ino);
+        return -1;
+    }
+
+    *ino = new_ino;
+    return 0;
+}
+
+/**
+ * sfs_remove - Delete a file or an empty directory
+ * @fs: Volume
+ * @path: Path within the volume
+ * @type: Type the node must have
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int sfs_remove(sfs_t *fs, const char *path, uint16_t type) {
+    sfs_inode_t dir, inode;
+    uint32_t parent, slot;
+    char name[SFS_NAME_MAX + 1];
+
+    if (sfs_walk_parent(fs, path, &parent, &dir, name) != 0) return -1;
+
+    uint32_t ino = sfs_dir_find(fs, &dir, name, &slot);
+    if (!ino || sfs_read_inode(fs, ino, &inode) != 0) return -1;
+    if (inode.type != type) return -1;
+    if (type == SFS_TYPE_DIR && inode.entries) return -1;
+
+    if (sfs_begin(fs) != 0) return -1;
+    if (sfs_dir_remove(fs, parent, &dir, slot) != 0) return -1;
+    sfs_shrink(fs, &inode, 0);
+    sfs_free_inode(fs, ino);
+    return 0;
+}
+
+/**
+ * sfs_mount - Open an sfs volume on a block device
+ * @dev: Block device
+ *
+ * The journal is replayed before the free counts are taken from the bitmaps.
+ *
+ * Return: Volume state, NULL if the device holds no sfs volume
+ */
+void *sfs_mount(blockdev_t *dev) {
+    if (dev->sectors < (SFS_FIRST_GROUP + SFS_GROUP_DATA) * (SFS_BLOCK_SIZE / BLOCKDEV_SECTOR_SIZE)) {
+        return NULL;
+    }
+
+    bcache_buf_t *buf = bcache_read(dev, SFS_SUPER_BLOCK);
+    if (!buf) return NULL;
+
+    sfs_super_t super;
+    memcpy(&super, buf->data, sizeof(super));
+    bcache_release(buf);
+
+    if (super.magic != SFS_MAGIC || super.group_count == 0 ||
+        super.group_count > SFS_MAX_GROUPS ||
+        super.inode_count != super.group_count * SFS_INODES_PER_GROUP ||
+        super.block_count <= sfs_group_start(super.group_count - 1) + SFS_GROUP_DATA ||
+        super.block_count > sfs_group_start(super.group_count) ||
+        (uint64_t)super.block_count * (SFS_BLOCK_SIZE / BLOCKDEV_SECTOR_SIZE) > dev->sectors) {
+        return NULL;
+    }
+
+    // The journal must fit in group 0's data area and hold one operation
+    if (super.journal_blocks &&
+        (super.journal_blocks < SFS_OP_CREDITS + 2 ||
+         super.journal_start < sfs_group_start(0) + SFS_GROUP_DATA ||
+         super.journal_start + super.journal_blocks > sfs_group_start(1) ||
+         super.journal_start + super.journal_blocks > super.block_count)) {
+        return NULL;
+    }
+
+    sfs_t *fs = kmalloc(sizeof(sfs_t));
+    if (!fs) return NULL;
+    memset(fs, 0, sizeof(sfs_t));
+    fs->dev = dev;
+    fs->super = super;
+
+    if (super.journal_blocks) {
+        fs->txn_capacity = super.journal_blocks - 2;
+        if (fs->txn_capacity > SFS_TXN_MAX) fs->txn_capacity = SFS_TXN_MAX;
+        if (fs->txn_capacity > SFS_JOURNAL_MAX_LOGGED) fs->txn_capacity = SFS_JOURNAL_MAX_LOGGED;
+
+        fs->journal = kmalloc((fs->txn_capacity + 2) * SFS_BLOCK_SIZE);
+        if (!fs->journal || sfs_replay(fs) != 0) {
+            if (fs->journal) kfree(fs->journal);
+            kfree(fs);
+            return NULL;
+        }
+    }
+
+    for (uint32_t g = 0; g < super.group_count; g++) {
+        uint32_t start = sfs_group_start(g);
+        fs->free_blocks[g] = sfs_bitmap_count(fs, start + SFS_GROUP_BLOCK_BITMAP, sfs_group_size(fs, g));
+        fs->free_inodes[g] = sfs_bitmap_count(fs, start + SFS_GROUP_INODE_BITMAP, SFS_INODES_PER_GROUP);
+    }
+    return fs;
+}
+
+/*
+ * VFS backend operations
+ */
+
+/**
+ * sfs_lookup - Find the inode of a path
+ */
+static int sfs_lookup(void *fs, const char *path, uint32_t *ino) {
+    return sfs_walk(fs, path, ino);
+}
+
+/**
+ * sfs_create - Create a file and return its inode
+ */
+static int sfs_create(void *fs, const char *path, uint32_t *ino) {
+    return sfs_make(fs, path, SFS_TYPE_FILE, ino);
+}
+
+/**
+ * sfs_mkdir - Create a directory
+ */
+static int sfs_mkdir(void *fs, const char *path) {
+    uint32_t ino;
+    return sfs_make(fs, path, SFS_TYPE_DIR, &ino);
+}
+
+/**
+ * sfs_unlink - Delete a file
+ */
+static int sfs_unlink(void *fs, const char *path) {
+    return sfs_remove(fs, path, SFS_TYPE_FILE);
+}
+
+/**
+ * sfs_rmdir - Delete an empty directory
+ */
+static int sfs_rmdir(void *fs, const char *path) {
+    return sfs_remove(fs, path, SFS_TYPE_DIR);
+}
+
+/**
+ * sfs_read - Read part of a file by inode
+ */
+static int sfs_read(void *fs, uint32_t ino, void *buffer, uint32_t offset, uint32_t len) {
+    sfs_inode_t inode;
+    if (sfs_read_inode(fs, ino, &inode) != 0 || inode.type != SFS_TYPE_FILE) return -1;
+
+    return sfs_pread(fs, &inode, buffer, offset, len);
+}
+
+/**
+ * sfs_write - Write part of a file by inode
+ */
+static int sfs_write(void *fs, uint32_t ino, const void *data, uint32_t offset, uint32_t len) {
+    sfs_inode_t inode;
+    uint32_t done = 0;
+
+    if (sfs_read_inode(fs, ino, &inode) != 0 || inode.type != SFS_TYPE_FILE) return -1;
+
+    // Each slice is its own operation with its own journal credits
+    do {
+        uint32_t n = len - done < SFS_WRITE_SLICE ? len - done : SFS_WRITE_SLICE;
+
+        if (sfs_begin(fs) != 0) return done ? (int)done : -1;
+        int written = sfs_pwrite(fs, ino, &inode, (const uint8_t *)data + done, offset + done, n);
+        if (written < 0) return done ? (int)done : -1;
+        done += written;
+        if ((uint32_t)written < n) break;
+    } while (done < len);
+    return done;
+}
+
+/**
+ * sfs_truncate - Set the size of a file by inode
+ */
+static int sfs_truncate(void *fs, uint32_t ino, uint32_t size) {
+    sfs_inode_t inode;
+    if (sfs_read_inode(fs, ino, &inode) != 0 || inode.type != SFS_TYPE_FILE) return -1;
+
+    if (sfs_begin(fs) != 0) return -1;
+
+    // Growing leaves the new space unallocated, it reads as zeros
+    if (size < inode.size) {
+        sfs_shrink(fs, &inode, size);
+    } else {
+        inode.size = size;
+    }
+    return sfs_write_inode(fs, ino, &inode);
+}
+
+/**
+ * sfs_stat - Get the size and type of an inode
+ */
+static int sfs_stat(void *fs, uint32_t ino, vfs_stat_t *st) {
+    sfs_inode_t inode;
+    if (sfs_read_inode(fs, ino, &inode) != 0 || inode.type == 0) return -1;
+
+    st->type = inode.type == SFS_TYPE_DIR ? VFS_TYPE_DIR : VFS_TYPE_FILE;
+    st->size = inode.type == SFS_TYPE_DIR ? inode.entries : inode.size;
+    return 0;
+}
+
+/**
+ * sfs_readdir - Get the next entry of a directory
+ */
+static int sfs_readdir(void *fs, uint32_t ino, uint32_t *cookie, vfs_dirent_t *entry) {
+    sfs_inode_t dir;
+    sfs_dirent_t d;
+    vfs_stat_t st;
+
+    if (sfs_read_inode(fs, ino, &dir) != 0 || dir.type != SFS_TYPE_DIR) return -1;
+
+    // The cookie is the next entry index to scan
+    uint32_t count = dir.size / SFS_DIRENT_SIZE;
+    for (uint32_t i = *cookie; i < count; i++) {
+        if (sfs_pread(fs, &dir, &d, i * SFS_DIRENT_SIZE, SFS_DIRENT_SIZE) != SFS_DIRENT_SIZE) break;
+        if (!d.ino || sfs_stat(fs, d.ino, &st) != 0) continue;
+
+        strcpy(entry->name, d.name);
+        entry->size = st.size;
+        entry->type = st.type;
+        *cookie = i + 1;
+        return 0;
+    }
+
+    *cookie = count;
+    return -1;
+}
+
+/**
+ * sfs_readahead - Prefetch the blocks behind a byte range of a file
+ *
+ * The range is split into runs of contiguous disk blocks, each queued
+ * on the block cache as one multi-sector read; nothing waits for them.
+ */
+static int sfs_readahead(void *fs, uint32_t ino, uint32_t offset, uint32_t len) {
+    sfs_t *volume = fs;
+    sfs_inode_t inode;
+
+    if (sfs_read_inode(volume, ino, &inode) != 0 || inode.type != SFS_TYPE_FILE) return -1;
+    if (offset >= inode.size) return 0;
+    if (len > inode.size - offset) len = inode.size - offset;
+
+    uint32_t index = offset / SFS_BLOCK_SIZE;
+    uint32_t last = (offset + len - 1) / SFS_BLOCK_SIZE;
+
+    while (index <= last) {
+        uint32_t start = sfs_bmap(&inode, index);
+        uint32_t count = 1;
+        if (!start) {
+            index++;
+            continue;
+        }
+        while (index + count <= last && sfs_bmap(&inode, index + count) == start + count) {
+            count++;
+        }
+
+        if (bcache_prefetch(volume->dev, start, count) < 0) return -1;
+        index += count;
+    }
+    return 0;
+}
+
+/**
+ * sfs_sync - Commit the open journal transaction
+ */
+static int sfs_sync(void *fs) {
+    return sfs_commit(fs);
+}
+
+const vfs_ops_t sfs_ops = {
+    .name = "sfs",
+    .lookup = sfs_lookup,
+    .create = sfs_create,
+    .mkdir = sfs_mkdir,
+    .unlink = sfs_unlink,
+    .rmdir = sfs_rmdir,
+    .read = sfs_read,
+    .write = sfs_write,
+    .truncate = sfs_truncate,
+    .stat = sfs_stat,
+    .readdir = sfs_readdir,
+    .sync = sfs_sync,
+    .readahead = sfs_readahead,
+};
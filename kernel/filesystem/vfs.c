@@ -0,0 +1,546 @@
+/**
+ * vfs.c - Virtual file system
+ * Resolves paths to mounted backends and keeps open file descriptors
+ */
+
+#include "../../include/vfs.h"
+#include "../../include/memory.h"
+#include "../../include/bcache.h"
+#include "../../include/timer.h"
+#include "../../include/isr.h"
+
+// Mount table
+static vfs_mount_t mounts[VFS_MAX_MOUNTS];
+
+// Context of the kernel shell, used until another one is set
+static vfs_context_t kernel_context;
+static vfs_context_t *current = &kernel_context;
+
+// Tick of the last periodic backend sync
+static uint32_t last_commit = 0;
+
+/**
+ * vfs_init - Initialize the VFS and the kernel context
+ */
+__cold void vfs_init(void) {
+    for (int i = 0; i < VFS_MAX_MOUNTS; i++) {
+        mounts[i].in_use = false;
+    }
+
+    vfs_context_init(&kernel_context);
+    current = &kernel_context;
+}
+
+/**
+ * vfs_context_init - Reset a context to no open files and the root directory
+ * @ctx: Context to initialize
+ */
+void vfs_context_init(vfs_context_t *ctx) {
+    for (int i = 0; i < VFS_MAX_FDS; i++) {
+        ctx->fds[i].in_use = false;
+    }
+    strcpy(ctx->cwd, "/");
+}
+
+/**
+ * vfs_set_context - Switch the context used by later calls
+ * @ctx: New context
+ *
+ * Return: Previous context
+ */
+vfs_context_t *vfs_set_context(vfs_context_t *ctx) {
+    vfs_context_t *previous = current;
+    current = ctx;
+    return previous;
+}
+
+/**
+ * vfs_normalize - Turn a path into an absolute path without . and ..
+ * @path: Absolute path, or relative to the working directory
+ * @out: Receives the result, VFS_PATH_MAX bytes
+ *
+ * Return: 0 on success, -1 if the result is too long
+ */
+static int vfs_normalize(const char *path, char *out) {
+    uint32_t len;
+
+    if (path[0] == '/') {
+        out[0] = '/';
+        len = 1;
+    } else {
+        strcpy(out, current->cwd);
+        len = strlen(out);
+    }
+
+    while (*path) {
+        while (*path == '/') path++;
+        if (!*path) break;
+
+        const char *name = path;
+        uint32_t name_len = 0;
+        while (*path && *path != '/') {
+            path++;
+            name_len++;
+        }
+
+        if (name_len == 1 && name[0] == '.') continue;
+        if (name_len == 2 && name[0] == '.' && name[1] == '.') {
+            // Drop the last component, the root's parent is the root
+            while (len > 1 && out[len - 1] != '/') len--;
+            if (len > 1) len--;
+            continue;
+        }
+
+        uint32_t sep = len > 1 ? 1 : 0;
+        if (len + sep + name_len >= VFS_PATH_MAX) return -1;
+        if (sep) out[len++] = '/';
+        memcpy(out + len, name, name_len);
+        len += name_len;
+    }
+
+    out[len] = '\0';
+    return 0;
+}
+
+/**
+ * vfs_find_mount - Find the mount that holds an absolute path
+ * @path: Normalized absolute path
+ * @rest: Receives the path within the mount
+ *
+ * The longest mount point that is a whole-component prefix wins.
+ *
+ * Return: Mount, NULL if nothing is mounted there
+ */
+static vfs_mount_t *vfs_find_mount(const char *path, const char **rest) {
+    vfs_mount_t *best = NULL;
+    uint32_t best_len = 0;
+
+    for (int i = 0; i < VFS_MAX_MOUNTS; i++) {
+        vfs_mount_t *m = &mounts[i];
+        if (!m->in_use) continue;
+
+        // The root mount has length 1 but matches every path
+        uint32_t len = strlen(m->path);
+        uint32_t match = len == 1 ? 0 : len;
+        uint32_t j = 0;
+        while (j < match && path[j] == m->path[j]) j++;
+        if (j != match || (match && path[j] != '\0' && path[j] != '/')) continue;
+
+        if (!best || match > best_len) {
+            best = m;
+            best_len = match;
+        }
+    }
+
+    if (best) {
+        *rest = path[best_len] ? path + best_len : "/";
+    }
+    return best;
+}
+
+/**
+ * vfs_resolve - Normalize a path and find its mount
+ * @path: Path given by the caller
+ * @abs: Receives the normalized absolute path, VFS_PATH_MAX bytes
+ * @rest: Receives the path within the mount
+ *
+ * Return: Mount, NULL on error
+ */
+static vfs_mount_t *vfs_resolve(const char *path, char *abs, const char **rest) {
+    if (vfs_normalize(path, abs) != 0) return NULL;
+    return vfs_find_mount(abs, rest);
+}
+
+/**
+ * vfs_get - Get an open file from a descriptor
+ * @fd: File descriptor
+ *
+ * Return: Open file, NULL if not open
+ */
+static vfs_file_t *vfs_get(int fd) {
+    if (fd < 0 || fd >= VFS_MAX_FDS || !current->fds[fd].in_use) return NULL;
+    return &current->fds[fd];
+}
+
+/**
+ * vfs_is_mount_point - Check if a normalized path is a mount point
+ * @path: Normalized absolute path
+ *
+ * Return: true if something is mounted there
+ */
+static bool vfs_is_mount_point(const char *path) {
+    for (int i = 0; i < VFS_MAX_MOUNTS; i++) {
+        if (mounts[i].in_use && strcmp(mounts[i].path, path) == 0) return true;
+    }
+    return false;
+}
+
+/**
+ * vfs_mount - Attach a filesystem backend at a path
+ * @path: Mount point, "/" or an existing directory
+ * @ops: Backend operations
+ * @fs: Backend state
+ *
+ * Return: 0 on success, -1 on error
+ */
+int vfs_mount(const char *path, const vfs_ops_t *ops, void *fs) {
+    char abs[VFS_PATH_MAX];
+    if (vfs_normalize(path, abs) != 0 || vfs_is_mount_point(abs)) return -1;
+
+    // Anything but the root must be a directory of the parent mount
+    if (strcmp(abs, "/") != 0) {
+        vfs_stat_t st;
+        if (vfs_stat(abs, &st) != 0 || st.type != VFS_TYPE_DIR) return -1;
+    }
+
+    for (int i = 0; i < VFS_MAX_MOUNTS; i++) {
+        if (!mounts[i].in_use) {
+            strcpy(mounts[i].path, abs);
+            mounts[i].ops = ops;
+            mounts[i].fs = fs;
+            mounts[i].in_use = true;
+            return 0;
+        }
+    }
+    return -1; // Mount table full
+}
+
+/**
+ * vfs_open - Open a file or directory
+ * @path: Absolute path, or relative to the working directory
+ * @flags: VFS_O_* flags
+ *
+ * Return: File descriptor, -1 on error
+ */
+int vfs_open(const char *path, int flags) {
+    char abs[VFS_PATH_MAX];
+    const char *rest;
+    vfs_mount_t *m = vfs_resolve(path, abs, &rest);
+    if (!m) return -1;
+
+    int fd = 0;
+    while (fd < VFS_MAX_FDS && current->fds[fd].in_use) fd++;
+    if (fd == VFS_MAX_FDS) return -1; // Descriptor table full
+
+    uint32_t ino;
+    if (m->ops->lookup(m->fs, rest, &ino) != 0) {
+        if (!(flags & VFS_O_CREAT) || m->ops->create(m->fs, rest, &ino) != 0) {
+            return -1; // Not found or could not create
+        }
+    } else if ((flags & VFS_O_CREAT) && (flags & VFS_O_EXCL)) {
+        return -1; // Already exists
+    }
+
+    vfs_stat_t st;
+    if (m->ops->stat(m->fs, ino, &st) != 0) return -1;
+    if (st.type == VFS_TYPE_DIR && (flags & VFS_O_WRITE)) return -1;
+
+    if ((flags & VFS_O_TRUNC) && (flags & VFS_O_WRITE) &&
+        m->ops->truncate(m->fs, ino, 0) != 0) {
+        return -1;
+    }
+
+    vfs_file_t *f = &current->fds[fd];
+    f->mount = m;
+    f->ino = ino;
+    f->offset = 0;
+    f->ra_next = 0;
+    f->ra_end = 0;
+    f->ra_size = 0;
+    f->flags = flags;
+    f->type = st.type;
+    f->in_use = true;
+    return fd;
+}
+
+/**
+ * vfs_close - Close a file descriptor
+ * @fd: File descriptor
+ *
+ * Return: 0 on success, -1 if not open
+ */
+int vfs_close(int fd) {
+    vfs_file_t *f = vfs_get(fd);
+    if (!f) return -1;
+
+    f->in_use = false;
+    return 0;
+}
+
+/**
+ * vfs_readahead - Track sequential reads and load the next window early
+ * @f: Open file
+ * @offset: Offset of the read that just finished
+ * @len: Bytes it returned
+ *
+ * A read that starts where the previous one ended is sequential. Once a
+ * sequential reader gets within half a window of the data already read
+ * ahead, the next window is requested, so it is in memory before the
+ * reader gets there. The window doubles each time the reader keeps up
+ * and halves on every non-sequential read.
+ */
+static void vfs_readahead(vfs_file_t *f, uint32_t offset, uint32_t len) {
+    const vfs_ops_t *ops = f->mount->ops;
+    uint32_t end = offset + len;
+
+    if (!ops->readahead) return;
+
+    if (offset != f->ra_next) {
+        f->ra_size /= 2;
+        if (f->ra_size < VFS_RA_MIN) f->ra_size = 0;
+        f->ra_end = 0;
+        f->ra_next = end;
+        return;
+    }
+    // The read was served from data read ahead earlier
+    bool hit = f->ra_end > offset;
+    f->ra_next = end;
+
+    if (f->ra_size == 0) f->ra_size = VFS_RA_MIN;
+    if (f->ra_end < end) f->ra_end = end;
+    if (end + f->ra_size / 2 < f->ra_end) return;
+
+    if (hit && f->ra_size < VFS_RA_MAX) f->ra_size *= 2;
+    ops->readahead(f->mount->fs, f->ino, f->ra_end, f->ra_size);
+    f->ra_end += f->ra_size;
+}
+
+/**
+ * vfs_read - Read from an open file at its offset
+ * @fd: File descriptor
+ * @buffer: Buffer to store data
+ * @len: Maximum number of bytes to read
+ *
+ * Return: Number of bytes read (0 at end of file), -1 on error
+ */
+int vfs_read(int fd, void *buffer, uint32_t len) {
+    vfs_file_t *f = vfs_get(fd);
+    if (!f || !(f->flags & VFS_O_READ) || f->type != VFS_TYPE_FILE) return -1;
+
+    int n = f->mount->ops->read(f->mount->fs, f->ino, buffer, f->offset, len);
+    if (n > 0) {
+        vfs_readahead(f, f->offset, n);
+        f->offset += n;
+    }
+    return n;
+}
+
+/**
+ * vfs_write - Write to an open file at its offset
+ * @fd: File descriptor
+ * @data: Data to write
+ * @len: Number of bytes to write
+ *
+ * Files opened with VFS_O_APPEND always write at the end.
+ *
+ * Return: Number of bytes written, -1 on error
+ */
+int vfs_write(int fd, const void *data, uint32_t len) {
+    vfs_file_t *f = vfs_get(fd);
+    if (!f || !(f->flags & VFS_O_WRITE)) return -1;
+
+    if (f->flags & VFS_O_APPEND) {
+        vfs_stat_t st;
+        if (f->mount->ops->stat(f->mount->fs, f->ino, &st) != 0) return -1;
+        f->offset = st.size;
+    }
+
+    int n = f->mount->ops->write(f->mount->fs, f->ino, data, f->offset, len);
+    if (n > 0) f->offset += n;
+    return n;
+}
+
+/**
+ * vfs_lseek - Move the offset of an open file
+ * @fd: File descriptor
+ * @offset: Offset relative to @whence
+ * @whence: VFS_SEEK_SET, VFS_SEEK_CUR or VFS_SEEK_END
+ *
+ * Return: New offset, -1 on error
+ */
+int vfs_lseek(int fd, int32_t offset, int whence) {
+    vfs_file_t *f = vfs_get(fd);
+    if (!f || f->type != VFS_TYPE_FILE) return -1;
+
+    int32_t base;
+    if (whence == VFS_SEEK_SET) {
+        base = 0;
+    } else if (whence == VFS_SEEK_CUR) {
+        base = f->offset;
+    } else if (whence == VFS_SEEK_END) {
+        vfs_stat_t st;
+        if (f->mount->ops->stat(f->mount->fs, f->ino, &st) != 0) return -1;
+        base = st.size;
+    } else {
+        return -1;
+    }
+
+    if (base + offset < 0) return -1;
+    f->offset = base + offset;
+    return f->offset;
+}
+
+/**
+ * vfs_readdir - Read the next entry of an open directory
+ * @fd: File descriptor of a directory
+ * @entry: Receives the entry
+ *
+ * Return: 0 on success, -1 at the end of the directory or on error
+ */
+int vfs_readdir(int fd, vfs_dirent_t *entry) {
+    vfs_file_t *f = vfs_get(fd);
+    if (!f || f->type != VFS_TYPE_DIR) return -1;
+
+    return f->mount->ops->readdir(f->mount->fs, f->ino, &f->offset, entry);
+}
+
+/**
+ * vfs_stat - Get information about a path
+ * @path: Path to look up
+ * @st: Receives the information
+ *
+ * Return: 0 on success, -1 if not found
+ */
+int vfs_stat(const char *path, vfs_stat_t *st) {
+    char abs[VFS_PATH_MAX];
+    const char *rest;
+    uint32_t ino;
+    vfs_mount_t *m = vfs_resolve(path, abs, &rest);
+
+    if (!m || m->ops->lookup(m->fs, rest, &ino) != 0) return -1;
+    memset(st, 0, sizeof(vfs_stat_t));
+    return m->ops->stat(m->fs, ino, st);
+}
+
+/**
+ * vfs_setattr - Change the storage attributes of a file
+ * @path: Path of the file
+ * @flags: VFS_ATTR_* flags the file should have
+ *
+ * Return: 0 on success, -1 on error or if the backend has no attributes
+ */
+int vfs_setattr(const char *path, uint8_t flags) {
+    char abs[VFS_PATH_MAX];
+    const char *rest;
+    uint32_t ino;
+    vfs_mount_t *m = vfs_resolve(path, abs, &rest);
+
+    if (!m || !m->ops->setattr || m->ops->lookup(m->fs, rest, &ino) != 0) return -1;
+    return m->ops->setattr(m->fs, ino, flags);
+}
+
+/**
+ * vfs_mkdir - Create a directory
+ * @path: Path of the directory
+ *
+ * Return: 0 on success, -1 on error
+ */
+int vfs_mkdir(const char *path) {
+    char abs[VFS_PATH_MAX];
+    const char *rest;
+    vfs_mount_t *m = vfs_resolve(path, abs, &rest);
+
+    if (!m || vfs_is_mount_point(abs)) return -1;
+    return m->ops->mkdir(m->fs, rest);
+}
+
+/**
+ * vfs_rmdir - Delete an empty directory
+ * @path: Path of the directory
+ *
+ * The working directory and mount points cannot be removed.
+ *
+ * Return: 0 on success, -1 on error
+ */
+int vfs_rmdir(const char *path) {
+    char abs[VFS_PATH_MAX];
+    const char *rest;
+    vfs_mount_t *m = vfs_resolve(path, abs, &rest);
+
+    if (!m || vfs_is_mount_point(abs) || strcmp(abs, current->cwd) == 0) return -1;
+    return m->ops->rmdir(m->fs, rest);
+}
+
+/**
+ * vfs_unlink - Delete a file
+ * @path: Path of the file
+ *
+ * Return: 0 on success, -1 on error
+ */
+int vfs_unlink(const char *path) {
+    char abs[VFS_PATH_MAX];
+    const char *rest;
+    vfs_mount_t *m = vfs_resolve(path, abs, &rest);
+
+    if (!m) return -1;
+    return m->ops->unlink(m->fs, rest);
+}
+
+/**
+ * vfs_chdir - Change the working directory of the current context
+ * @path: Path of the new working directory
+ *
+ * Return: 0 on success, -1 if not a directory
+ */
+int vfs_chdir(const char *path) {
+    char abs[VFS_PATH_MAX];
+    vfs_stat_t st;
+
+    if (vfs_normalize(path, abs) != 0) return -1;
+    if (vfs_stat(abs, &st) != 0 || st.type != VFS_TYPE_DIR) return -1;
+
+    strcpy(current->cwd, abs);
+    return 0;
+}
+
+/**
+ * vfs_getcwd - Get the working directory of the current context
+ *
+ * Return: Absolute path of the working directory
+ */
+const char *vfs_getcwd(void) {
+    return current->cwd;
+}
+
+/**
+ * vfs_sync - Flush every mounted filesystem and the block cache
+ *
+ * Backends first write their pending state into the cache, then all
+ * dirty blocks go to disk.
+ *
+ * Return: Number of blocks written, -1 on error
+ */
+int vfs_sync(void) {
+    bool failed = false;
+
+    for (int i = 0; i < VFS_MAX_MOUNTS; i++) {
+        vfs_mount_t *m = &mounts[i];
+        if (m->in_use && m->ops->sync && m->ops->sync(m->fs) != 0) {
+            failed = true;
+        }
+    }
+
+    int written = bcache_sync(NULL);
+    return failed ? -1 : written;
+}
+
+/**
+ * vfs_writeback - Periodic background sync
+ *
+ * Backends are synced under irq_save(): shell commands run in the
+ * keyboard IRQ, and none may find its volume in the middle of a commit.
+ */
+void vfs_writeback(void) {
+    if (timer_get_ticks() - last_commit >= VFS_COMMIT_INTERVAL) {
+        last_commit = timer_get_ticks();
+
+        uint32_t flags = irq_save();
+        for (int i = 0; i < VFS_MAX_MOUNTS; i++) {
+            vfs_mount_t *m = &mounts[i];
+            if (m->in_use && m->ops->sync) m->ops->sync(m->fs);
+        }
+        irq_restore(flags);
+    }
+
+    bcache_writeback();
+}
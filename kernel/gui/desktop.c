@@ -5,6 +5,8 @@
 
 #include "../../include/desktop.h"
 #include "../../include/gui.h"
+#include "../../include/wm.h"
+#include "../../include/frame.h"
 #include "../../include/vga.h"
 #include "../../include/font.h"
 #include "../../include/memory.h"
@@ -20,14 +22,42 @@ static label_t info_label2;
 static label_t info_label3;
 static button_t about_button;
 static button_t shutdown_button;
+static window_t about_window;
+
+// Widget tree for the welcome window
+static widget_t welcome_root;
+static widget_t welcome_label_node;
+static widget_t info_label1_node;
+static widget_t info_label2_node;
+static widget_t info_label3_node;
+static widget_t about_button_node;
+static widget_t shutdown_button_node;
+
+// Widget tree for the About dialog
+static widget_t about_root;
+static label_t about_label1;
+static label_t about_label2;
+static label_t about_label3;
+static label_t about_label4;
+static widget_t about_label1_node;
+static widget_t about_label2_node;
+static widget_t about_label3_node;
+static widget_t about_label4_node;
+
+// Frame-time overlay on the taskbar
+static bool overlay_shown = false;
 
 // Taskbar
 static int taskbar_height = 20;
 
+static void desktop_paint_background(void);
+static void desktop_paint_overlay(const char *text);
+static void desktop_setup_label(label_t *label, int x, int y, const char *text, uint8_t color);
+
 /**
  * desktop_init - Initialize desktop environment
  */
-void desktop_init(void) {
+__cold void desktop_init(void) {
     if (desktop_initialized) return;
     
     // Setup welcome window
@@ -38,6 +68,8 @@ void desktop_init(void) {
     strcpy(welcome_window.title, "Welcome!");
     welcome_window.visible = true;
     welcome_window.active = true;
+    welcome_window.root = &welcome_root;
+    welcome_window.on_paint = NULL;
     
     // Setup welcome label
     welcome_label.x = 80;
@@ -74,6 +106,7 @@ void desktop_init(void) {
     about_button.visible = true;
     about_button.pressed = false;
     about_button.hovered = false;
+    about_button.on_click = desktop_show_about;
     
     // Setup Shutdown button
     shutdown_button.x = 150;
@@ -84,14 +117,90 @@ void desktop_init(void) {
     shutdown_button.visible = true;
     shutdown_button.pressed = false;
     shutdown_button.hovered = false;
-    
+    shutdown_button.on_click = NULL;
+
+    // Build the welcome window's widget tree
+    gui_widget_init(&welcome_root, WIDGET_WINDOW, &welcome_window);
+    gui_widget_init(&welcome_label_node, WIDGET_LABEL, &welcome_label);
+    gui_widget_init(&info_label1_node, WIDGET_LABEL, &info_label1);
+    gui_widget_init(&info_label2_node, WIDGET_LABEL, &info_label2);
+    gui_widget_init(&info_label3_node, WIDGET_LABEL, &info_label3);
+    gui_widget_init(&about_button_node, WIDGET_BUTTON, &about_button);
+    gui_widget_init(&shutdown_button_node, WIDGET_BUTTON, &shutdown_button);
+
+    gui_widget_add_child(&welcome_root, &welcome_label_node);
+    gui_widget_add_child(&welcome_root, &info_label1_node);
+    gui_widget_add_child(&welcome_root, &info_label2_node);
+    gui_widget_add_child(&welcome_root, &info_label3_node);
+    gui_widget_add_child(&welcome_root, &about_button_node);
+    gui_widget_add_child(&welcome_root, &shutdown_button_node);
+
+    // Setup About dialog (shown on demand)
+    about_window.x = 70;
+    about_window.y = 50;
+    about_window.width = 180;
+    about_window.height = 100;
+    strcpy(about_window.title, "About SimpleOS");
+    about_window.visible = false;
+    about_window.active = false;
+    about_window.root = &about_root;
+    about_window.on_paint = NULL;
+
+    desktop_setup_label(&about_label1, 90, 75, "SimpleOS v0.2.0", VGA_COLOR_BLACK);
+    desktop_setup_label(&about_label2, 90, 90, "Educational OS", VGA_COLOR_BLACK);
+    desktop_setup_label(&about_label3, 105, 105, "with GUI!", VGA_COLOR_BLACK);
+    desktop_setup_label(&about_label4, 110, 120, "(c) 2026", VGA_COLOR_DARK_GRAY);
+
+    gui_widget_init(&about_root, WIDGET_WINDOW, &about_window);
+    gui_widget_init(&about_label1_node, WIDGET_LABEL, &about_label1);
+    gui_widget_init(&about_label2_node, WIDGET_LABEL, &about_label2);
+    gui_widget_init(&about_label3_node, WIDGET_LABEL, &about_label3);
+    gui_widget_init(&about_label4_node, WIDGET_LABEL, &about_label4);
+
+    gui_widget_add_child(&about_root, &about_label1_node);
+    gui_widget_add_child(&about_root, &about_label2_node);
+    gui_widget_add_child(&about_root, &about_label3_node);
+    gui_widget_add_child(&about_root, &about_label4_node);
+
+    // Hand both windows to the window manager, welcome window at the bottom
+    wm_init(desktop_paint_background);
+    wm_add_window(&welcome_window);
+    wm_add_window(&about_window);
+
+    frame_init();
     desktop_initialized = true;
 }
 
+/**
+ * desktop_setup_label - Fill in a static text label
+ * @label: Label to set up
+ * @x: X position
+ * @y: Y position
+ * @text: Label text
+ * @color: Text color
+ */
+static void desktop_setup_label(label_t *label, int x, int y, const char *text, uint8_t color) {
+    label->x = x;
+    label->y = y;
+    strcpy(label->text, text);
+    label->color = color;
+    label->visible = true;
+}
+
 /**
  * desktop_draw - Draw the desktop
+ *
+ * The whole desktop is drawn as one frame.
  */
 void desktop_draw(void) {
+    wm_invalidate_all();
+    frame_pump();
+}
+
+/**
+ * desktop_paint_background - Draw everything below the windows
+ */
+static void desktop_paint_background(void) {
     // Clear screen with desktop background
     vga_clear_screen(VGA_COLOR_CYAN);
     
@@ -104,22 +213,25 @@ void desktop_draw(void) {
     
     // Draw time (placeholder)
     font_draw_string("12:00", VGA_WIDTH - 45, VGA_HEIGHT - taskbar_height + 6, VGA_COLOR_WHITE, VGA_COLOR_DARK_GRAY);
-    
-    // Draw welcome window and its contents
-    gui_draw_window(&welcome_window);
-    gui_draw_label(&welcome_label);
-    gui_draw_label(&info_label1);
-    gui_draw_label(&info_label2);
-    gui_draw_label(&info_label3);
-    gui_draw_button(&about_button);
-    gui_draw_button(&shutdown_button);
-    
+
     // Draw desktop icons
     desktop_draw_icon(10, 10, "Terminal", VGA_COLOR_WHITE);
     desktop_draw_icon(10, 70, "Files", VGA_COLOR_YELLOW);
     desktop_draw_icon(10, 130, "Settings", VGA_COLOR_LIGHT_GRAY);
 }
 
+/**
+ * desktop_paint_overlay - Draw frame statistics on the taskbar
+ * @text: Overlay text
+ */
+static void desktop_paint_overlay(const char *text) {
+    int y = VGA_HEIGHT - taskbar_height + 6;
+
+    // Clear the field so shorter text leaves nothing behind
+    vga_draw_rect(20, y, 30, 1, VGA_COLOR_DARK_GRAY);
+    font_draw_string(text, 20, y, VGA_COLOR_YELLOW, VGA_COLOR_DARK_GRAY);
+}
+
 /**
  * desktop_draw_icon - Draw a desktop icon
  * @x: X position
@@ -146,34 +258,26 @@ void desktop_draw_icon(int x, int y, const char *label, uint8_t color) {
  * @c: Character pressed
  */
 void desktop_handle_key(char c) {
-    // For now, just redraw
-    // In a full implementation, this would handle keyboard shortcuts
-    (void)c; // Unused parameter
+    // F: toggle the frame-time overlay
+    if (c == 'f' || c == 'F') {
+        overlay_shown = !overlay_shown;
+        frame_set_overlay(overlay_shown ? desktop_paint_overlay : NULL);
+    }
+
+    // Nothing pumps frames from an idle loop yet, present the change now
+    frame_pump();
 }
 
 /**
  * desktop_show_about - Show about dialog
  */
 void desktop_show_about(void) {
-    // Create about window
-    window_t about_win;
-    about_win.x = 70;
-    about_win.y = 50;
-    about_win.width = 180;
-    about_win.height = 100;
-    strcpy(about_win.title, "About SimpleOS");
-    about_win.visible = true;
-    
-    // Redraw desktop
-    desktop_draw();
-    
-    // Draw about window on top
-    gui_draw_window(&about_win);
-    
-    // Draw about text
-    font_draw_string("SimpleOS v0.2.0", 90, 75, VGA_COLOR_BLACK, 0xFF);
-    font_draw_string("Educational OS", 90, 90, VGA_COLOR_BLACK, 0xFF);
-    font_draw_string("with GUI!", 105, 105, VGA_COLOR_BLACK, 0xFF);
-    font_draw_string("(c) 2026", 110, 120, VGA_COLOR_DARK_GRAY, 0xFF);
+    // Bring the dialog to the front; only its own area needs drawing
+    about_window.visible = true;
+    about_window.active = true;
+    welcome_window.active = false;
+    wm_raise(&about_window);
+    wm_invalidate_window(&about_window);
+    frame_pump();
 }
 
@@ -0,0 +1,159 @@
+/**
+ * frame.c - GUI frame loop
+ * Collects invalidations and presents at most once per vertical retrace
+ */
+
+#include "../../include/frame.h"
+#include "../../include/wm.h"
+#include "../../include/vga.h"
+#include "../../include/timer.h"
+
+#define FRAME_OVERLAY_LENGTH 48
+
+static frame_stats_t stats;
+
+// Statistics for the second in progress
+static uint32_t window_start = 0;
+static uint32_t window_frames = 0;
+static uint32_t window_worst = 0;
+
+// Overlay painter and whether its text changed
+static void (*overlay_painter)(const char *text) = NULL;
+static bool overlay_dirty = false;
+
+/**
+ * append_string - Append a string to a buffer
+ * @buf: Destination buffer
+ * @pos: Current length, updated
+ * @str: String to append
+ */
+static void append_string(char *buf, int *pos, const char *str) {
+    while (*str && *pos < FRAME_OVERLAY_LENGTH - 1) {
+        buf[(*pos)++] = *str++;
+    }
+    buf[*pos] = '\0';
+}
+
+/**
+ * append_uint - Append a decimal number to a buffer
+ * @buf: Destination buffer
+ * @pos: Current length, updated
+ * @n: Number to append
+ */
+static void append_uint(char *buf, int *pos, uint32_t n) {
+    char digits[11];
+    int i = 0;
+
+    do {
+        digits[i++] = '0' + (n % 10);
+        n /= 10;
+    } while (n > 0);
+
+    while (i > 0 && *pos < FRAME_OVERLAY_LENGTH - 1) {
+        buf[(*pos)++] = digits[--i];
+    }
+    buf[*pos] = '\0';
+}
+
+/**
+ * frame_format_overlay - Build the overlay text from the statistics
+ * @buf: Buffer of FRAME_OVERLAY_LENGTH bytes
+ */
+static void frame_format_overlay(char *buf) {
+    int pos = 0;
+
+    append_string(buf, &pos, "FPS ");
+    append_uint(buf, &pos, stats.fps);
+    append_string(buf, &pos, " L");
+    append_uint(buf, &pos, stats.layout_us);
+    append_string(buf, &pos, " R");
+    append_uint(buf, &pos, stats.raster_us);
+    append_string(buf, &pos, " P");
+    append_uint(buf, &pos, stats.present_us);
+    append_string(buf, &pos, "us");
+}
+
+/**
+ * frame_init - Reset the frame loop and its statistics
+ */
+__cold void frame_init(void) {
+    stats.frames = 0;
+    stats.fps = 0;
+    stats.layout_us = 0;
+    stats.raster_us = 0;
+    stats.present_us = 0;
+    stats.worst_us = 0;
+
+    window_start = timer_get_ticks();
+    window_frames = 0;
+    window_worst = 0;
+}
+
+/**
+ * frame_pump - Produce a frame if anything changed
+ *
+ * Return: true if a frame was presented
+ */
+bool frame_pump(void) {
+    // Roll the per-second counters over
+    uint32_t now = timer_get_ticks();
+    if (now - window_start >= TIMER_HZ) {
+        stats.fps = window_frames;
+        stats.worst_us = window_worst;
+        window_start = now;
+        window_frames = 0;
+        window_worst = 0;
+        if (overlay_painter) overlay_dirty = true;
+    }
+
+    if (!wm_needs_render() && !overlay_dirty) return false;
+
+    uint64_t start = timer_read_tsc();
+    wm_layout();
+    uint64_t laid_out = timer_read_tsc();
+
+    wm_render();
+    if (overlay_painter) {
+        char text[FRAME_OVERLAY_LENGTH];
+        frame_format_overlay(text);
+        overlay_painter(text);
+        overlay_dirty = false;
+    }
+    uint64_t rastered = timer_read_tsc();
+
+    // Present only at the start of a retrace to avoid tearing
+    vga_wait_retrace();
+    uint64_t retrace = timer_read_tsc();
+    vga_present();
+    uint64_t presented = timer_read_tsc();
+
+    stats.layout_us = timer_tsc_to_us(laid_out - start);
+    stats.raster_us = timer_tsc_to_us(rastered - laid_out);
+    stats.present_us = timer_tsc_to_us(presented - retrace);
+    stats.frames++;
+
+    uint32_t busy = stats.layout_us + stats.raster_us + stats.present_us;
+    if (busy > window_worst) window_worst = busy;
+    window_frames++;
+
+    return true;
+}
+
+/**
+ * frame_set_overlay - Show or hide the frame-time overlay
+ * @paint: Draws the overlay text on top of each frame, NULL to hide it
+ */
+void frame_set_overlay(void (*paint)(const char *text)) {
+    overlay_painter = paint;
+    overlay_dirty = paint != NULL;
+    if (!paint) wm_invalidate_all();
+}
+
+/**
+ * frame_get_stats - Get frame timing statistics
+ *
+ * Return: Current statistics
+ */
+const frame_stats_t *frame_get_stats(void) {
+    return &stats;
+}
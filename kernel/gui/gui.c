@@ -14,7 +14,7 @@ static bool gui_initialized = false;
 /**
  * gui_init - Initialize GUI system
  */
-void gui_init(void) {
+__cold void gui_init(void) {
     if (!gui_initialized) {
         vga_set_mode(0x03); // Text mode (already in it)
         vga_clear_screen(VGA_COLOR_BLUE); // Blue background
@@ -150,3 +150,348 @@ void gui_textbox_backspace(textbox_t *box) {
     }
 }
 
+
+/**
+ * gui_rect_intersect - Intersect two rectangles
+ * @a: First rectangle
+ * @b: Second rectangle
+ * @out: Receives the intersection
+ *
+ * Return: true if the intersection is not empty
+ */
+bool gui_rect_intersect(const rect_t *a, const rect_t *b, rect_t *out) {
+    int x1 = a->x > b->x ? a->x : b->x;
+    int y1 = a->y > b->y ? a->y : b->y;
+    int x2 = a->x + a->width < b->x + b->width ? a->x + a->width : b->x + b->width;
+    int y2 = a->y + a->height < b->y + b->height ? a->y + a->height : b->y + b->height;
+
+    if (x2 <= x1 || y2 <= y1) return false;
+
+    out->x = x1;
+    out->y = y1;
+    out->width = x2 - x1;
+    out->height = y2 - y1;
+    return true;
+}
+
+/**
+ * rect_union - Smallest rectangle covering two rectangles
+ * @a: First rectangle (may be empty)
+ * @b: Second rectangle (may be empty)
+ * @out: Receives the union
+ */
+static void rect_union(const rect_t *a, const rect_t *b, rect_t *out) {
+    if (a->width <= 0 || a->height <= 0) { *out = *b; return; }
+    if (b->width <= 0 || b->height <= 0) { *out = *a; return; }
+
+    int x1 = a->x < b->x ? a->x : b->x;
+    int y1 = a->y < b->y ? a->y : b->y;
+    int x2 = a->x + a->width > b->x + b->width ? a->x + a->width : b->x + b->width;
+    int y2 = a->y + a->height > b->y + b->height ? a->y + a->height : b->y + b->height;
+
+    out->x = x1;
+    out->y = y1;
+    out->width = x2 - x1;
+    out->height = y2 - y1;
+}
+
+/**
+ * widget_sync_bounds - Refresh a node's layout rectangle from its widget
+ * @w: Node
+ */
+static void widget_sync_bounds(widget_t *w) {
+    switch (w->type) {
+    case WIDGET_WINDOW: {
+        window_t *win = (window_t *)w->data;
+        w->bounds = (rect_t){win->x, win->y, win->width, win->height};
+        break;
+    }
+    case WIDGET_BUTTON: {
+        button_t *btn = (button_t *)w->data;
+        w->bounds = (rect_t){btn->x, btn->y, btn->width, btn->height};
+        break;
+    }
+    case WIDGET_TEXTBOX: {
+        textbox_t *box = (textbox_t *)w->data;
+        w->bounds = (rect_t){box->x, box->y, box->width, box->height};
+        break;
+    }
+    case WIDGET_LABEL: {
+        label_t *label = (label_t *)w->data;
+        w->bounds = (rect_t){label->x, label->y, (int)strlen(label->text), 1};
+        break;
+    }
+    case WIDGET_CONTAINER:
+        break;
+    }
+}
+
+/**
+ * widget_visible - Check if a node is shown
+ * @w: Node
+ *
+ * Return: true if the wrapped widget is visible
+ */
+static bool widget_visible(widget_t *w) {
+    switch (w->type) {
+    case WIDGET_WINDOW:  return ((window_t *)w->data)->visible;
+    case WIDGET_BUTTON:  return ((button_t *)w->data)->visible;
+    case WIDGET_TEXTBOX: return ((textbox_t *)w->data)->visible;
+    case WIDGET_LABEL:   return ((label_t *)w->data)->visible;
+    default:             return true;
+    }
+}
+
+/**
+ * widget_opaque - Check if a node covers its whole layout rectangle
+ * @w: Node
+ *
+ * Return: true if painting the node fully overwrites its bounds
+ */
+static bool widget_opaque(widget_t *w) {
+    if (!widget_visible(w)) return false;
+    return w->type == WIDGET_WINDOW || w->type == WIDGET_BUTTON ||
+           w->type == WIDGET_TEXTBOX;
+}
+
+/**
+ * widget_paint_self - Draw a node without its children
+ * @w: Node
+ */
+static void widget_paint_self(widget_t *w) {
+    switch (w->type) {
+    case WIDGET_WINDOW:  gui_draw_window((window_t *)w->data); break;
+    case WIDGET_BUTTON:  gui_draw_button((button_t *)w->data); break;
+    case WIDGET_TEXTBOX: gui_draw_textbox((textbox_t *)w->data); break;
+    case WIDGET_LABEL:   gui_draw_label((label_t *)w->data); break;
+    case WIDGET_CONTAINER: break;
+    }
+}
+
+/**
+ * widget_paint_subtree - Draw the part of a subtree inside a rectangle
+ * @w: Subtree root
+ * @area: Area being repainted
+ *
+ * Children are contained in their parent, so a subtree whose bounds
+ * miss the area is skipped as a whole.
+ */
+static void widget_paint_subtree(widget_t *w, const rect_t *area) {
+    rect_t overlap;
+
+    if (!widget_visible(w)) return;
+    if (!gui_rect_intersect(&w->bounds, area, &overlap)) return;
+
+    widget_paint_self(w);
+    w->painted = w->bounds;
+
+    for (widget_t *child = w->first_child; child; child = child->next_sibling) {
+        widget_paint_subtree(child, area);
+    }
+}
+
+/**
+ * widget_repaint_damage - Redraw the area affected by an invalid widget
+ * @w: Invalid widget
+ *
+ * The damaged area covers both where the widget was last drawn and
+ * where it is now. If the widget does not fill that area itself, the
+ * nearest opaque ancestor is repainted inside it to restore the
+ * background, together with any siblings that overlap it.
+ */
+static void widget_repaint_damage(widget_t *w) {
+    rect_t damage;
+    rect_t clip;
+    rect_t area;
+
+    rect_union(&w->painted, &w->bounds, &damage);
+
+    widget_t *anchor = w;
+    if (!widget_opaque(w) ||
+        w->painted.x != w->bounds.x || w->painted.y != w->bounds.y ||
+        w->painted.width != w->bounds.width || w->painted.height != w->bounds.height) {
+        while (anchor->parent) {
+            anchor = anchor->parent;
+            if (widget_opaque(anchor)) break;
+        }
+    }
+
+    vga_get_clip(&clip.x, &clip.y, &clip.width, &clip.height);
+    if (!gui_rect_intersect(&damage, &clip, &area)) return;
+
+    vga_set_clip(area.x, area.y, area.width, area.height);
+    widget_paint_subtree(anchor, &area);
+    vga_set_clip(clip.x, clip.y, clip.width, clip.height);
+}
+
+/**
+ * gui_widget_init - Initialize a widget tree node
+ * @w: Node to initialize
+ * @type: Widget kind
+ * @data: Wrapped widget structure (NULL for containers)
+ */
+void gui_widget_init(widget_t *w, widget_type_t type, void *data) {
+    w->type = type;
+    w->data = data;
+    w->bounds = (rect_t){0, 0, 0, 0};
+    w->painted = (rect_t){0, 0, 0, 0};
+    w->parent = NULL;
+    w->first_child = NULL;
+    w->last_child = NULL;
+    w->next_sibling = NULL;
+    w->dirty = true;
+    w->child_dirty = false;
+    widget_sync_bounds(w);
+}
+
+/**
+ * gui_widget_set_bounds - Set the layout rectangle of a node
+ * @w: Node
+ * @x, y: Top-left corner
+ * @width, height: Dimensions
+ */
+void gui_widget_set_bounds(widget_t *w, int x, int y, int width, int height) {
+    w->bounds = (rect_t){x, y, width, height};
+}
+
+/**
+ * gui_widget_add_child - Append a child on top of its siblings
+ * @parent: Parent node
+ * @child: Child node
+ */
+void gui_widget_add_child(widget_t *parent, widget_t *child) {
+    child->parent = parent;
+    child->next_sibling = NULL;
+
+    if (parent->last_child) {
+        parent->last_child->next_sibling = child;
+    } else {
+        parent->first_child = child;
+    }
+    parent->last_child = child;
+
+    gui_widget_invalidate(child);
+}
+
+/**
+ * gui_widget_invalidate - Mark a widget as needing a repaint
+ * @w: Widget whose state changed
+ */
+void gui_widget_invalidate(widget_t *w) {
+    w->dirty = true;
+
+    // Flag the path from the root so clean subtrees can be skipped
+    for (widget_t *p = w->parent; p && !p->child_dirty; p = p->parent) {
+        p->child_dirty = true;
+    }
+}
+
+/**
+ * gui_widget_is_invalid - Check if a tree has anything to repaint
+ * @root: Tree root
+ *
+ * Return: true if the root or any descendant is invalid
+ */
+bool gui_widget_is_invalid(widget_t *root) {
+    return root->dirty || root->child_dirty;
+}
+
+/**
+ * gui_layout - Refresh the layout rectangles of invalid widgets
+ * @root: Tree root
+ */
+void gui_layout(widget_t *root) {
+    if (root->dirty) {
+        widget_sync_bounds(root);
+    } else if (!root->child_dirty) {
+        return;
+    }
+
+    for (widget_t *child = root->first_child; child; child = child->next_sibling) {
+        gui_layout(child);
+    }
+}
+
+/**
+ * gui_widget_paint - Paint a whole tree inside the current clip
+ * @root: Tree root
+ */
+void gui_widget_paint(widget_t *root) {
+    rect_t clip;
+
+    vga_get_clip(&clip.x, &clip.y, &clip.width, &clip.height);
+    widget_paint_subtree(root, &clip);
+}
+
+/**
+ * gui_render - Repaint only the invalid parts of a tree
+ * @root: Tree root
+ */
+void gui_render(widget_t *root) {
+    if (root->dirty) {
+        widget_repaint_damage(root);
+        return;
+    }
+    if (!root->child_dirty) return;
+
+    for (widget_t *child = root->first_child; child; child = child->next_sibling) {
+        gui_render(child);
+    }
+}
+
+/**
+ * gui_validate - Clear the invalid flags of a tree
+ * @root: Tree root
+ */
+void gui_validate(widget_t *root) {
+    if (!root->dirty && !root->child_dirty) return;
+
+    root->dirty = false;
+    root->child_dirty = false;
+    for (widget_t *child = root->first_child; child; child = child->next_sibling) {
+        gui_validate(child);
+    }
+}
+
+/**
+ * gui_widget_at - Find the topmost widget at a point
+ * @root: Tree root
+ * @x: X coordinate
+ * @y: Y coordinate
+ *
+ * Return: Deepest visible widget under the point, NULL if none
+ */
+widget_t *gui_widget_at(widget_t *root, int x, int y) {
+    if (!widget_visible(root)) return NULL;
+    if (x < root->bounds.x || x >= root->bounds.x + root->bounds.width ||
+        y < root->bounds.y || y >= root->bounds.y + root->bounds.height) {
+        return NULL;
+    }
+
+    // Later siblings are drawn on top, so the last match wins
+    widget_t *hit = NULL;
+    for (widget_t *child = root->first_child; child; child = child->next_sibling) {
+        widget_t *found = gui_widget_at(child, x, y);
+        if (found) hit = found;
+    }
+
+    return hit ? hit : root;
+}
+
+/**
+ * gui_widget_click - Deliver a click to the widget under a point
+ * @root: Tree root
+ * @x: X coordinate
+ * @y: Y coordinate
+ *
+ * Return: Widget that was hit, NULL if none
+ */
+widget_t *gui_widget_click(widget_t *root, int x, int y) {
+    widget_t *hit = gui_widget_at(root, x, y);
+
+    if (hit && hit->type == WIDGET_BUTTON) {
+        button_t *btn = (button_t *)hit->data;
+        if (btn->on_click) btn->on_click();
+    }
+    return hit;
+}
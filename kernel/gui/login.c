@@ -5,6 +5,8 @@
 
 #include "../../include/login.h"
 #include "../../include/gui.h"
+#include "../../include/wm.h"
+#include "../../include/frame.h"
 #include "../../include/vga.h"
 #include "../../include/font.h"
 #include "../../include/memory.h"
@@ -28,13 +30,26 @@ static textbox_t username_box;
 static textbox_t password_box;
 static button_t login_button;
 
+// Widget tree for the login window
+static widget_t login_root;
+static widget_t title_node;
+static widget_t username_label_node;
+static widget_t username_box_node;
+static widget_t password_label_node;
+static widget_t password_box_node;
+static widget_t login_button_node;
+static widget_t error_label_node;
+
 // Current focused textbox
 static textbox_t *focused_box = NULL;
+static widget_t *focused_node = NULL;
+
+static void login_paint_background(void);
 
 /**
  * login_init - Initialize login screen
  */
-void login_init(void) {
+__cold void login_init(void) {
     // Initialize GUI
     gui_init();
     
@@ -46,6 +61,8 @@ void login_init(void) {
     strcpy(login_window.title, "SimpleOS Login");
     login_window.visible = true;
     login_window.active = true;
+    login_window.root = &login_root;
+    login_window.on_paint = NULL;
 
     // Setup title label
     title_label.x = 20;
@@ -109,29 +126,53 @@ void login_init(void) {
     strcpy(error_label.text, "");
     error_label.color = VGA_COLOR_RED;
     error_label.visible = false;
+
+    // Build the widget tree, children in drawing order
+    gui_widget_init(&login_root, WIDGET_WINDOW, &login_window);
+    gui_widget_init(&title_node, WIDGET_LABEL, &title_label);
+    gui_widget_init(&username_label_node, WIDGET_LABEL, &username_label);
+    gui_widget_init(&username_box_node, WIDGET_TEXTBOX, &username_box);
+    gui_widget_init(&password_label_node, WIDGET_LABEL, &password_label);
+    gui_widget_init(&password_box_node, WIDGET_TEXTBOX, &password_box);
+    gui_widget_init(&login_button_node, WIDGET_BUTTON, &login_button);
+    gui_widget_init(&error_label_node, WIDGET_LABEL, &error_label);
+
+    gui_widget_add_child(&login_root, &title_node);
+    gui_widget_add_child(&login_root, &username_label_node);
+    gui_widget_add_child(&login_root, &username_box_node);
+    gui_widget_add_child(&login_root, &password_label_node);
+    gui_widget_add_child(&login_root, &password_box_node);
+    gui_widget_add_child(&login_root, &login_button_node);
+    gui_widget_add_child(&login_root, &error_label_node);
+    focused_node = &username_box_node;
+
+    // The login window is the only managed window
+    wm_init(login_paint_background);
+    wm_add_window(&login_window);
+    frame_init();
 }
 
 /**
  * login_draw - Draw the login screen
+ *
+ * The whole screen is drawn as one frame.
  */
 void login_draw(void) {
-    // Clear screen
-    vga_clear_screen(VGA_COLOR_BLUE);
+    wm_invalidate_all();
+    frame_pump();
+}
 
-    // Draw all GUI elements
-    gui_draw_window(&login_window);
-    gui_draw_label(&title_label);
-    gui_draw_label(&username_label);
-    gui_draw_textbox(&username_box);
-    gui_draw_label(&password_label);
-    gui_draw_textbox(&password_box);
-    gui_draw_button(&login_button);
-    gui_draw_label(&error_label);
+/**
+ * login_paint_background - Draw the screen behind the login window
+ */
+static void login_paint_background(void) {
+    vga_clear_screen(VGA_COLOR_BLUE);
 
     // Draw hint at bottom
     font_draw_string("Hint: admin/password", 20, 22, VGA_COLOR_LIGHT_GRAY, VGA_COLOR_BLUE);
 }
 
+
 /**
  * login_handle_key - Handle keyboard input
  * @c: Character pressed
@@ -149,11 +190,15 @@ void login_handle_key(char c) {
             username_box.focused = false;
             password_box.focused = true;
             focused_box = &password_box;
+            focused_node = &password_box_node;
         } else {
             password_box.focused = false;
             username_box.focused = true;
             focused_box = &username_box;
+            focused_node = &username_box_node;
         }
+        gui_widget_invalidate(&username_box_node);
+        gui_widget_invalidate(&password_box_node);
     } else if (c == '\n') {
         // Enter: Attempt login
         login_attempt();
@@ -161,16 +206,19 @@ void login_handle_key(char c) {
         // Backspace
         if (focused_box) {
             gui_textbox_backspace(focused_box);
+            gui_widget_invalidate(focused_node);
         }
     } else if (c >= 32 && c <= 126) {
         // Regular character
         if (focused_box) {
             gui_textbox_add_char(focused_box, c);
+            gui_widget_invalidate(focused_node);
         }
     }
-    
-    // Redraw screen
-    login_draw();
+
+    // Nothing pumps frames from an idle loop yet, present the change now;
+    // the frame repaints only the widgets that changed
+    frame_pump();
 }
 
 /**
@@ -191,6 +239,9 @@ void login_attempt(void) {
         // Clear password
         password_box.text[0] = '\0';
         password_box.text_len = 0;
+
+        gui_widget_invalidate(&error_label_node);
+        gui_widget_invalidate(&password_box_node);
     }
 }
 
@@ -0,0 +1,398 @@
+/**
+ * wm.c - Window manager
+ * Keeps a z-ordered window stack and clips every repaint to the part
+ * of each window that is actually visible
+ */
+
+#include "../../include/wm.h"
+#include "../../include/gui.h"
+#include "../../include/vga.h"
+
+// Maximum number of rectangles describing one visible region
+#define WM_MAX_RECTS 32
+
+// Visible region: a set of non-overlapping rectangles
+typedef struct {
+    rect_t rects[WM_MAX_RECTS];
+    int count;
+    bool approximate; // Ran out of rectangles, may include covered area
+} region_t;
+
+// Window stack, index 0 is the bottom window
+static window_t *stack[WM_MAX_WINDOWS];
+static int window_count = 0;
+
+// Desktop painter drawn below all windows
+static void (*background_painter)(void) = NULL;
+
+// Set when everything must be repainted on the next render
+static bool full_repaint = true;
+
+/**
+ * window_rect - Get the screen rectangle covered by a window
+ * @win: Window
+ * @out: Receives the rectangle
+ */
+static void window_rect(const window_t *win, rect_t *out) {
+    out->x = win->x;
+    out->y = win->y;
+    out->width = win->width;
+    out->height = win->height;
+}
+
+/**
+ * region_init - Start a region from one rectangle clipped to the screen
+ * @region: Region to initialize
+ * @r: Starting rectangle
+ */
+static void region_init(region_t *region, const rect_t *r) {
+    rect_t screen = {0, 0, VGA_WIDTH, VGA_HEIGHT};
+
+    region->count = 0;
+    region->approximate = false;
+    if (gui_rect_intersect(r, &screen, &region->rects[0])) {
+        region->count = 1;
+    }
+}
+
+/**
+ * region_subtract - Remove a rectangle from a region
+ * @region: Region to modify
+ * @hole: Rectangle to cut out
+ *
+ * Every overlapped rectangle is split into up to four pieces around
+ * the hole. If the region runs out of slots the rectangle is kept
+ * whole and the region is marked approximate.
+ */
+static void region_subtract(region_t *region, const rect_t *hole) {
+    region_t result;
+    result.count = 0;
+    result.approximate = region->approximate;
+
+    for (int i = 0; i < region->count; i++) {
+        const rect_t *r = &region->rects[i];
+        rect_t in;
+
+        if (!gui_rect_intersect(r, hole, &in)) {
+            result.rects[result.count++] = *r;
+            continue;
+        }
+
+        rect_t pieces[4];
+        int n = 0;
+
+        // Full-width bands above and below the hole
+        if (in.y > r->y) {
+            pieces[n++] = (rect_t){r->x, r->y, r->width, in.y - r->y};
+        }
+        if (in.y + in.height < r->y + r->height) {
+            pieces[n++] = (rect_t){r->x, in.y + in.height, r->width,
+                                   r->y + r->height - (in.y + in.height)};
+        }
+
+        // Pieces left and right of the hole within its rows
+        if (in.x > r->x) {
+            pieces[n++] = (rect_t){r->x, in.y, in.x - r->x, in.height};
+        }
+        if (in.x + in.width < r->x + r->width) {
+            pieces[n++] = (rect_t){in.x + in.width, in.y,
+                                   r->x + r->width - (in.x + in.width), in.height};
+        }
+
+        // Each input rectangle yields at most one output slot when full,
+        // so the remaining inputs always still fit
+        if (result.count + n > WM_MAX_RECTS - (region->count - i - 1)) {
+            result.rects[result.count++] = *r;
+            result.approximate = true;
+            continue;
+        }
+
+        for (int j = 0; j < n; j++) {
+            result.rects[result.count++] = pieces[j];
+        }
+    }
+
+    *region = result;
+}
+
+/**
+ * wm_find - Find a window's position in the stack
+ * @win: Window to look for
+ *
+ * Return: Stack index, -1 if not managed
+ */
+static int wm_find(window_t *win) {
+    for (int i = 0; i < window_count; i++) {
+        if (stack[i] == win) return i;
+    }
+    return -1;
+}
+
+/**
+ * wm_visible_region - Compute the uncovered part of a stack layer
+ * @index: Stack index, or -1 for the desktop background
+ * @region: Receives the visible region
+ */
+static void wm_visible_region(int index, region_t *region) {
+    rect_t r;
+
+    if (index < 0) {
+        r = (rect_t){0, 0, VGA_WIDTH, VGA_HEIGHT};
+    } else {
+        window_rect(stack[index], &r);
+    }
+    region_init(region, &r);
+
+    for (int i = index + 1; i < window_count && region->count > 0; i++) {
+        if (!stack[i]->visible) continue;
+
+        rect_t above;
+        window_rect(stack[i], &above);
+        region_subtract(region, &above);
+    }
+}
+
+/**
+ * wm_paint_layer - Paint one stack layer clipped to its visible region
+ * @index: Stack index, or -1 for the desktop background
+ *
+ * Return: true if the region was exact, false if it may have
+ *         painted over windows above this layer
+ */
+static bool wm_paint_layer(int index) {
+    region_t region;
+
+    if (index >= 0 && !stack[index]->visible) return true;
+
+    wm_visible_region(index, &region);
+
+    // A fully covered or off-screen layer has no rectangles to draw
+    for (int i = 0; i < region.count; i++) {
+        const rect_t *r = &region.rects[i];
+        vga_set_clip(r->x, r->y, r->width, r->height);
+
+        if (index < 0) {
+            if (background_painter) background_painter();
+        } else {
+            window_t *win = stack[index];
+            if (win->root) {
+                gui_widget_paint(win->root);
+            } else {
+                gui_draw_window(win);
+            }
+            if (win->on_paint) win->on_paint(win);
+        }
+    }
+    vga_reset_clip();
+
+    if (index >= 0 && stack[index]->root) {
+        gui_validate(stack[index]->root);
+    }
+    return !region.approximate;
+}
+
+/**
+ * wm_render_layer - Repaint the invalid widgets of one window
+ * @index: Stack index
+ *
+ * Return: true if the region was exact, false if it may have
+ *         painted over windows above this layer
+ */
+static bool wm_render_layer(int index) {
+    window_t *win = stack[index];
+    region_t region;
+
+    if (!win->visible || !win->root || !gui_widget_is_invalid(win->root)) return true;
+
+    wm_visible_region(index, &region);
+
+    // Flags stay set until every visible rectangle has been rendered
+    for (int i = 0; i < region.count; i++) {
+        const rect_t *r = &region.rects[i];
+        vga_set_clip(r->x, r->y, r->width, r->height);
+        gui_render(win->root);
+    }
+    vga_reset_clip();
+    gui_validate(win->root);
+
+    return !region.approximate;
+}
+
+/**
+ * wm_init - Reset the window stack
+ * @paint_background: Draws the desktop behind all windows
+ */
+__cold void wm_init(void (*paint_background)(void)) {
+    window_count = 0;
+    background_painter = paint_background;
+    full_repaint = true;
+}
+
+/**
+ * wm_add_window - Add a window on top of the stack
+ * @win: Window to add
+ *
+ * Return: 0 on success, -1 if the stack is full
+ */
+int wm_add_window(window_t *win) {
+    if (wm_find(win) != -1) {
+        wm_raise(win);
+        return 0;
+    }
+    if (window_count >= WM_MAX_WINDOWS) return -1;
+
+    stack[window_count++] = win;
+    return 0;
+}
+
+/**
+ * wm_remove_window - Remove a window from the stack
+ * @win: Window to remove
+ */
+void wm_remove_window(window_t *win) {
+    int index = wm_find(win);
+    if (index == -1) return;
+
+    for (int i = index; i < window_count - 1; i++) {
+        stack[i] = stack[i + 1];
+    }
+    window_count--;
+}
+
+/**
+ * wm_raise - Move a window to the top of the stack
+ * @win: Window to raise
+ */
+void wm_raise(window_t *win) {
+    int index = wm_find(win);
+    if (index == -1) return;
+
+    for (int i = index; i < window_count - 1; i++) {
+        stack[i] = stack[i + 1];
+    }
+    stack[window_count - 1] = win;
+}
+
+/**
+ * wm_window_at - Find the topmost visible window at a point
+ * @x: X coordinate
+ * @y: Y coordinate
+ *
+ * Return: Window under the point, NULL for the desktop
+ */
+window_t *wm_window_at(int x, int y) {
+    for (int i = window_count - 1; i >= 0; i--) {
+        window_t *win = stack[i];
+        if (win->visible &&
+            x >= win->x && x < win->x + win->width &&
+            y >= win->y && y < win->y + win->height) {
+            return win;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * wm_repaint - Repaint the desktop and all windows, bottom to top
+ */
+void wm_repaint(void) {
+    for (int i = -1; i < window_count; i++) {
+        wm_paint_layer(i);
+    }
+    full_repaint = false;
+}
+
+/**
+ * wm_invalidate_all - Request a full repaint on the next render
+ */
+void wm_invalidate_all(void) {
+    full_repaint = true;
+}
+
+/**
+ * wm_invalidate_window - Request a repaint of a whole window
+ * @win: Window to repaint
+ */
+void wm_invalidate_window(window_t *win) {
+    if (win->root) {
+        gui_widget_invalidate(win->root);
+    } else {
+        full_repaint = true;
+    }
+}
+
+/**
+ * wm_needs_render - Check if anything is waiting to be repainted
+ *
+ * Return: true if a render would draw something
+ */
+bool wm_needs_render(void) {
+    if (full_repaint) return true;
+
+    for (int i = 0; i < window_count; i++) {
+        window_t *win = stack[i];
+        if (win->visible && win->root && gui_widget_is_invalid(win->root)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * wm_layout - Refresh widget layout in all windows
+ */
+void wm_layout(void) {
+    for (int i = 0; i < window_count; i++) {
+        if (stack[i]->root) gui_layout(stack[i]->root);
+    }
+}
+
+/**
+ * wm_render - Repaint invalid widgets in all windows
+ */
+void wm_render(void) {
+    if (full_repaint) {
+        wm_repaint();
+        return;
+    }
+
+    for (int i = 0; i < window_count; i++) {
+        if (wm_render_layer(i)) continue;
+
+        // The region was approximate, restore the windows above it
+        for (int j = i + 1; j < window_count; j++) {
+            wm_paint_layer(j);
+        }
+        return;
+    }
+}
+
+/**
+ * wm_widget_at - Find the topmost widget at a point
+ * @x: X coordinate
+ * @y: Y coordinate
+ *
+ * Return: Widget under the point, NULL if none
+ */
+widget_t *wm_widget_at(int x, int y) {
+    window_t *win = wm_window_at(x, y);
+
+    if (!win || !win->root) return NULL;
+    return gui_widget_at(win->root, x, y);
+}
+
+/**
+ * wm_repaint_window - Repaint the visible part of one window
+ * @win: Window to repaint
+ */
+void wm_repaint_window(window_t *win) {
+    int index = wm_find(win);
+    if (index == -1) return;
+
+    if (wm_paint_layer(index)) return;
+
+    // The region was approximate, restore the windows above it
+    for (int i = index + 1; i < window_count; i++) {
+        wm_paint_layer(i);
+    }
+}
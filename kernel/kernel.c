@@ -9,20 +9,53 @@
 #include "../include/idt.h"
 #include "../include/isr.h"
 #include "../include/keyboard.h"
+#include "../include/timer.h"
+#include "../include/memory.h"
 #include "../include/shell.h"
+#include "../include/filesystem.h"
+#include "../include/vfs.h"
+#include "../include/ata.h"
+#include "../include/virtio_blk.h"
+#include "../include/bcache.h"
+#include "../include/blockdev.h"
+#include "../include/sfs.h"
+#include "../include/crc32c.h"
+#include "../include/initrd.h"
+#include "../include/multiboot.h"
+#include "../include/boottrace.h"
+#include "../include/serial.h"
 
 /**
  * kernel_main - Main kernel entry point
+ * @magic: MULTIBOOT_BOOTLOADER_MAGIC if a multiboot loader started the kernel
+ * @info: Multiboot information in that case
  *
  * This function is called by kernel_entry.asm after the bootloader
  * has loaded the kernel and switched to protected mode.
  */
-void kernel_main(void) {
+void kernel_main(uint32_t magic, const multiboot_info_t *info) {
+    // Each boot_trace() below ends the phase since the previous one
+    boot_trace_init(magic);
+
+    // The loader's information lies where the heap goes, take it first
+    multiboot_init(magic, info);
+    boot_trace("multiboot");
+
     // Initialize system components
+    heap_init(boot_memory_end());
+    boot_trace("heap");
     gdt_init();
+    boot_trace("gdt");
     idt_init();
+    boot_trace("idt");
     isr_init();
+    boot_trace("isr");
+    timer_init(TIMER_HZ);
+    boot_trace("timer");
     keyboard_init();
+    boot_trace("keyboard");
+    serial_init();
+    boot_trace("serial");
 
     // Text Mode: Traditional shell
     keyboard_set_mode(KEYBOARD_MODE_SHELL);
@@ -30,9 +63,63 @@ void kernel_main(void) {
     print("SimpleOS Kernel Loaded Successfully\n");
     print("Version 0.2.0 - Educational Operating System\n");
     print("Copyright (c) 2026 Jyot Bhavsar\n\n");
+    if (boot_cmdline()[0]) {
+        print("Command line: ");
+        print(boot_cmdline());
+        print("\n\n");
+    }
+    boot_trace("console");
+
+    print("Detecting disks...\n");
+    ata_init();
+    boot_trace("ata");
+    virtio_blk_init();
+    boot_trace("virtio-blk");
+    bcache_init();
+    boot_trace("bcache");
+
+    print("Initializing file system...\n");
+    crc32c_init();
+    print(crc32c_hw() ? "  CRC32C: SSE4.2\n" : "  CRC32C: slicing-by-8\n");
+    boot_trace("crc32c");
+    fs_init();
+    vfs_init();
+    vfs_mount("/", &ramfs_ops, NULL);
+    boot_trace("vfs");
+
+    // Files packed into the OS image by the build
+    int initrd = initrd_load();
+    if (initrd > 0) {
+        print("  initrd: ");
+        print_int(initrd);
+        print(" entries\n");
+    } else if (initrd < 0) {
+        print("  initrd: corrupt, ignored\n");
+    }
+    boot_trace("initrd");
+
+    // Mount the first disk holding an sfs volume at /disk, or the one
+    // named by disk= on the command line
+    char disk[BLOCKDEV_NAME_MAX];
+    bool named = boot_param("disk", disk, sizeof(disk)) == 0;
+    for (int i = 0; blockdev_at(i); i++) {
+        if (named && strcmp(blockdev_at(i)->name, disk) != 0) continue;
+        void *volume = sfs_mount(blockdev_at(i));
+        if (volume && vfs_mkdir("/disk") == 0 && vfs_mount("/disk", &sfs_ops, volume) == 0) {
+            print("  Mounted ");
+            print(blockdev_at(i)->name);
+            print(" at /disk\n");
+            break;
+        }
+    }
+    boot_trace("mount");
 
     print("Initializing shell...\n");
     shell_init();
+    boot_trace("shell");
+
+    // The same table as the bootstat command, for a log of every boot
+    boot_trace_report(serial_write);
 
     print("\nKernel initialized in 32-bit protected mode\n");
     print("All systems operational.\n\n");
@@ -43,6 +130,9 @@ void kernel_main(void) {
     while(1) {
         // Halt CPU until next interrupt
         __asm__ __volatile__("hlt");
+
+        // Every timer tick wakes the loop; commit and flush when due
+        vfs_writeback();
     }
 }
 
@@ -4,8 +4,50 @@
 
 [bits 32]                       ; We're in 32-bit protected mode
 [extern kernel_main]            ; Declare external C function
+[extern _edata]                 ; End of the loaded image, from the linker
+[extern _bss_start]             ; Start of .bss
+[extern _end]                   ; End of .bss
+[global kernel_start]
+
+MULTIBOOT_MAGIC equ 0x1BADB002
+MULTIBOOT_FLAGS equ 0x00000003  ; Page-aligned modules, memory information
+KERNEL_STACK    equ 0x90000     ; A multiboot loader leaves no usable stack
+
+; Placed first in the image by kernel/linker.ld
+section .entry progbits alloc exec nowrite
+
+kernel_start:
+jmp short kernel_entry          ; The boot sector path jumps to the first byte
+
+; Multiboot header, also read by boot/boot.asm from the kernel's first
+; sector. The address fields have the a.out kludge layout; the flag that
+; enables them stays clear, so multiboot loaders use the ELF headers.
+align 4
+multiboot_header:
+    dd MULTIBOOT_MAGIC
+    dd MULTIBOOT_FLAGS
+    dd -(MULTIBOOT_MAGIC + MULTIBOOT_FLAGS)
+    dd multiboot_header         ; Header address
+    dd kernel_start             ; Load address
+    dd _edata                   ; End of the image, so the size need not be built in
+    dd _end                     ; End of .bss
+    dd kernel_start             ; Entry address
+
+kernel_entry:
+mov esp, KERNEL_STACK
+push ebx                        ; Multiboot information
+push eax                        ; MULTIBOOT_BOOTLOADER_MAGIC from a multiboot loader
+
+; The boot sector loads the image only up to _edata, so clear .bss here
+; rather than trust whatever memory held before
+mov edi, _bss_start
+mov ecx, _end
+sub ecx, edi
+shr ecx, 2                      ; _end is double-word aligned
+xor eax, eax
+cld
+rep stosd
 
 call kernel_main                ; Call C kernel main function
 
 jmp $                           ; Hang if kernel returns
-
@@ -0,0 +1,160 @@
+/**
+ * crc32c.c - CRC32C (Castagnoli) checksums
+ * SSE4.2 crc32 instruction with a slicing-by-8 table fallback
+ */
+
+#include "../../include/crc32c.h"
+
+// Reflected Castagnoli polynomial
+#define CRC32C_POLY 0x82F63B78
+
+// CPUID leaf 1, ECX
+#define CPUID_ECX_SSE42 (1 << 20)
+
+// EFLAGS.ID can only be toggled on CPUs that have CPUID
+#define EFLAGS_ID (1 << 21)
+
+// crc_table[k][b]: checksum of byte b followed by k zero bytes
+static uint32_t crc_table[8][256];
+
+static bool use_hw = false;
+
+/**
+ * crc32c_has_sse42 - Ask CPUID whether the crc32 instruction exists
+ *
+ * Return: true if SSE4.2 is supported
+ */
+static bool crc32c_has_sse42(void) {
+    uint32_t before, after;
+
+    __asm__ __volatile__(
+        "pushf\n\t"
+        "pop %0\n\t"
+        "mov %0, %1\n\t"
+        "xor %2, %1\n\t"
+        "push %1\n\t"
+        "popf\n\t"
+        "pushf\n\t"
+        "pop %1\n\t"
+        "push %0\n\t"
+        "popf"
+        : "=&r" (before), "=&r" (after)
+        : "i" (EFLAGS_ID)
+        : "cc");
+    if (!((before ^ after) & EFLAGS_ID)) return false;
+
+    uint32_t eax = 1, ebx, ecx, edx;
+    __asm__ __volatile__("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+    return (ecx & CPUID_ECX_SSE42) != 0;
+}
+
+/**
+ * crc32c_init - Pick the implementation and build the lookup tables
+ */
+__cold void crc32c_init(void) {
+    for (uint32_t b = 0; b < 256; b++) {
+        uint32_t crc = b;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = crc & 1 ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+        }
+        crc_table[0][b] = crc;
+    }
+    for (uint32_t b = 0; b < 256; b++) {
+        for (int k = 1; k < 8; k++) {
+            uint32_t prev = crc_table[k - 1][b];
+            crc_table[k][b] = (prev >> 8) ^ crc_table[0][prev & 0xFF];
+        }
+    }
+
+    use_hw = crc32c_has_sse42();
+}
+
+/**
+ * crc32c_hw - Check whether checksums use the SSE4.2 instruction
+ *
+ * Return: true if CPUID reported SSE4.2
+ */
+bool crc32c_hw(void) {
+    return use_hw;
+}
+
+/**
+ * crc32c_sw - Update a raw checksum with slicing-by-8
+ * @crc: Running checksum, not inverted
+ * @p: Data
+ * @len: Length in bytes
+ *
+ * Eight bytes are folded in per step with eight independent table
+ * lookups instead of eight dependent ones.
+ *
+ * Return: Updated checksum
+ */
+static uint32_t crc32c_sw(uint32_t crc, const uint8_t *p, uint32_t len) {
+    // Single bytes up to a 4-byte boundary so the words can be loaded aligned
+    while (len && ((uint32_t)p & 3)) {
+        crc = (crc >> 8) ^ crc_table[0][(crc ^ *p++) & 0xFF];
+        len--;
+    }
+
+    while (len >= 8) {
+        uint32_t one = ((const uint32_t *)p)[0] ^ crc;
+        uint32_t two = ((const uint32_t *)p)[1];
+        crc = crc_table[7][one & 0xFF] ^
+              crc_table[6][(one >> 8) & 0xFF] ^
+              crc_table[5][(one >> 16) & 0xFF] ^
+              crc_table[4][one >> 24] ^
+              crc_table[3][two & 0xFF] ^
+              crc_table[2][(two >> 8) & 0xFF] ^
+              crc_table[1][(two >> 16) & 0xFF] ^
+              crc_table[0][two >> 24];
+        p += 8;
+        len -= 8;
+    }
+
+    while (len--) {
+        crc = (crc >> 8) ^ crc_table[0][(crc ^ *p++) & 0xFF];
+    }
+    return crc;
+}
+
+/**
+ * crc32c_sse42 - Update a raw checksum with the crc32 instruction
+ * @crc: Running checksum, not inverted
+ * @p: Data
+ * @len: Length in bytes
+ *
+ * Return: Updated checksum
+ */
+static uint32_t crc32c_sse42(uint32_t crc, const uint8_t *p, uint32_t len) {
+    while (len && ((uint32_t)p & 3)) {
+        __asm__("crc32b %1, %0" : "+r" (crc) : "qm" (*p));
+        p++;
+        len--;
+    }
+
+    while (len >= 4) {
+        __asm__("crc32l %1, %0" : "+r" (crc) : "rm" (*(const uint32_t *)p));
+        p += 4;
+        len -= 4;
+    }
+
+    while (len--) {
+        __asm__("crc32b %1, %0" : "+r" (crc) : "qm" (*p));
+        p++;
+    }
+    return crc;
+}
+
+/**
+ * crc32c - Checksum a buffer
+ * @crc: Checksum of the preceding data, 0 to start
+ * @data: Data
+ * @len: Length in bytes
+ *
+ * Return: CRC32C of everything checksummed so far
+ */
+uint32_t crc32c(uint32_t crc, const void *data, uint32_t len) {
+    crc = ~crc;
+    crc = use_hw ? crc32c_sse42(crc, data, len) : crc32c_sw(crc, data, len);
+    return ~crc;
+}
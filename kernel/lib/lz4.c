@@ -0,0 +1,221 @@
+/**
+ * lz4.c - LZ4 block compression
+ * Greedy single-pass compressor and bounds-checked decoder
+ *
+ * A block is a series of sequences: a token byte (literal length in the
+ * high nibble, match length - 4 in the low nibble, 15 meaning "more
+ * length bytes follow"), the literals, then a 16-bit little-endian match
+ * offset. The last sequence holds only literals.
+ */
+
+#include "../../include/lz4.h"
+#include "../../include/memory.h"
+
+#define LZ4_MIN_MATCH 4
+
+// The last match must start this far from the end, the last 5 bytes are literals
+#define LZ4_MF_LIMIT 12
+#define LZ4_LAST_LITERALS 5
+
+#define LZ4_HASH_BITS 12
+
+// Position + 1 of the last occurrence of each hashed 4-byte sequence
+static uint16_t lz4_table[1 << LZ4_HASH_BITS];
+
+/**
+ * lz4_read32 - Load 4 bytes, little-endian
+ * @p: Source, any alignment
+ *
+ * Return: Value
+ */
+static uint32_t lz4_read32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * lz4_hash - Hash a 4-byte sequence into the match table
+ * @seq: Sequence
+ *
+ * Return: Table index
+ */
+static uint32_t lz4_hash(uint32_t seq) {
+    return (seq * 2654435761u) >> (32 - LZ4_HASH_BITS);
+}
+
+/**
+ * lz4_put_length - Write the extension bytes of a length
+ * @op: Output position
+ * @len: Length minus the 15 stored in the token
+ *
+ * Return: Output position after the bytes
+ */
+static uint8_t *lz4_put_length(uint8_t *op, uint32_t len) {
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = len;
+    return op;
+}
+
+/**
+ * lz4_emit - Write one sequence
+ * @op: Output position
+ * @oend: End of the output buffer
+ * @literals: Literal bytes
+ * @lit: Number of literals
+ * @offset: Match offset, 0 for the final literals-only sequence
+ * @match: Match length minus LZ4_MIN_MATCH
+ *
+ * Return: Output position after the sequence, NULL if it does not fit
+ */
+static uint8_t *lz4_emit(uint8_t *op, uint8_t *oend, const uint8_t *literals,
+                         uint32_t lit, uint32_t offset, uint32_t match) {
+    // Token, literal length bytes, literals, offset, match length bytes
+    uint32_t need = 1 + lit / 255 + 1 + lit + (offset ? 2 + match / 255 + 1 : 0);
+    if (need > (uint32_t)(oend - op)) return NULL;
+
+    uint8_t *token = op++;
+    *token = (lit >= 15 ? 15 : lit) << 4;
+    if (lit >= 15) op = lz4_put_length(op, lit - 15);
+    memcpy(op, literals, lit);
+    op += lit;
+
+    if (offset) {
+        *op++ = offset & 0xFF;
+        *op++ = offset >> 8;
+        *token |= match >= 15 ? 15 : match;
+        if (match >= 15) op = lz4_put_length(op, match - 15);
+    }
+    return op;
+}
+
+/**
+ * lz4_compress - Compress a block
+ * @src: Input data
+ * @len: Input length, at most LZ4_MAX_INPUT
+ * @dst: Output buffer
+ * @capacity: Size of @dst
+ *
+ * Return: Compressed length, -1 if the output does not fit
+ */
+int lz4_compress(const void *src, uint32_t len, void *dst, uint32_t capacity) {
+    const uint8_t *in = src;
+    const uint8_t *end = in + len;
+    const uint8_t *anchor = in;
+    uint8_t *op = dst;
+    uint8_t *oend = op + capacity;
+
+    if (len > LZ4_MAX_INPUT) return -1;
+
+    if (len > LZ4_MF_LIMIT) {
+        const uint8_t *ip = in;
+        const uint8_t *mflimit = end - LZ4_MF_LIMIT;
+        const uint8_t *matchlimit = end - LZ4_LAST_LITERALS;
+
+        memset(lz4_table, 0, sizeof(lz4_table));
+
+        while (ip <= mflimit) {
+            uint32_t seq = lz4_read32(ip);
+            uint32_t h = lz4_hash(seq);
+            uint32_t candidate = lz4_table[h];
+            lz4_table[h] = ip - in + 1;
+
+            const uint8_t *ref = in + candidate - 1;
+            if (!candidate || lz4_read32(ref) != seq) {
+                ip++;
+                continue;
+            }
+
+            // Grow the match backwards over pending literals, then forwards
+            while (ip > anchor && ref > in && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+            const uint8_t *p = ip + LZ4_MIN_MATCH;
+            const uint8_t *r = ref + LZ4_MIN_MATCH;
+            while (p < matchlimit && *p == *r) {
+                p++;
+                r++;
+            }
+
+            op = lz4_emit(op, oend, anchor, ip - anchor, ip - ref, p - ip - LZ4_MIN_MATCH);
+            if (!op) return -1;
+            ip = anchor = p;
+        }
+    }
+
+    op = lz4_emit(op, oend, anchor, end - anchor, 0, 0);
+    if (!op) return -1;
+    return op - (uint8_t *)dst;
+}
+
+/**
+ * lz4_get_length - Read the extension bytes of a length
+ * @ip: Input position, advanced past the bytes
+ * @iend: End of the input
+ * @len: Length to add to
+ *
+ * Return: 0 on success, -1 if the input ends first
+ */
+static int lz4_get_length(const uint8_t **ip, const uint8_t *iend, uint32_t *len) {
+    uint8_t b;
+
+    do {
+        if (*ip >= iend) return -1;
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+    return 0;
+}
+
+/**
+ * lz4_decompress - Decompress a block
+ * @src: LZ4 block
+ * @len: Block length
+ * @dst: Output buffer
+ * @capacity: Size of @dst
+ *
+ * Return: Decompressed length, -1 if the block is malformed or too large
+ */
+int lz4_decompress(const void *src, uint32_t len, void *dst, uint32_t capacity) {
+    const uint8_t *ip = src;
+    const uint8_t *iend = ip + len;
+    uint8_t *out = dst;
+    uint8_t *op = out;
+    uint8_t *oend = out + capacity;
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+
+        uint32_t lit = token >> 4;
+        if (lit == 15 && lz4_get_length(&ip, iend, &lit) != 0) return -1;
+        if (lit > (uint32_t)(iend - ip) || lit > (uint32_t)(oend - op)) return -1;
+        memcpy(op, ip, lit);
+        ip += lit;
+        op += lit;
+
+        // The last sequence ends after its literals
+        if (ip == iend) break;
+
+        if (iend - ip < 2) return -1;
+        uint32_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (uint32_t)(op - out)) return -1;
+
+        uint32_t match = token & 15;
+        if (match == 15 && lz4_get_length(&ip, iend, &match) != 0) return -1;
+        match += LZ4_MIN_MATCH;
+        if (match > (uint32_t)(oend - op)) return -1;
+
+        // Overlapping matches repeat the last @offset bytes, copy them in order
+        const uint8_t *ref = op - offset;
+        if (offset >= match) {
+            memcpy(op, ref, match);
+            op += match;
+        } else {
+            while (match--) *op++ = *ref++;
+        }
+    }
+    return op - out;
+}
@@ -5,48 +5,172 @@
 
 #include "../../include/memory.h"
 
-// Simple memory allocator - just keeps track of next free address
-static uint32_t free_mem_addr = 0x10000;  // Start after kernel
+// Block header placed in front of every heap block
+typedef struct heap_block {
+    uint32_t size;              // Block size in bytes, header included
+    struct heap_block *next;    // Next free block, HEAP_MAGIC when allocated
+} heap_block_t;
+
+#define HEAP_HEADER sizeof(heap_block_t)
+#define HEAP_ALIGN 8
+#define HEAP_MIN_BLOCK 16
+#define HEAP_MAGIC ((heap_block_t *)0xC0FFEE00)
+
+// End of the kernel image, .bss included, defined by the linker
+extern char _end[];
+
+// Free blocks sorted by address so neighbours can be merged
+static heap_block_t *free_list = NULL;
+static uint32_t heap_used = 0;
+
+/**
+ * heap_init - Set up the kernel heap
+ * @limit: End of the RAM above 1MB, 0 if unknown
+ *
+ * Turns everything from the first page after the kernel image up to
+ * HEAP_END, or the end of RAM if that comes first, into one free block.
+ * The bootloader has already opened the A20 line to load the kernel at
+ * 1MB.
+ */
+__cold void heap_init(uint32_t limit) {
+    uint32_t start = ((uint32_t)_end + 0xFFF) & ~0xFFF;
+    uint32_t end = HEAP_END;
+    if (limit && limit < end) end = limit;
+
+    free_list = (heap_block_t *)start;
+    free_list->size = end - start;
+    free_list->next = NULL;
+    heap_used = 0;
+}
+
+/**
+ * heap_alloc - First-fit allocation from the free list
+ * @size: Number of bytes to allocate
+ * @align: Alignment of the returned pointer, a power of two
+ *
+ * The block is split so that an unused tail, and any gap in front of
+ * an aligned block, stay on the free list.
+ *
+ * Return: Pointer to allocated memory, NULL if no block is large enough
+ */
+static __hot void *heap_alloc(uint32_t size, uint32_t align) {
+    uint32_t need = ((size + HEAP_ALIGN - 1) & ~(HEAP_ALIGN - 1)) + HEAP_HEADER;
+    if (need < HEAP_MIN_BLOCK) need = HEAP_MIN_BLOCK;
+    if (size == 0 || need < size) return NULL;
+
+    heap_block_t *prev = NULL;
+    for (heap_block_t *b = free_list; b; prev = b, b = b->next) {
+        uint32_t start = (uint32_t)b;
+        uint32_t end = start + b->size;
+
+        // Place the block so its payload is aligned; a gap in front
+        // must be big enough to remain a free block of its own
+        uint32_t payload = (start + HEAP_HEADER + align - 1) & ~(align - 1);
+        uint32_t block = payload - HEAP_HEADER;
+        if (block != start && block - start < HEAP_MIN_BLOCK) {
+            block += align;
+        }
+        if (block + need > end || block + need < block) continue;
+
+        // Split off the tail unless it is too small to be useful
+        heap_block_t *rest = b->next;
+        uint32_t tail = end - (block + need);
+        if (tail >= HEAP_MIN_BLOCK) {
+            heap_block_t *t = (heap_block_t *)(block + need);
+            t->size = tail;
+            t->next = rest;
+            rest = t;
+        } else {
+            need = end - block;
+        }
+
+        if (block != start) {
+            b->size = block - start;
+            b->next = rest;
+        } else if (prev) {
+            prev->next = rest;
+        } else {
+            free_list = rest;
+        }
+
+        heap_block_t *used = (heap_block_t *)block;
+        used->size = need;
+        used->next = HEAP_MAGIC;
+        heap_used += need;
+        return (void *)(block + HEAP_HEADER);
+    }
+
+    return NULL;
+}
 
 /**
  * kmalloc - Allocate kernel memory
  * @size: Number of bytes to allocate
  *
- * Return: Pointer to allocated memory
+ * Return: Pointer to allocated memory, NULL if the heap is exhausted
  */
-void *kmalloc(uint32_t size) {
-    void *addr = (void *)free_mem_addr;
-    free_mem_addr += size;
-    return addr;
+__hot void *kmalloc(uint32_t size) {
+    return heap_alloc(size, HEAP_ALIGN);
 }
 
 /**
  * kmalloc_aligned - Allocate page-aligned kernel memory
  * @size: Number of bytes to allocate
  *
- * Return: Pointer to allocated memory (page-aligned)
+ * Return: Pointer to allocated memory (page-aligned), NULL if the
+ *         heap is exhausted
  */
-void *kmalloc_aligned(uint32_t size) {
-    // Align to 4KB page boundary
-    if (free_mem_addr & 0xFFF) {
-        free_mem_addr &= 0xFFFFF000;
-        free_mem_addr += 0x1000;
-    }
-    void *addr = (void *)free_mem_addr;
-    free_mem_addr += size;
-    return addr;
+__hot void *kmalloc_aligned(uint32_t size) {
+    return heap_alloc(size, 0x1000);
 }
 
 /**
  * kfree - Free kernel memory
  * @ptr: Pointer to memory to free
  *
- * Note: This is a placeholder. A real implementation would
- * maintain a free list and reuse freed memory.
+ * The block is put back in address order and merged with free
+ * neighbours. NULL and pointers not returned by kmalloc are ignored.
+ */
+__hot void kfree(void *ptr) {
+    if (!ptr) return;
+
+    heap_block_t *block = (heap_block_t *)((uint32_t)ptr - HEAP_HEADER);
+    if (block->next != HEAP_MAGIC) return;
+    heap_used -= block->size;
+
+    heap_block_t *prev = NULL;
+    heap_block_t *next = free_list;
+    while (next && next < block) {
+        prev = next;
+        next = next->next;
+    }
+
+    // Merge with the following block
+    if (next && (uint32_t)block + block->size == (uint32_t)next) {
+        block->size += next->size;
+        block->next = next->next;
+    } else {
+        block->next = next;
+    }
+
+    // Merge with the preceding block
+    if (prev && (uint32_t)prev + prev->size == (uint32_t)block) {
+        prev->size += block->size;
+        prev->next = block->next;
+    } else if (prev) {
+        prev->next = block;
+    } else {
+        free_list = block;
+    }
+}
+
+/**
+ * heap_used_bytes - Get the number of bytes currently allocated
+ *
+ * Return: Allocated bytes, block headers included
  */
-void kfree(void *ptr) {
-    // Simple allocator doesn't support freeing
-    // In a real OS, this would add the block to a free list
+uint32_t heap_used_bytes(void) {
+    return heap_used;
 }
 
 /**
@@ -57,7 +181,7 @@ void kfree(void *ptr) {
  *
  * Return: Pointer to destination
  */
-void *memcpy(void *dest, const void *src, uint32_t n) {
+__hot void *memcpy(void *dest, const void *src, uint32_t n) {
     uint8_t *d = (uint8_t *)dest;
     const uint8_t *s = (const uint8_t *)src;
     
@@ -76,7 +200,7 @@ void *memcpy(void *dest, const void *src, uint32_t n) {
  *
  * Return: Pointer to destination
  */
-void *memset(void *dest, uint8_t val, uint32_t n) {
+__hot void *memset(void *dest, uint8_t val, uint32_t n) {
     uint8_t *d = (uint8_t *)dest;
     
     while (n--) {
@@ -92,7 +216,7 @@ void *memset(void *dest, uint8_t val, uint32_t n) {
  *
  * Return: Length of string (excluding null terminator)
  */
-uint32_t strlen(const char *str) {
+__hot uint32_t strlen(const char *str) {
     uint32_t len = 0;
     while (str[len] != '\0') {
         len++;
@@ -107,7 +231,7 @@ uint32_t strlen(const char *str) {
  *
  * Return: 0 if equal, negative if str1 < str2, positive if str1 > str2
  */
-int strcmp(const char *str1, const char *str2) {
+__hot int strcmp(const char *str1, const char *str2) {
     while (*str1 && (*str1 == *str2)) {
         str1++;
         str2++;
@@ -0,0 +1,121 @@
+/**
+ * multiboot.c - Boot information from a multiboot loader
+ * Copies the command line, the memory limit and the initrd module out of
+ * the loader's structures, which sit in memory the heap will reuse
+ */
+
+#include "../include/multiboot.h"
+#include "../include/initrd.h"
+#include "../include/memory.h"
+
+static char cmdline[BOOT_CMDLINE_MAX];
+static uint32_t memory_end;
+
+/**
+ * multiboot_memory - Find where the RAM starting at 1MB ends
+ * @info: Boot information
+ *
+ * Return: Physical address, 0 if unknown
+ */
+static __cold uint32_t multiboot_memory(const multiboot_info_t *info) {
+    if (info->flags & MULTIBOOT_INFO_MMAP) {
+        uint32_t offset = 0;
+        while (offset + sizeof(multiboot_mmap_t) <= info->mmap_length) {
+            const multiboot_mmap_t *entry = (const multiboot_mmap_t *)(info->mmap_addr + offset);
+            uint64_t end = entry->addr + entry->len;
+
+            if (entry->type == MULTIBOOT_MEMORY_AVAILABLE &&
+                entry->addr <= 0x100000 && end > 0x100000) {
+                return end > 0xFFFFF000 ? 0xFFFFF000 : (uint32_t)end;
+            }
+            offset += entry->size + sizeof(entry->size);
+        }
+    }
+
+    if (info->flags & MULTIBOOT_INFO_MEMORY) {
+        return 0x100000 + info->mem_upper * 1024;
+    }
+    return 0;
+}
+
+/**
+ * multiboot_init - Take what is needed from the boot information
+ * @magic: EAX at kernel entry
+ * @info: EBX at kernel entry
+ *
+ * Does nothing unless a multiboot loader started the kernel.
+ */
+__cold void multiboot_init(uint32_t magic, const multiboot_info_t *info) {
+    if (magic != MULTIBOOT_BOOTLOADER_MAGIC) return;
+
+    if (info->flags & MULTIBOOT_INFO_CMDLINE) {
+        const char *src = (const char *)info->cmdline;
+        uint32_t len = 0;
+        while (src[len] && len < BOOT_CMDLINE_MAX - 1) {
+            cmdline[len] = src[len];
+            len++;
+        }
+        cmdline[len] = '\0';
+    }
+
+    memory_end = multiboot_memory(info);
+
+    // The initrd goes where the boot sector would have put it
+    if ((info->flags & MULTIBOOT_INFO_MODS) && info->mods_count > 0) {
+        const multiboot_module_t *mod = (const multiboot_module_t *)info->mods_addr;
+        if (mod->end > mod->start && mod->end - mod->start <= INITRD_MAX_SIZE) {
+            memcpy((void *)INITRD_ADDR, (const void *)mod->start, mod->end - mod->start);
+        }
+    }
+}
+
+/**
+ * boot_cmdline - Get the kernel command line
+ *
+ * Return: Command line, empty if there is none
+ */
+const char *boot_cmdline(void) {
+    return cmdline;
+}
+
+/**
+ * boot_param - Look up a parameter on the command line
+ * @name: Parameter name
+ * @value: Receives the value
+ * @size: Size of value
+ *
+ * Return: 0 if the parameter is given, -1 otherwise
+ */
+int boot_param(const char *name, char *value, uint32_t size) {
+    uint32_t len = strlen(name);
+    const char *p = cmdline;
+
+    while (*p) {
+        while (*p == ' ') p++;
+
+        uint32_t i = 0;
+        while (i < len && p[i] == name[i]) i++;
+        if (i == len && (p[i] == '=' || p[i] == ' ' || p[i] == '\0')) {
+            const char *v = p[i] == '=' ? p + i + 1 : p + i;
+            uint32_t n = 0;
+            while (v[n] && v[n] != ' ' && n + 1 < size) {
+                value[n] = v[n];
+                n++;
+            }
+            if (size > 0) value[n] = '\0';
+            return 0;
+        }
+
+        while (*p && *p != ' ') p++;
+    }
+    return -1;
+}
+
+/**
+ * boot_memory_end - Get the end of the RAM that starts at 1MB
+ *
+ * Return: Physical address, 0 if the loader did not say
+ */
+uint32_t boot_memory_end(void) {
+    return memory_end;
+}
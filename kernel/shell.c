@@ -6,42 +6,93 @@
 #include "../include/shell.h"
 #include "../include/screen.h"
 #include "../include/memory.h"
-#include "../include/filesystem.h"
+#include "../include/vfs.h"
+#include "../include/boottrace.h"
 
 #define MAX_COMMAND_LENGTH 256
 
+// Bytes of a file printed per read by cat
+#define SHELL_READ_CHUNK 256
+
 static char command_buffer[MAX_COMMAND_LENGTH];
 static int command_index = 0;
-static char write_mode_filename[MAX_FILENAME];
+static int write_mode_fd = -1;
 static bool in_write_mode = false;
 
 /**
  * shell_init - Initialize the shell
  */
-void shell_init(void) {
+__cold void shell_init(void) {
     command_index = 0;
     command_buffer[0] = '\0';
     in_write_mode = false;
-    fs_init();
+    write_mode_fd = -1;
 }
 
+/**
+ * shell_list - Print the entries of a directory
+ * @path: Directory to list, empty for the working directory
+ *
+ * Return: 0 on success, -1 if not a directory
+ */
+static int shell_list(const char *path) {
+    int fd = vfs_open(*path ? path : ".", VFS_O_READ);
+    if (fd == -1) return -1;
+
+    vfs_dirent_t entry;
+    if (vfs_readdir(fd, &entry) != 0) {
+        vfs_close(fd);
+        vfs_stat_t st;
+        if (vfs_stat(*path ? path : ".", &st) != 0 || st.type != VFS_TYPE_DIR) return -1;
+        print("No files found.\n");
+        return 0;
+    }
+
+    print("Files:\n");
+    do {
+        print("  ");
+        print(entry.name);
+        if (entry.type == VFS_TYPE_DIR) {
+            print("/\n");
+        } else {
+            print(" (");
+            print_int(entry.size);
+            print(" bytes)\n");
+        }
+    } while (vfs_readdir(fd, &entry) == 0);
+
+    vfs_close(fd);
+    return 0;
+}
+
+// Only printed by "help", kept out of the way of the hot read-only data
+static const char shell_help_text[] __cold_rodata =
+    "\nAvailable commands:\n"
+    "  help         - Display this help message\n"
+    "  clear        - Clear the screen\n"
+    "  about        - Display system information\n"
+    "  echo <text>  - Echo text back to screen\n"
+    "  touch <file> - Create a new file\n"
+    "  write <file> - Write content to a file\n"
+    "  cat <file>   - Display file contents\n"
+    "  ls [dir]     - List files in a directory\n"
+    "  rm <file>    - Delete a file\n"
+    "  mkdir <dir>  - Create a directory\n"
+    "  rmdir <dir>  - Delete an empty directory\n"
+    "  cd <dir>     - Change the working directory\n"
+    "  pwd          - Print the working directory\n"
+    "  sync         - Write cached disk blocks to disk\n"
+    "  bootstat     - Show how long each boot phase took\n"
+    "  compress [-d] <file> - Store a file compressed (-d: uncompressed)\n"
+    "\n";
+
 /**
  * shell_execute - Execute a shell command
  * @command: Command string to execute
  */
 static void shell_execute(const char *command) {
     if (strcmp(command, "help") == 0) {
-        print("\nAvailable commands:\n");
-        print("  help         - Display this help message\n");
-        print("  clear        - Clear the screen\n");
-        print("  about        - Display system information\n");
-        print("  echo <text>  - Echo text back to screen\n");
-        print("  touch <file> - Create a new file\n");
-        print("  write <file> - Write content to a file\n");
-        print("  cat <file>   - Display file contents\n");
-        print("  ls           - List all files\n");
-        print("  rm <file>    - Delete a file\n");
-        print("\n");
+        print(shell_help_text);
     }
     else if (strcmp(command, "clear") == 0) {
         clear_screen();
@@ -68,17 +119,90 @@ static void shell_execute(const char *command) {
             print("\n\n");
         }
     }
-    else if (strcmp(command, "ls") == 0) {
-        // List files
+    else if (command[0] == 'l' && command[1] == 's' &&
+             (command[2] == '\0' || command[2] == ' ')) {
+        // List files, in the working directory unless a path is given
+        const char *path = command[2] == ' ' ? &command[3] : "";
         print("\n");
-        fs_list();
+        if (shell_list(path) != 0) {
+            print("Error: '");
+            print(path);
+            print("' is not a directory.\n");
+        }
+        print("\n");
+    }
+    else if (strcmp(command, "pwd") == 0) {
+        // Print working directory
         print("\n");
+        print(vfs_getcwd());
+        print("\n\n");
+    }
+    else if (strcmp(command, "sync") == 0) {
+        // Flush filesystems and the block cache
+        int written = vfs_sync();
+        if (written >= 0) {
+            print("\nWrote ");
+            print_int(written);
+            print(" blocks.\n\n");
+        } else {
+            print("\nError: Could not write all blocks to disk.\n\n");
+        }
+    }
+    else if (strcmp(command, "bootstat") == 0) {
+        // Boot-phase timing, also sent to the serial console at boot
+        print("\n");
+        boot_trace_report(print);
+        print("\n");
+    }
+    else if (command[0] == 'c' && command[1] == 'd' &&
+             (command[2] == '\0' || command[2] == ' ')) {
+        // Change directory, to the root if no path is given
+        const char *path = command[2] == ' ' ? &command[3] : "/";
+        if (vfs_chdir(path) == 0) {
+            print("\n");
+        } else {
+            print("\nError: '");
+            print(path);
+            print("' is not a directory.\n\n");
+        }
+    }
+    else if (command[0] == 'm' && command[1] == 'k' && command[2] == 'd' && command[3] == 'i' && command[4] == 'r') {
+        // Make directory
+        if (command[5] == ' ' && command[6] != '\0') {
+            const char *path = &command[6];
+            if (vfs_mkdir(path) == 0) {
+                print("\nDirectory '");
+                print(path);
+                print("' created successfully.\n\n");
+            } else {
+                print("\nError: Could not create directory. It may already exist or no space available.\n\n");
+            }
+        } else {
+            print("\nUsage: mkdir <dir>\n\n");
+        }
+    }
+    else if (command[0] == 'r' && command[1] == 'm' && command[2] == 'd' && command[3] == 'i' && command[4] == 'r') {
+        // Remove directory
+        if (command[5] == ' ' && command[6] != '\0') {
+            const char *path = &command[6];
+            if (vfs_rmdir(path) == 0) {
+                print("\nDirectory '");
+                print(path);
+                print("' deleted successfully.\n\n");
+            } else {
+                print("\nError: Could not delete directory. It may not exist, not be empty or be in use.\n\n");
+            }
+        } else {
+            print("\nUsage: rmdir <dir>\n\n");
+        }
     }
     else if (command[0] == 't' && command[1] == 'o' && command[2] == 'u' && command[3] == 'c' && command[4] == 'h') {
         // Touch command - create file
         if (command[5] == ' ' && command[6] != '\0') {
             const char *filename = &command[6];
-            if (fs_create(filename) == 0) {
+            int fd = vfs_open(filename, VFS_O_WRITE | VFS_O_CREAT | VFS_O_EXCL);
+            if (fd != -1) {
+                vfs_close(fd);
                 print("\nFile '");
                 print(filename);
                 print("' created successfully.\n\n");
@@ -93,8 +217,8 @@ static void shell_execute(const char *command) {
         // Write command - write to file
         if (command[5] == ' ' && command[6] != '\0') {
             const char *filename = &command[6];
-            if (fs_exists(filename)) {
-                strcpy(write_mode_filename, filename);
+            write_mode_fd = vfs_open(filename, VFS_O_WRITE | VFS_O_APPEND);
+            if (write_mode_fd != -1) {
                 in_write_mode = true;
                 print("\nEnter content (type 'EOF' on new line to finish):\n");
             } else {
@@ -106,15 +230,53 @@ static void shell_execute(const char *command) {
             print("\nUsage: write <filename>\n\n");
         }
     }
+    else if (command[0] == 'c' && command[1] == 'o' && command[2] == 'm' && command[3] == 'p' &&
+             command[4] == 'r' && command[5] == 'e' && command[6] == 's' && command[7] == 's' &&
+             (command[8] == '\0' || command[8] == ' ')) {
+        // Switch a file between compressed and plain storage
+        const char *filename = command[8] == ' ' ? &command[9] : "";
+        uint8_t flags = VFS_ATTR_COMPRESS;
+        if (filename[0] == '-' && filename[1] == 'd' && filename[2] == ' ') {
+            flags = 0;
+            filename += 3;
+        }
+
+        vfs_stat_t st;
+        if (!*filename) {
+            print("\nUsage: compress [-d] <filename>\n\n");
+        } else if (vfs_setattr(filename, flags) == 0 && vfs_stat(filename, &st) == 0) {
+            print("\n");
+            print_int(st.size);
+            print(" bytes stored in ");
+            print_int(st.stored);
+            print(".\n\n");
+        } else {
+            print("\nError: Could not change '");
+            print(filename);
+            print("'. It may not exist, not support compression or memory is low.\n\n");
+        }
+    }
     else if (command[0] == 'c' && command[1] == 'a' && command[2] == 't') {
         // Cat command - read file
         if (command[3] == ' ' && command[4] != '\0') {
             const char *filename = &command[4];
-            char buffer[MAX_FILE_SIZE];
-            if (fs_read(filename, buffer, MAX_FILE_SIZE) >= 0) {
+            vfs_stat_t st;
+            int fd = -1;
+            if (vfs_stat(filename, &st) == 0 && st.type == VFS_TYPE_FILE) {
+                fd = vfs_open(filename, VFS_O_READ);
+            }
+            if (fd != -1) {
+                // Stream the file so its size is not limited by the stack
+                char buffer[SHELL_READ_CHUNK + 1];
+                int n;
+
                 print("\n");
-                print(buffer);
+                while ((n = vfs_read(fd, buffer, SHELL_READ_CHUNK)) > 0) {
+                    buffer[n] = '\0';
+                    print(buffer);
+                }
                 print("\n\n");
+                vfs_close(fd);
             } else {
                 print("\nError: File '");
                 print(filename);
@@ -128,7 +290,7 @@ static void shell_execute(const char *command) {
         // Remove command - delete file
         if (command[2] == ' ' && command[3] != '\0') {
             const char *filename = &command[3];
-            if (fs_delete(filename) == 0) {
+            if (vfs_unlink(filename) == 0) {
                 print("\nFile '");
                 print(filename);
                 print("' deleted successfully.\n\n");
@@ -162,32 +324,19 @@ void shell_handle_input(char c) {
             // Check for EOF marker
             if (strcmp(command_buffer, "EOF") == 0) {
                 in_write_mode = false;
+                vfs_close(write_mode_fd);
+                write_mode_fd = -1;
                 print("\nFile saved.\n\n> ");
             } else {
-                // Append to file content
-                char current_content[MAX_FILE_SIZE];
-                fs_read(write_mode_filename, current_content, MAX_FILE_SIZE);
-
                 // Add newline if not first line
-                if (strlen(current_content) > 0) {
-                    int len = strlen(current_content);
-                    if (len < MAX_FILE_SIZE - 2) {
-                        current_content[len] = '\n';
-                        current_content[len + 1] = '\0';
-                    }
+                if (vfs_lseek(write_mode_fd, 0, VFS_SEEK_END) > 0) {
+                    vfs_write(write_mode_fd, "\n", 1);
                 }
 
                 // Append new line
-                int current_len = strlen(current_content);
-                int command_len = strlen(command_buffer);
-                if (current_len + command_len < MAX_FILE_SIZE - 1) {
-                    for (int i = 0; i < command_len; i++) {
-                        current_content[current_len + i] = command_buffer[i];
-                    }
-                    current_content[current_len + command_len] = '\0';
+                if (vfs_write(write_mode_fd, command_buffer, command_index) < 0) {
+                    print("\nError: File is full.");
                 }
-
-                fs_write(write_mode_filename, current_content);
                 print("\n");
             }
         } else {
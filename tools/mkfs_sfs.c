@@ -0,0 +1,442 @@
+/**
+ * mkfs_sfs.c - Create an sfs disk image on the host
+ * Formats an image file and copies a directory tree into it
+ *
+ * Usage: mkfs_sfs <image> <size-in-KB> [source-dir]
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+// Use the host's fixed-width types instead of the kernel's types.h
+#define TYPES_H
+#include "../include/sfs.h"
+
+static uint8_t *image;
+static uint32_t block_count;
+static uint32_t group_count;
+
+/**
+ * block_ptr - Get a block of the image
+ * @block: Block number
+ *
+ * Return: Pointer to the block's data
+ */
+static uint8_t *block_ptr(uint32_t block) {
+    return image + (size_t)block * SFS_BLOCK_SIZE;
+}
+
+/**
+ * group_start - Get the first block of a group
+ * @group: Group number
+ *
+ * Return: Block number
+ */
+static uint32_t group_start(uint32_t group) {
+    return SFS_FIRST_GROUP + group * SFS_BLOCKS_PER_GROUP;
+}
+
+/**
+ * group_size - Get the number of blocks in a group
+ * @group: Group number
+ *
+ * Return: Block count
+ */
+static uint32_t group_size(uint32_t group) {
+    uint32_t left = block_count - group_start(group);
+    return left < SFS_BLOCKS_PER_GROUP ? left : SFS_BLOCKS_PER_GROUP;
+}
+
+/**
+ * bit_test - Test a bit in a bitmap block
+ */
+static bool bit_test(uint32_t block, uint32_t bit) {
+    return block_ptr(block)[bit / 8] & (1 << (bit % 8));
+}
+
+/**
+ * bit_set - Set a bit in a bitmap block
+ */
+static void bit_set(uint32_t block, uint32_t bit) {
+    block_ptr(block)[bit / 8] |= 1 << (bit % 8);
+}
+
+/**
+ * free_blocks - Count the free blocks of a group
+ * @group: Group number
+ *
+ * Return: Number of free blocks
+ */
+static uint32_t free_blocks(uint32_t group) {
+    uint32_t bitmap = group_start(group) + SFS_GROUP_BLOCK_BITMAP;
+    uint32_t count = 0;
+
+    for (uint32_t bit = 0; bit < group_size(group); bit++) {
+        if (!bit_test(bitmap, bit)) count++;
+    }
+    return count;
+}
+
+/**
+ * inode_ptr - Get an inode in its group's inode table
+ * @ino: Inode number
+ *
+ * Return: Pointer to the inode
+ */
+static sfs_inode_t *inode_ptr(uint32_t ino) {
+    uint32_t group = (ino - 1) / SFS_INODES_PER_GROUP;
+    uint32_t index = (ino - 1) % SFS_INODES_PER_GROUP;
+    uint32_t block = group_start(group) + SFS_GROUP_INODE_TABLE + index / SFS_INODES_PER_BLOCK;
+
+    return (sfs_inode_t *)(block_ptr(block) + (index % SFS_INODES_PER_BLOCK) * SFS_INODE_SIZE);
+}
+
+/**
+ * crc32c - Checksum a block the way the kernel does (CRC32C)
+ * @data: Data
+ * @len: Length in bytes
+ *
+ * Return: Checksum
+ */
+static uint32_t crc32c(const uint8_t *data, uint32_t len) {
+    uint32_t crc = 0xFFFFFFFF;
+
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = crc & 1 ? (crc >> 1) ^ 0x82F63B78 : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+/**
+ * csum_set - Store the checksum of a file data block in its group's table
+ * @block: Data block
+ */
+static void csum_set(uint32_t block) {
+    uint32_t group = (block - SFS_FIRST_GROUP) / SFS_BLOCKS_PER_GROUP;
+    uint32_t bit = (block - SFS_FIRST_GROUP) % SFS_BLOCKS_PER_GROUP;
+    uint32_t *table = (uint32_t *)block_ptr(group_start(group) + SFS_GROUP_CSUM +
+                                            bit / SFS_CSUMS_PER_BLOCK);
+
+    table[bit % SFS_CSUMS_PER_BLOCK] = crc32c(block_ptr(block), SFS_BLOCK_SIZE);
+}
+
+/**
+ * alloc_block - Allocate a block at or after a goal, like the kernel does
+ * @goal: Preferred block
+ *
+ * Return: Block number, 0 if the image is full
+ */
+static uint32_t alloc_block(uint32_t goal) {
+    uint32_t first = 0;
+
+    if (goal >= SFS_FIRST_GROUP && goal < block_count) {
+        first = (goal - SFS_FIRST_GROUP) / SFS_BLOCKS_PER_GROUP;
+    }
+
+    for (uint32_t i = 0; i < group_count; i++) {
+        uint32_t group = (first + i) % group_count;
+        uint32_t start = group_start(group);
+        uint32_t size = group_size(group);
+        uint32_t bitmap = start + SFS_GROUP_BLOCK_BITMAP;
+        uint32_t from = goal >= start && goal - start < size ? goal - start : SFS_GROUP_DATA;
+
+        for (uint32_t j = 0; j < size; j++) {
+            uint32_t bit = (from + j) % size;
+            if (!bit_test(bitmap, bit)) {
+                bit_set(bitmap, bit);
+                return start + bit;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * alloc_inode - Allocate an inode, preferably in a given group
+ * @group: Preferred group
+ * @type: SFS_TYPE_FILE or SFS_TYPE_DIR
+ *
+ * Return: Inode number, 0 if no inode is free
+ */
+static uint32_t alloc_inode(uint32_t group, uint16_t type) {
+    for (uint32_t i = 0; i < group_count; i++) {
+        uint32_t g = (group + i) % group_count;
+        uint32_t bitmap = group_start(g) + SFS_GROUP_INODE_BITMAP;
+
+        for (uint32_t bit = 0; bit < SFS_INODES_PER_GROUP; bit++) {
+            if (bit_test(bitmap, bit)) continue;
+
+            bit_set(bitmap, bit);
+            uint32_t ino = g * SFS_INODES_PER_GROUP + bit + 1;
+            sfs_inode_t *inode = inode_ptr(ino);
+            memset(inode, 0, sizeof(*inode));
+            inode->type = type;
+            inode->links = 1;
+            return ino;
+        }
+    }
+    return 0;
+}
+
+/**
+ * inode_append - Append data to an inode, allocating blocks as needed
+ * @ino: Inode number
+ * @data: Data to append
+ * @len: Number of bytes
+ *
+ * Return: 0 on success, -1 if out of space or extents
+ */
+static int inode_append(uint32_t ino, const void *data, uint32_t len) {
+    sfs_inode_t *inode = inode_ptr(ino);
+    const uint8_t *in = data;
+
+    while (len > 0) {
+        uint32_t in_block = inode->size % SFS_BLOCK_SIZE;
+        uint32_t index = inode->size / SFS_BLOCK_SIZE;
+        uint32_t block = 0;
+        uint32_t seen = 0;
+
+        for (uint32_t i = 0; i < inode->extent_count && !block; i++) {
+            if (index < seen + inode->extents[i].count) {
+                block = inode->extents[i].start + index - seen;
+            }
+            seen += inode->extents[i].count;
+        }
+
+        if (!block) {
+            sfs_extent_t *last = inode->extent_count ? &inode->extents[inode->extent_count - 1] : NULL;
+            uint32_t goal = last ? last->start + last->count
+                                 : group_start((ino - 1) / SFS_INODES_PER_GROUP) + SFS_GROUP_DATA;
+
+            block = alloc_block(goal);
+            if (!block) return -1;
+            if (last && block == last->start + last->count) {
+                last->count++;
+            } else if (inode->extent_count < SFS_EXTENTS) {
+                inode->extents[inode->extent_count].start = block;
+                inode->extents[inode->extent_count].count = 1;
+                inode->extent_count++;
+            } else {
+                return -1;
+            }
+        }
+
+        uint32_t n = SFS_BLOCK_SIZE - in_block;
+        if (n > len) n = len;
+        memcpy(block_ptr(block) + in_block, in, n);
+        if (inode->type == SFS_TYPE_FILE) csum_set(block);
+        inode->size += n;
+        in += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/**
+ * dir_add - Add an entry to a directory
+ * @dir: Directory inode number
+ * @name: Entry name
+ * @ino: Inode the entry refers to
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int dir_add(uint32_t dir, const char *name, uint32_t ino) {
+    sfs_dirent_t entry;
+
+    memset(&entry, 0, sizeof(entry));
+    entry.ino = ino;
+    strcpy(entry.name, name);
+    if (inode_append(dir, &entry, sizeof(entry)) != 0) return -1;
+
+    inode_ptr(dir)->entries++;
+    return 0;
+}
+
+/**
+ * dir_group - Choose the group for a new directory
+ *
+ * Return: Group with the most free blocks
+ */
+static uint32_t dir_group(void) {
+    uint32_t best = 0;
+    uint32_t best_free = free_blocks(0);
+
+    for (uint32_t g = 1; g < group_count; g++) {
+        uint32_t n = free_blocks(g);
+        if (n > best_free) {
+            best = g;
+            best_free = n;
+        }
+    }
+    return best;
+}
+
+/**
+ * add_file - Copy a host file into the image
+ * @dir: Directory inode number
+ * @name: Entry name
+ * @path: Host path
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int add_file(uint32_t dir, const char *name, const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+
+    // Files start in their directory's group
+    uint32_t ino = alloc_inode((dir - 1) / SFS_INODES_PER_GROUP, SFS_TYPE_FILE);
+    if (!ino || dir_add(dir, name, ino) != 0) {
+        fclose(f);
+        fprintf(stderr, "%s: image full\n", path);
+        return -1;
+    }
+
+    uint8_t buffer[SFS_BLOCK_SIZE];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+        if (inode_append(ino, buffer, n) != 0) {
+            fclose(f);
+            fprintf(stderr, "%s: image full or too fragmented\n", path);
+            return -1;
+        }
+    }
+
+    fclose(f);
+    return 0;
+}
+
+/**
+ * add_tree - Copy a host directory tree into the image
+ * @dir: Directory inode number
+ * @path: Host directory path
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int add_tree(uint32_t dir, const char *path) {
+    DIR *d = opendir(path);
+    struct dirent *de;
+    int result = 0;
+
+    if (!d) {
+        perror(path);
+        return -1;
+    }
+
+    while ((de = readdir(d)) != NULL && result == 0) {
+        char child[4096];
+        struct stat st;
+
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) continue;
+        if (strlen(de->d_name) > SFS_NAME_MAX) {
+            fprintf(stderr, "skipping %s/%s: name too long\n", path, de->d_name);
+            continue;
+        }
+
+        snprintf(child, sizeof(child), "%s/%s", path, de->d_name);
+        if (stat(child, &st) != 0) continue;
+
+        if (S_ISDIR(st.st_mode)) {
+            uint32_t ino = alloc_inode(dir_group(), SFS_TYPE_DIR);
+            if (!ino || dir_add(dir, de->d_name, ino) != 0) {
+                fprintf(stderr, "%s: image full\n", child);
+                result = -1;
+            } else {
+                result = add_tree(ino, child);
+            }
+        } else if (S_ISREG(st.st_mode)) {
+            result = add_file(dir, de->d_name, child);
+        }
+    }
+
+    closedir(d);
+    return result;
+}
+
+/**
+ * format - Lay out an empty volume in the image
+ */
+static void format(void) {
+    sfs_super_t *super = (sfs_super_t *)block_ptr(SFS_SUPER_BLOCK);
+
+    super->magic = SFS_MAGIC;
+    super->block_count = block_count;
+    super->group_count = group_count;
+    super->inode_count = group_count * SFS_INODES_PER_GROUP;
+
+    // Group metadata and bits past the end of a short last group are used
+    for (uint32_t g = 0; g < group_count; g++) {
+        uint32_t bitmap = group_start(g) + SFS_GROUP_BLOCK_BITMAP;
+        for (uint32_t bit = 0; bit < SFS_BLOCKS_PER_GROUP; bit++) {
+            if (bit < SFS_GROUP_DATA || bit >= group_size(g)) bit_set(bitmap, bit);
+        }
+    }
+
+    // The journal takes the start of group 0's data area if it leaves room for files
+    if (group_size(0) >= SFS_GROUP_DATA + 2 * SFS_JOURNAL_BLOCKS) {
+        sfs_journal_header_t *header;
+
+        super->journal_start = group_start(0) + SFS_GROUP_DATA;
+        super->journal_blocks = SFS_JOURNAL_BLOCKS;
+        for (uint32_t i = 0; i < SFS_JOURNAL_BLOCKS; i++) {
+            bit_set(group_start(0) + SFS_GROUP_BLOCK_BITMAP, SFS_GROUP_DATA + i);
+        }
+
+        header = (sfs_journal_header_t *)block_ptr(super->journal_start);
+        header->magic = SFS_JOURNAL_MAGIC;
+    }
+
+    alloc_inode(0, SFS_TYPE_DIR);   // SFS_ROOT_INO
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3 || argc > 4) {
+        fprintf(stderr, "Usage: %s <image> <size-in-KB> [source-dir]\n", argv[0]);
+        return 1;
+    }
+
+    block_count = strtoul(argv[2], NULL, 0);
+    if (block_count > SFS_FIRST_GROUP + SFS_MAX_GROUPS * SFS_BLOCKS_PER_GROUP) {
+        block_count = SFS_FIRST_GROUP + SFS_MAX_GROUPS * SFS_BLOCKS_PER_GROUP;
+    }
+    if (block_count <= SFS_FIRST_GROUP + SFS_GROUP_DATA) {
+        fprintf(stderr, "%s: image too small\n", argv[2]);
+        return 1;
+    }
+
+    // A last group without room for data is left off
+    group_count = (block_count - SFS_FIRST_GROUP + SFS_BLOCKS_PER_GROUP - 1) / SFS_BLOCKS_PER_GROUP;
+    if (group_size(group_count - 1) <= SFS_GROUP_DATA) {
+        group_count--;
+        block_count = group_start(group_count);
+    }
+
+    image = calloc(block_count, SFS_BLOCK_SIZE);
+    if (!image) {
+        perror("calloc");
+        return 1;
+    }
+
+    format();
+    if (argc == 4 && add_tree(SFS_ROOT_INO, argv[3]) != 0) return 1;
+
+    FILE *out = fopen(argv[1], "wb");
+    if (!out || fwrite(image, SFS_BLOCK_SIZE, block_count, out) != block_count) {
+        perror(argv[1]);
+        return 1;
+    }
+    fclose(out);
+
+    printf("%s: %u KB, %u groups\n", argv[1], block_count, group_count);
+    return 0;
+}
@@ -0,0 +1,215 @@
+/**
+ * mkinitrd.c - Pack a directory tree into a boot archive on the host
+ * The archive is appended to the OS image and loaded by the bootloader
+ *
+ * Usage: mkinitrd <archive> [source-dir]
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+// Use the host's fixed-width types instead of the kernel's types.h
+#define TYPES_H
+#include "../include/initrd.h"
+
+// The bootloader reads whole sectors
+#define SECTOR_SIZE 512
+
+static initrd_entry_t *entries;
+static uint8_t **contents;
+static uint32_t entry_count;
+
+/**
+ * crc32c - Checksum data the way the kernel does (CRC32C)
+ * @data: Data
+ * @len: Length in bytes
+ *
+ * Return: Checksum
+ */
+static uint32_t crc32c(const uint8_t *data, uint32_t len) {
+    uint32_t crc = 0xFFFFFFFF;
+
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = crc & 1 ? (crc >> 1) ^ 0x82F63B78 : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+/**
+ * align - Round a size up to the archive's data alignment
+ */
+static uint32_t align(uint32_t n) {
+    return (n + INITRD_ALIGN - 1) & ~(INITRD_ALIGN - 1);
+}
+
+/**
+ * add_entry - Append an entry to the archive
+ * @path: Path relative to the root
+ * @type: INITRD_TYPE_FILE or INITRD_TYPE_DIR
+ * @data: File contents, NULL for directories
+ * @size: Number of bytes
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int add_entry(const char *path, uint32_t type, uint8_t *data, uint32_t size) {
+    if (strlen(path) >= INITRD_PATH_MAX) {
+        fprintf(stderr, "skipping %s: path too long\n", path);
+        free(data);
+        return 0;
+    }
+
+    entries = realloc(entries, (entry_count + 1) * sizeof(*entries));
+    contents = realloc(contents, (entry_count + 1) * sizeof(*contents));
+    if (!entries || !contents) {
+        perror("realloc");
+        return -1;
+    }
+
+    initrd_entry_t *entry = &entries[entry_count];
+    memset(entry, 0, sizeof(*entry));
+    strcpy(entry->path, path);
+    entry->type = type;
+    entry->size = size;
+    contents[entry_count++] = data;
+    return 0;
+}
+
+/**
+ * read_file - Load a host file into memory
+ * @path: Host path
+ * @size: Receives the file size
+ *
+ * Return: Contents (NULL for an empty file), NULL with *size set to
+ *         UINT32_MAX on error
+ */
+static uint8_t *read_file(const char *path, uint32_t *size) {
+    FILE *f = fopen(path, "rb");
+    struct stat st;
+    uint8_t *data = NULL;
+
+    *size = UINT32_MAX;
+    if (!f || fstat(fileno(f), &st) != 0) {
+        perror(path);
+        if (f) fclose(f);
+        return NULL;
+    }
+
+    if (st.st_size > INITRD_MAX_SIZE) {
+        fprintf(stderr, "%s: too large\n", path);
+    } else if (st.st_size == 0) {
+        *size = 0;
+    } else if ((data = malloc(st.st_size)) && fread(data, 1, st.st_size, f) == (size_t)st.st_size) {
+        *size = st.st_size;
+    } else {
+        perror(path);
+        free(data);
+        data = NULL;
+    }
+
+    fclose(f);
+    return data;
+}
+
+/**
+ * add_tree - Add a host directory tree to the archive
+ * @host: Host directory path
+ * @prefix: Archive path of the directory, "" for the root
+ *
+ * Entries are added in name order, each directory before its contents.
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int add_tree(const char *host, const char *prefix) {
+    struct dirent **names;
+    int n = scandir(host, &names, NULL, alphasort);
+    int result = 0;
+
+    if (n < 0) {
+        perror(host);
+        return -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        const char *name = names[i]->d_name;
+        char child[4096];
+        char path[4096];
+        struct stat st;
+
+        if (result == 0 && strcmp(name, ".") != 0 && strcmp(name, "..") != 0) {
+            snprintf(child, sizeof(child), "%s/%s", host, name);
+            snprintf(path, sizeof(path), "%s%s%s", prefix, *prefix ? "/" : "", name);
+
+            if (stat(child, &st) != 0) {
+                // Dangling link or race, leave it out
+            } else if (S_ISDIR(st.st_mode)) {
+                result = add_entry(path, INITRD_TYPE_DIR, NULL, 0);
+                if (result == 0) result = add_tree(child, path);
+            } else if (S_ISREG(st.st_mode)) {
+                uint32_t size;
+                uint8_t *data = read_file(child, &size);
+                result = size == UINT32_MAX ? -1 : add_entry(path, INITRD_TYPE_FILE, data, size);
+            }
+        }
+        free(names[i]);
+    }
+
+    free(names);
+    return result;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s <archive> [source-dir]\n", argv[0]);
+        return 1;
+    }
+
+    if (argc == 3 && add_tree(argv[2], "") != 0) return 1;
+
+    // Lay out the data after the entry table
+    uint64_t size = align(sizeof(initrd_header_t) + entry_count * sizeof(initrd_entry_t));
+    for (uint32_t i = 0; i < entry_count; i++) {
+        if (entries[i].type != INITRD_TYPE_FILE) continue;
+        entries[i].offset = size;
+        size += align(entries[i].size);
+    }
+    if (size > INITRD_MAX_SIZE) {
+        fprintf(stderr, "%s: archive of %llu bytes exceeds %u\n", argv[0],
+                (unsigned long long)size, INITRD_MAX_SIZE);
+        return 1;
+    }
+
+    uint32_t padded = (size + SECTOR_SIZE - 1) / SECTOR_SIZE * SECTOR_SIZE;
+    uint8_t *image = calloc(1, padded);
+    if (!image) {
+        perror("calloc");
+        return 1;
+    }
+
+    initrd_header_t *header = (initrd_header_t *)image;
+    header->magic = INITRD_MAGIC;
+    header->count = entry_count;
+    header->size = size;
+    memcpy(header + 1, entries, entry_count * sizeof(initrd_entry_t));
+    for (uint32_t i = 0; i < entry_count; i++) {
+        if (contents[i]) memcpy(image + entries[i].offset, contents[i], entries[i].size);
+    }
+    header->checksum = crc32c(image + sizeof(*header), size - sizeof(*header));
+
+    FILE *out = fopen(argv[1], "wb");
+    if (!out || fwrite(image, 1, padded, out) != padded) {
+        perror(argv[1]);
+        return 1;
+    }
+    fclose(out);
+
+    printf("%s: %u entries, %u bytes\n", argv[1], entry_count, (uint32_t)size);
+    return 0;
+}
@@ -0,0 +1,218 @@
+/**
+ * mkzimage.c - Compress the kernel image for the decompression stub
+ * Writes the payload that boot/zimage/zimage_entry.asm embeds: a
+ * zimage_header_t and the kernel as one LZ4 block
+ *
+ * Usage: mkzimage <kernel.bin> <payload>
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Use the host's fixed-width types instead of the kernel's types.h
+#define TYPES_H
+#include "../include/zimage.h"
+
+// Kernel header fields, see kernel/kernel_entry.asm
+#define KERNEL_MAGIC 0x1BADB002
+#define KHDR_MAGIC 4
+#define KHDR_START 20
+#define KHDR_ENTRY 32
+
+// Same block format as kernel/lib/lz4.c, which decodes it
+#define LZ4_MIN_MATCH 4
+#define LZ4_MF_LIMIT 12
+#define LZ4_LAST_LITERALS 5
+#define LZ4_MAX_OFFSET 65535
+
+// The kernel's compressor is sized for 64KB blocks; the whole image gets
+// a larger table and a sliding window instead
+#define LZ4_HASH_BITS 16
+
+static uint32_t table[1 << LZ4_HASH_BITS];
+
+/**
+ * read32 - Load 4 bytes, little-endian
+ * @p: Source
+ *
+ * Return: Value
+ */
+static uint32_t read32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * put_length - Write the extension bytes of a length
+ * @op: Output position
+ * @len: Length minus the 15 stored in the token
+ *
+ * Return: Output position after the bytes
+ */
+static uint8_t *put_length(uint8_t *op, uint32_t len) {
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = len;
+    return op;
+}
+
+/**
+ * emit - Write one sequence
+ * @op: Output position, with room for the worst case
+ * @literals: Literal bytes
+ * @lit: Number of literals
+ * @offset: Match offset, 0 for the final literals-only sequence
+ * @match: Match length minus LZ4_MIN_MATCH
+ *
+ * Return: Output position after the sequence
+ */
+static uint8_t *emit(uint8_t *op, const uint8_t *literals, uint32_t lit, uint32_t offset,
+                     uint32_t match) {
+    uint8_t *token = op++;
+    *token = (lit >= 15 ? 15 : lit) << 4;
+    if (lit >= 15) op = put_length(op, lit - 15);
+    memcpy(op, literals, lit);
+    op += lit;
+
+    if (offset) {
+        *op++ = offset & 0xFF;
+        *op++ = offset >> 8;
+        *token |= match >= 15 ? 15 : match;
+        if (match >= 15) op = put_length(op, match - 15);
+    }
+    return op;
+}
+
+/**
+ * compress - Compress a buffer into one LZ4 block
+ * @in: Input
+ * @len: Input length
+ * @dst: Output, at least len + len / 255 + 16 bytes
+ *
+ * Greedy like lz4_compress(), but matches may come from anywhere in the
+ * last 64KB of the input.
+ *
+ * Return: Compressed length
+ */
+static uint32_t compress(const uint8_t *in, uint32_t len, uint8_t *dst) {
+    const uint8_t *end = in + len;
+    const uint8_t *anchor = in;
+    uint8_t *op = dst;
+
+    if (len > LZ4_MF_LIMIT) {
+        const uint8_t *ip = in;
+        const uint8_t *mflimit = end - LZ4_MF_LIMIT;
+        const uint8_t *matchlimit = end - LZ4_LAST_LITERALS;
+
+        while (ip <= mflimit) {
+            uint32_t seq = read32(ip);
+            uint32_t h = (seq * 2654435761u) >> (32 - LZ4_HASH_BITS);
+            uint32_t candidate = table[h];
+            table[h] = ip - in + 1;
+
+            const uint8_t *ref = in + candidate - 1;
+            if (!candidate || ip - ref > LZ4_MAX_OFFSET || read32(ref) != seq) {
+                ip++;
+                continue;
+            }
+
+            // Grow the match backwards over pending literals, then forwards
+            while (ip > anchor && ref > in && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+            const uint8_t *p = ip + LZ4_MIN_MATCH;
+            const uint8_t *r = ref + LZ4_MIN_MATCH;
+            while (p < matchlimit && *p == *r) {
+                p++;
+                r++;
+            }
+
+            op = emit(op, anchor, ip - anchor, ip - ref, p - ip - LZ4_MIN_MATCH);
+            ip = anchor = p;
+        }
+    }
+
+    op = emit(op, anchor, end - anchor, 0, 0);
+    return op - dst;
+}
+
+/**
+ * read_file - Read a whole file
+ * @path: File
+ * @size: Receives the size
+ *
+ * Return: Contents, NULL on error
+ */
+static uint8_t *read_file(const char *path, uint32_t *size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t *data = len > 0 ? malloc(len) : NULL;
+    if (!data || fread(data, 1, len, f) != (size_t)len) {
+        free(data);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+    *size = len;
+    return data;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <kernel.bin> <payload>\n", argv[0]);
+        return 1;
+    }
+
+    uint32_t size;
+    uint8_t *kernel = read_file(argv[1], &size);
+    if (!kernel) {
+        perror(argv[1]);
+        return 1;
+    }
+    if (size < KHDR_ENTRY + 4 || read32(kernel + KHDR_MAGIC) != KERNEL_MAGIC) {
+        fprintf(stderr, "%s: %s has no kernel header\n", argv[0], argv[1]);
+        return 1;
+    }
+
+    zimage_header_t header;
+    header.magic = ZIMAGE_MAGIC;
+    header.load = read32(kernel + KHDR_START);
+    header.entry = read32(kernel + KHDR_ENTRY);
+    header.size = size;
+
+    // The stub inflates the kernel below itself
+    if (header.load + size > ZIMAGE_ADDR) {
+        fprintf(stderr, "%s: kernel of %u bytes at 0x%x overlaps the stub at 0x%x\n",
+                argv[0], size, header.load, ZIMAGE_ADDR);
+        return 1;
+    }
+
+    uint8_t *packed = malloc(size + size / 255 + 16);
+    if (!packed) {
+        perror("malloc");
+        return 1;
+    }
+    header.packed = compress(kernel, size, packed);
+
+    FILE *out = fopen(argv[2], "wb");
+    if (!out || fwrite(&header, sizeof(header), 1, out) != 1 ||
+        fwrite(packed, 1, header.packed, out) != header.packed) {
+        perror(argv[2]);
+        return 1;
+    }
+    fclose(out);
+
+    printf("%s: %u -> %u bytes (%u%%)\n", argv[2], size, header.packed,
+           (uint32_t)((uint64_t)header.packed * 100 / size));
+    return 0;
+}